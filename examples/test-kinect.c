@@ -95,7 +95,7 @@ process_buffer (guint16 *buffer,
                 guint threshold_end)
 {
   BufferInfo *buffer_info;
-  gint i, j, reduced_width, reduced_height;
+  gint reduced_width, reduced_height;
   guint16 *reduced_buffer;
 
   g_return_val_if_fail (buffer != NULL, NULL);
@@ -106,25 +106,14 @@ process_buffer (guint16 *buffer,
   reduced_buffer = g_slice_alloc0 (reduced_width * reduced_height *
                                    sizeof (guint16));
 
-  for (i = 0; i < reduced_width; i++)
-    {
-      for (j = 0; j < reduced_height; j++)
-        {
-          gint index;
-          guint16 value;
-
-          index = j * width * dimension_factor + i * dimension_factor;
-          value = buffer[index];
-
-          if (value < threshold_begin || value > threshold_end)
-            {
-              reduced_buffer[j * reduced_width + i] = 0;
-              continue;
-            }
-
-          reduced_buffer[j * reduced_width + i] = value;
-        }
-    }
+  skeltrack_depth_reduce_buffer (buffer,
+                                 width,
+                                 height,
+                                 dimension_factor,
+                                 threshold_begin,
+                                 threshold_end,
+                                 SKELTRACK_REDUCTION_MODE_POINT,
+                                 reduced_buffer);
 
   buffer_info = g_slice_new0 (BufferInfo);
   buffer_info->reduced_buffer = reduced_buffer;
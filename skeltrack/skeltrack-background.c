@@ -0,0 +1,194 @@
+/*
+ * skeltrack-background.c
+ *
+ * Skeltrack - A Free Software skeleton tracking library
+ * Copyright (C) 2012 Igalia S.L.
+ *
+ * Authors:
+ *  Joaquim Rocha <jrocha@igalia.com>
+ *  Eduardo Lima Mitev <elima@igalia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#include <glib.h>
+
+#include "skeltrack-background.h"
+
+/* How fast the background keeps adapting once it is learned */
+#define BACKGROUND_ADAPTATION_RATE .01
+
+/* How many standard deviations a point can be away from the background
+   while still belonging to it */
+#define BACKGROUND_DEVIATIONS 3
+
+static void
+reset_background_model (BackgroundModel *model, guint width, guint height)
+{
+  guint size = width * height;
+
+  clean_background_model (model);
+
+  model->width = width;
+  model->height = height;
+  model->nr_frames = 0;
+  model->mean = g_slice_alloc0 (size * sizeof (gfloat));
+  model->variance = g_slice_alloc0 (size * sizeof (gfloat));
+  model->nr_samples = g_slice_alloc0 (size * sizeof (guint16));
+  model->still_mean = g_slice_alloc0 (size * sizeof (gfloat));
+  model->still_frames = g_slice_alloc0 (size * sizeof (guint16));
+  model->foreground = g_slice_alloc (size * sizeof (guint16));
+}
+
+/* Counts the frames a foreground point keeps the same depth, making
+   it the background once it did for absorption_frames, like an
+   object that was moved and left in its new place */
+static gboolean
+absorb_point (BackgroundModel *model,
+              guint            index,
+              guint16          value,
+              guint16          tolerance,
+              guint16          absorption_frames)
+{
+  gfloat difference;
+
+  if (absorption_frames == 0)
+    return FALSE;
+
+  difference = value - model->still_mean[index];
+  if (model->still_frames[index] == 0 || ABS (difference) > tolerance)
+    {
+      model->still_mean[index] = value;
+      model->still_frames[index] = 1;
+    }
+  else
+    {
+      model->still_frames[index]++;
+      model->still_mean[index] += difference / model->still_frames[index];
+    }
+
+  if (model->still_frames[index] < absorption_frames)
+    return FALSE;
+
+  model->mean[index] = model->still_mean[index];
+  model->variance[index] = 0;
+  model->nr_samples[index] = 1;
+  model->still_frames[index] = 0;
+
+  return TRUE;
+}
+
+/* Writes the points of the buffer that do not belong to the background
+   into the model's foreground buffer, the others being set to 0.
+
+   The background is learned from the valid values of the first
+   learning_frames buffers, during which all points are kept. From then
+   on a point belongs to the background if it is within the given
+   tolerance, or a number of standard deviations for noisier points, of
+   the learned depth, and the background slowly adapts to it. A point
+   that had no valid value while learning has no background, and any
+   other point that keeps the same depth out of the background for
+   absorption_frames buffers (if not 0) becomes its background. */
+void
+subtract_background (BackgroundModel   *model,
+                     const DepthBuffer *buffer,
+                     guint              width,
+                     guint              height,
+                     guint16            tolerance,
+                     guint16            learning_frames,
+                     guint16            absorption_frames)
+{
+  guint i, j;
+  gboolean learning;
+
+  if (model->width != width || model->height != height)
+    reset_background_model (model, width, height);
+
+  learning = model->nr_frames < learning_frames;
+  if (learning)
+    model->nr_frames++;
+
+  for (j = 0; j < height; j++)
+    {
+      for (i = 0; i < width; i++)
+        {
+          guint index = j * width + i;
+          guint16 value;
+          gfloat difference, squared_difference;
+
+          value = get_depth_value (buffer, i, j);
+          model->foreground[index] = value;
+          if (value == 0)
+            continue;
+
+          difference = value - model->mean[index];
+          squared_difference = difference * difference;
+
+          if (learning)
+            {
+              /* Running mean and variance of the valid samples */
+              model->nr_samples[index]++;
+              model->mean[index] += difference / model->nr_samples[index];
+              model->variance[index] +=
+                (difference * (value - model->mean[index]) -
+                 model->variance[index]) / model->nr_samples[index];
+              continue;
+            }
+
+          if (model->nr_samples[index] > 0 &&
+              (squared_difference <= tolerance * tolerance ||
+               squared_difference <= BACKGROUND_DEVIATIONS *
+               BACKGROUND_DEVIATIONS * model->variance[index]))
+            {
+              model->foreground[index] = 0;
+              model->still_frames[index] = 0;
+              model->mean[index] += BACKGROUND_ADAPTATION_RATE * difference;
+              model->variance[index] += BACKGROUND_ADAPTATION_RATE *
+                (squared_difference - model->variance[index]);
+            }
+          else if (absorb_point (model,
+                                 index,
+                                 value,
+                                 tolerance,
+                                 absorption_frames))
+            {
+              model->foreground[index] = 0;
+            }
+        }
+    }
+}
+
+void
+clean_background_model (BackgroundModel *model)
+{
+  guint size = model->width * model->height;
+
+  if (model->mean == NULL)
+    return;
+
+  g_slice_free1 (size * sizeof (gfloat), model->mean);
+  g_slice_free1 (size * sizeof (gfloat), model->variance);
+  g_slice_free1 (size * sizeof (guint16), model->nr_samples);
+  g_slice_free1 (size * sizeof (gfloat), model->still_mean);
+  g_slice_free1 (size * sizeof (guint16), model->still_frames);
+  g_slice_free1 (size * sizeof (guint16), model->foreground);
+
+  model->mean = NULL;
+  model->variance = NULL;
+  model->nr_samples = NULL;
+  model->still_mean = NULL;
+  model->still_frames = NULL;
+  model->foreground = NULL;
+  model->width = 0;
+  model->height = 0;
+  model->nr_frames = 0;
+}
@@ -0,0 +1,54 @@
+/*
+ * skeltrack-background.h
+ *
+ * Skeltrack - A Free Software skeleton tracking library
+ * Copyright (C) 2012 Igalia S.L.
+ *
+ * Authors:
+ *  Joaquim Rocha <jrocha@igalia.com>
+ *  Eduardo Lima Mitev <elima@igalia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __SKELTRACK_BACKGROUND_H__
+#define __SKELTRACK_BACKGROUND_H__
+
+#include <glib.h>
+#include "skeltrack-util.h"
+
+/* Depth statistics of each point of the scene when nothing moves
+   in front of it, along with the depth a point has kept since it
+   stopped belonging to the background */
+typedef struct {
+  guint width;
+  guint height;
+  guint nr_frames;
+  gfloat *mean;
+  gfloat *variance;
+  guint16 *nr_samples;
+  gfloat *still_mean;
+  guint16 *still_frames;
+  guint16 *foreground;
+} BackgroundModel;
+
+void    subtract_background       (BackgroundModel   *model,
+                                   const DepthBuffer *buffer,
+                                   guint              width,
+                                   guint              height,
+                                   guint16            tolerance,
+                                   guint16            learning_frames,
+                                   guint16            absorption_frames);
+
+void    clean_background_model    (BackgroundModel   *model);
+
+#endif /* __SKELTRACK_BACKGROUND_H__ */
@@ -0,0 +1,127 @@
+/*
+ * skeltrack-camera.c
+ *
+ * Skeltrack - A Free Software skeleton tracking library
+ * Copyright (C) 2012 Igalia S.L.
+ *
+ * Authors:
+ *  Joaquim Rocha <jrocha@igalia.com>
+ *  Eduardo Lima Mitev <elima@igalia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/**
+ * SECTION:skeltrack-camera
+ * @short_description: Intrinsic parameters of a depth camera
+ *
+ * #SkeltrackSkeleton converts the points of the depth buffer into
+ * coordinates in the space (in mm) using a pinhole camera model. By
+ * default it uses parameters suited to the Kinect; a
+ * #SkeltrackCameraIntrinsics can be set in
+ * #SkeltrackSkeleton:camera-intrinsics to track with other sensors.
+ *
+ * A #SkeltrackCameraIntrinsics is created by
+ * skeltrack_camera_intrinsics_new(), copied by
+ * skeltrack_camera_intrinsics_copy() and freed by
+ * skeltrack_camera_intrinsics_free().
+ **/
+
+#include <string.h>
+#include "skeltrack-camera.h"
+
+/**
+ * skeltrack_camera_intrinsics_get_type:
+ *
+ * Returns: The registered #GType for #SkeltrackCameraIntrinsics boxed type
+ **/
+GType
+skeltrack_camera_intrinsics_get_type (void)
+{
+  static GType type = 0;
+
+  if (G_UNLIKELY (type == 0))
+    type = g_boxed_type_register_static ("SkeltrackCameraIntrinsics",
+                                         (GBoxedCopyFunc) skeltrack_camera_intrinsics_copy,
+                                         (GBoxedFreeFunc) skeltrack_camera_intrinsics_free);
+  return type;
+}
+
+/**
+ * skeltrack_camera_intrinsics_new:
+ * @focal_length_x: The horizontal focal length (in pixels)
+ * @focal_length_y: The vertical focal length (in pixels)
+ * @principal_point_x: The x coordinate of the principal point (in pixels)
+ * @principal_point_y: The y coordinate of the principal point (in pixels)
+ * @depth_offset: The offset added to every depth value (in mm)
+ *
+ * Creates a #SkeltrackCameraIntrinsics. The focal lengths need to be
+ * greater than 0.
+ *
+ * Returns: (transfer full): A newly created #SkeltrackCameraIntrinsics.
+ * Use skeltrack_camera_intrinsics_free() to free it.
+ **/
+SkeltrackCameraIntrinsics *
+skeltrack_camera_intrinsics_new (gfloat focal_length_x,
+                                 gfloat focal_length_y,
+                                 gfloat principal_point_x,
+                                 gfloat principal_point_y,
+                                 gint   depth_offset)
+{
+  SkeltrackCameraIntrinsics *intrinsics;
+
+  g_return_val_if_fail (focal_length_x > 0 && focal_length_y > 0, NULL);
+
+  intrinsics = g_slice_new0 (SkeltrackCameraIntrinsics);
+  intrinsics->focal_length_x = focal_length_x;
+  intrinsics->focal_length_y = focal_length_y;
+  intrinsics->principal_point_x = principal_point_x;
+  intrinsics->principal_point_y = principal_point_y;
+  intrinsics->depth_offset = depth_offset;
+
+  return intrinsics;
+}
+
+/**
+ * skeltrack_camera_intrinsics_copy:
+ * @intrinsics: The #SkeltrackCameraIntrinsics to copy
+ *
+ * Makes an exact copy of a #SkeltrackCameraIntrinsics object.
+ *
+ * Returns: (transfer full): A newly created #SkeltrackCameraIntrinsics.
+ * Use skeltrack_camera_intrinsics_free() to free it.
+ **/
+gpointer
+skeltrack_camera_intrinsics_copy (SkeltrackCameraIntrinsics *intrinsics)
+{
+  SkeltrackCameraIntrinsics *new_intrinsics;
+
+  if (intrinsics == NULL)
+    return NULL;
+
+  new_intrinsics = g_slice_new0 (SkeltrackCameraIntrinsics);
+  memcpy (new_intrinsics, intrinsics, sizeof (SkeltrackCameraIntrinsics));
+
+  return new_intrinsics;
+}
+
+/**
+ * skeltrack_camera_intrinsics_free:
+ * @intrinsics: The #SkeltrackCameraIntrinsics to free
+ *
+ * Frees a #SkeltrackCameraIntrinsics object.
+ **/
+void
+skeltrack_camera_intrinsics_free (SkeltrackCameraIntrinsics *intrinsics)
+{
+  g_slice_free (SkeltrackCameraIntrinsics, intrinsics);
+}
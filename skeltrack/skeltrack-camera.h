@@ -0,0 +1,68 @@
+/*
+ * skeltrack-camera.h
+ *
+ * Skeltrack - A Free Software skeleton tracking library
+ * Copyright (C) 2012 Igalia S.L.
+ *
+ * Authors:
+ *  Joaquim Rocha <jrocha@igalia.com>
+ *  Eduardo Lima Mitev <elima@igalia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __SKELTRACK_CAMERA_H__
+#define __SKELTRACK_CAMERA_H__
+
+#include <glib.h>
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define SKELTRACK_TYPE_CAMERA_INTRINSICS (skeltrack_camera_intrinsics_get_type ())
+
+typedef struct _SkeltrackCameraIntrinsics SkeltrackCameraIntrinsics;
+
+/**
+ * SkeltrackCameraIntrinsics:
+ * @focal_length_x: The horizontal focal length (in pixels)
+ * @focal_length_y: The vertical focal length (in pixels)
+ * @principal_point_x: The x coordinate of the principal point (in pixels)
+ * @principal_point_y: The y coordinate of the principal point (in pixels)
+ * @depth_offset: The offset added to every depth value (in mm)
+ *
+ * The intrinsic parameters of the depth camera, used to convert the
+ * points of the depth buffer into coordinates in the space. The pixels
+ * are those of the full resolution buffer, before any
+ * #SkeltrackSkeleton:dimension-reduction.
+ **/
+struct _SkeltrackCameraIntrinsics
+{
+  gfloat focal_length_x;
+  gfloat focal_length_y;
+  gfloat principal_point_x;
+  gfloat principal_point_y;
+  gint depth_offset;
+};
+
+GType                       skeltrack_camera_intrinsics_get_type (void);
+SkeltrackCameraIntrinsics * skeltrack_camera_intrinsics_new      (gfloat                     focal_length_x,
+                                                                  gfloat                     focal_length_y,
+                                                                  gfloat                     principal_point_x,
+                                                                  gfloat                     principal_point_y,
+                                                                  gint                       depth_offset);
+gpointer                    skeltrack_camera_intrinsics_copy     (SkeltrackCameraIntrinsics *intrinsics);
+void                        skeltrack_camera_intrinsics_free     (SkeltrackCameraIntrinsics *intrinsics);
+
+G_END_DECLS
+
+#endif /* __SKELTRACK_CAMERA_H__ */
@@ -0,0 +1,222 @@
+/*
+ * skeltrack-depth.c
+ *
+ * Skeltrack - A Free Software skeleton tracking library
+ * Copyright (C) 2012 Igalia S.L.
+ *
+ * Authors:
+ *  Joaquim Rocha <jrocha@igalia.com>
+ *  Eduardo Lima Mitev <elima@igalia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+/**
+ * SECTION:skeltrack-depth
+ * @short_description: Functions to prepare depth buffers for tracking
+ *
+ * #SkeltrackSkeleton expects a depth buffer that has already been
+ * reduced by its #SkeltrackSkeleton:dimension-reduction.
+ * skeltrack_depth_reduce_buffer() does that reduction from the full
+ * resolution buffer given by the device, also discarding the points
+ * outside a range of depth, so they do not have to be implemented by
+ * every application.
+ **/
+
+#include "skeltrack-depth.h"
+
+static gboolean
+is_valid_depth (guint16 value, guint16 min_depth, guint16 max_depth)
+{
+  return value != 0 && value >= min_depth && value <= max_depth;
+}
+
+/* Returns the lower median, reordering the values */
+static guint16
+select_median (guint16 *values, guint count)
+{
+  guint left, right, middle;
+
+  left = 0;
+  right = count - 1;
+  middle = (count - 1) / 2;
+
+  while (left < right)
+    {
+      guint16 pivot, tmp;
+      guint i, store;
+
+      pivot = values[(left + right) / 2];
+      values[(left + right) / 2] = values[right];
+      values[right] = pivot;
+
+      store = left;
+      for (i = left; i < right; i++)
+        {
+          if (values[i] < pivot)
+            {
+              tmp = values[i];
+              values[i] = values[store];
+              values[store] = tmp;
+              store++;
+            }
+        }
+      values[right] = values[store];
+      values[store] = pivot;
+
+      if (store == middle)
+        return values[store];
+      else if (store < middle)
+        left = store + 1;
+      else
+        right = store - 1;
+    }
+
+  return values[left];
+}
+
+static guint16
+reduce_block (const guint16 *block,
+              guint width,
+              guint dimension_reduction,
+              guint16 min_depth,
+              guint16 max_depth,
+              SkeltrackReductionMode mode,
+              guint16 *scratch)
+{
+  guint x, y, count = 0;
+  guint32 sum = 0;
+  guint16 min = G_MAXUINT16;
+
+  if (mode == SKELTRACK_REDUCTION_MODE_POINT)
+    {
+      if (is_valid_depth (block[0], min_depth, max_depth))
+        return block[0];
+      return 0;
+    }
+
+  for (y = 0; y < dimension_reduction; y++)
+    {
+      const guint16 *row = block + y * width;
+
+      for (x = 0; x < dimension_reduction; x++)
+        {
+          guint16 value = row[x];
+
+          if (!is_valid_depth (value, min_depth, max_depth))
+            continue;
+
+          if (mode == SKELTRACK_REDUCTION_MODE_MEDIAN)
+            scratch[count] = value;
+
+          sum += value;
+          min = MIN (min, value);
+          count++;
+        }
+    }
+
+  if (count == 0)
+    return 0;
+
+  switch (mode)
+    {
+    case SKELTRACK_REDUCTION_MODE_MIN:
+      return min;
+
+    case SKELTRACK_REDUCTION_MODE_MEDIAN:
+      return select_median (scratch, count);
+
+    case SKELTRACK_REDUCTION_MODE_MEAN:
+    default:
+      return sum / count;
+    }
+}
+
+/**
+ * skeltrack_depth_reduce_buffer:
+ * @buffer: The full resolution buffer containing the depth information
+ * (in mm)
+ * @width: The width of the @buffer
+ * @height: The height of the @buffer
+ * @dimension_reduction: The size of the side of the blocks of points that
+ * are reduced to a single point, usually the
+ * #SkeltrackSkeleton:dimension-reduction
+ * @min_depth: The minimum depth (in mm) of a valid point
+ * @max_depth: The maximum depth (in mm) of a valid point
+ * @mode: How each block of points is reduced, see #SkeltrackReductionMode
+ * @reduced_buffer: The buffer where the reduced depth information is
+ * written
+ *
+ * Reduces @buffer by @dimension_reduction in a single pass so it can be
+ * given to skeltrack_skeleton_track_joints().
+ *
+ * Points with a depth of 0 or outside [@min_depth, @max_depth] are
+ * considered invalid and written as 0 when using
+ * %SKELTRACK_REDUCTION_MODE_POINT, or otherwise ignored when reducing
+ * their block. A block without valid points is written as 0.
+ *
+ * The @reduced_buffer needs to have room for
+ * (@width / @dimension_reduction) * (@height / @dimension_reduction)
+ * points; any points left over on the right and bottom of @buffer are
+ * ignored.
+ **/
+void
+skeltrack_depth_reduce_buffer (const guint16          *buffer,
+                               guint                   width,
+                               guint                   height,
+                               guint                   dimension_reduction,
+                               guint16                 min_depth,
+                               guint16                 max_depth,
+                               SkeltrackReductionMode  mode,
+                               guint16                *reduced_buffer)
+{
+  guint i, j, reduced_width, reduced_height;
+  guint16 *scratch = NULL;
+
+  g_return_if_fail (buffer != NULL);
+  g_return_if_fail (reduced_buffer != NULL);
+  g_return_if_fail (dimension_reduction > 0);
+
+  reduced_width = width / dimension_reduction;
+  reduced_height = height / dimension_reduction;
+
+  if (mode == SKELTRACK_REDUCTION_MODE_MEDIAN)
+    {
+      scratch = g_slice_alloc (dimension_reduction * dimension_reduction *
+                               sizeof (guint16));
+    }
+
+  /* Rows are visited in order so the buffer is read sequentially */
+  for (j = 0; j < reduced_height; j++)
+    {
+      const guint16 *block_row = buffer + j * dimension_reduction * width;
+
+      for (i = 0; i < reduced_width; i++)
+        {
+          reduced_buffer[j * reduced_width + i] =
+            reduce_block (block_row + i * dimension_reduction,
+                          width,
+                          dimension_reduction,
+                          min_depth,
+                          max_depth,
+                          mode,
+                          scratch);
+        }
+    }
+
+  if (scratch != NULL)
+    {
+      g_slice_free1 (dimension_reduction * dimension_reduction *
+                     sizeof (guint16),
+                     scratch);
+    }
+}
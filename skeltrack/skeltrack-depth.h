@@ -0,0 +1,100 @@
+/*
+ * skeltrack-depth.h
+ *
+ * Skeltrack - A Free Software skeleton tracking library
+ * Copyright (C) 2012 Igalia S.L.
+ *
+ * Authors:
+ *  Joaquim Rocha <jrocha@igalia.com>
+ *  Eduardo Lima Mitev <elima@igalia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __SKELTRACK_DEPTH_H__
+#define __SKELTRACK_DEPTH_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * SkeltrackReductionMode:
+ * @SKELTRACK_REDUCTION_MODE_POINT: The top left point of each block
+ * @SKELTRACK_REDUCTION_MODE_MIN: The closest valid point of each block
+ * @SKELTRACK_REDUCTION_MODE_MEDIAN: The median of the valid points of each
+ * block
+ * @SKELTRACK_REDUCTION_MODE_MEAN: The mean of the valid points of each
+ * block
+ *
+ * How each block of points of a depth buffer is reduced to a single
+ * point by skeltrack_depth_reduce_buffer().
+ **/
+typedef enum {
+  SKELTRACK_REDUCTION_MODE_POINT,
+  SKELTRACK_REDUCTION_MODE_MIN,
+  SKELTRACK_REDUCTION_MODE_MEDIAN,
+  SKELTRACK_REDUCTION_MODE_MEAN
+} SkeltrackReductionMode;
+
+/**
+ * SkeltrackDepthFormat:
+ * @SKELTRACK_DEPTH_FORMAT_MM: #guint16 depth in mm
+ * @SKELTRACK_DEPTH_FORMAT_DISPARITY: #guint16 raw 11 bit Kinect
+ * disparity, with 2047 meaning an invalid point
+ * @SKELTRACK_DEPTH_FORMAT_PACKED_10BIT: 10 bit depth in mm, packed most
+ * significant bit first
+ * @SKELTRACK_DEPTH_FORMAT_PACKED_12BIT: 12 bit depth in mm, packed most
+ * significant bit first
+ * @SKELTRACK_DEPTH_FORMAT_FLOAT_METRES: #gfloat depth in metres, with 0
+ * or NaN meaning an invalid point
+ *
+ * The format of the depth buffers given to
+ * skeltrack_skeleton_track_joints_full(). Points are converted to mm as
+ * they are read while tracking.
+ **/
+typedef enum {
+  SKELTRACK_DEPTH_FORMAT_MM,
+  SKELTRACK_DEPTH_FORMAT_DISPARITY,
+  SKELTRACK_DEPTH_FORMAT_PACKED_10BIT,
+  SKELTRACK_DEPTH_FORMAT_PACKED_12BIT,
+  SKELTRACK_DEPTH_FORMAT_FLOAT_METRES
+} SkeltrackDepthFormat;
+
+/**
+ * SkeltrackDepthPoint:
+ * @i: The column of the point in the full resolution frame
+ * @j: The row of the point in the full resolution frame
+ * @z: The depth of the point (in mm)
+ *
+ * A point of a sparse depth frame, like the points of the user already
+ * segmented by another stage, given to
+ * skeltrack_skeleton_track_joints_points().
+ **/
+typedef struct {
+  guint16 i;
+  guint16 j;
+  guint16 z;
+} SkeltrackDepthPoint;
+
+void      skeltrack_depth_reduce_buffer       (const guint16          *buffer,
+                                               guint                   width,
+                                               guint                   height,
+                                               guint                   dimension_reduction,
+                                               guint16                 min_depth,
+                                               guint16                 max_depth,
+                                               SkeltrackReductionMode  mode,
+                                               guint16                *reduced_buffer);
+
+G_END_DECLS
+
+#endif /* __SKELTRACK_DEPTH_H__ */
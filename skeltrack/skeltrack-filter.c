@@ -0,0 +1,283 @@
+/*
+ * skeltrack-filter.c
+ *
+ * Skeltrack - A Free Software skeleton tracking library
+ * Copyright (C) 2012 Igalia S.L.
+ *
+ * Authors:
+ *  Joaquim Rocha <jrocha@igalia.com>
+ *  Eduardo Lima Mitev <elima@igalia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include "skeltrack-filter.h"
+
+/* Fraction of the points of the buffer a histogram peak needs to
+   hold to be taken as an object, so a large background does not hide
+   the user, and the depth (in mm) without points that separates two
+   objects */
+#define DEPTH_GATING_MIN_PEAK .02
+#define DEPTH_GATING_MIN_GAP 200
+
+#define SORT_PAIR(a, b) { guint16 tmp = MIN (a, b); b = MAX (a, b); a = tmp; }
+
+/* Median of 9 values using a fixed sorting network, so there
+   are no data dependent branches */
+static guint16
+get_median_of_9 (guint16 *p)
+{
+  SORT_PAIR (p[1], p[2]); SORT_PAIR (p[4], p[5]); SORT_PAIR (p[7], p[8]);
+  SORT_PAIR (p[0], p[1]); SORT_PAIR (p[3], p[4]); SORT_PAIR (p[6], p[7]);
+  SORT_PAIR (p[1], p[2]); SORT_PAIR (p[4], p[5]); SORT_PAIR (p[7], p[8]);
+  SORT_PAIR (p[0], p[3]); SORT_PAIR (p[5], p[8]); SORT_PAIR (p[4], p[7]);
+  SORT_PAIR (p[3], p[6]); SORT_PAIR (p[1], p[4]); SORT_PAIR (p[2], p[5]);
+  SORT_PAIR (p[4], p[7]); SORT_PAIR (p[4], p[2]); SORT_PAIR (p[6], p[4]);
+  SORT_PAIR (p[4], p[2]);
+
+  return p[4];
+}
+
+static void
+copy_border (const DepthBuffer *buffer,
+             guint width,
+             guint height,
+             guint16 *output)
+{
+  guint i, j;
+
+  if (width == 0 || height == 0)
+    return;
+
+  for (i = 0; i < width; i++)
+    {
+      output[i] = get_depth_value (buffer, i, 0);
+      output[(height - 1) * width + i] = get_depth_value (buffer,
+                                                          i,
+                                                          height - 1);
+    }
+
+  for (j = 0; j < height; j++)
+    {
+      output[j * width] = get_depth_value (buffer, 0, j);
+      output[j * width + width - 1] = get_depth_value (buffer, width - 1, j);
+    }
+}
+
+/* Replaces each point by the median of the 3x3 points around it,
+   invalid ones included, so isolated points are removed and single
+   point holes are filled. The border is copied as is. */
+void
+filter_depth_median (const DepthBuffer *buffer,
+                     guint              width,
+                     guint              height,
+                     guint16           *filtered)
+{
+  guint i, j;
+
+  if (width < 3 || height < 3)
+    {
+      copy_border (buffer, width, height, filtered);
+      return;
+    }
+
+  for (j = 1; j < height - 1; j++)
+    {
+      for (i = 1; i < width - 1; i++)
+        {
+          guint16 values[9];
+          guint k;
+
+          for (k = 0; k < 9; k++)
+            values[k] = get_depth_value (buffer, i + k % 3 - 1, j + k / 3 - 1);
+
+          filtered[j * width + i] = get_median_of_9 (values);
+        }
+    }
+
+  copy_border (buffer, width, height, filtered);
+}
+
+/* Fills the invalid points that have at least min_neighbors valid
+   points around them with their median. Only the original points
+   are considered, so holes do not grow from filled points. */
+void
+fill_depth_holes (const DepthBuffer *buffer,
+                  guint              width,
+                  guint              height,
+                  guint              min_neighbors,
+                  guint16           *filled)
+{
+  guint i, j;
+
+  if (width < 3 || height < 3)
+    {
+      copy_border (buffer, width, height, filled);
+      return;
+    }
+
+  for (j = 1; j < height - 1; j++)
+    {
+      for (i = 1; i < width - 1; i++)
+        {
+          guint16 values[8];
+          guint16 value;
+          guint k, count = 0;
+
+          value = get_depth_value (buffer, i, j);
+          filled[j * width + i] = value;
+          if (value != 0)
+            continue;
+
+          for (k = 0; k < 9; k++)
+            {
+              guint l;
+
+              if (k == 4)
+                continue;
+
+              value = get_depth_value (buffer, i + k % 3 - 1, j + k / 3 - 1);
+              if (value == 0)
+                continue;
+
+              /* Insertion sort, there are at most 8 values */
+              for (l = count; l > 0 && values[l - 1] > value; l--)
+                values[l] = values[l - 1];
+              values[l] = value;
+              count++;
+            }
+
+          if (count >= min_neighbors)
+            filled[j * width + i] = values[(count - 1) / 2];
+        }
+    }
+
+  copy_border (buffer, width, height, filled);
+}
+
+/* Returns the last non empty bin found behind the peak, before a
+   gap or max_band */
+static guint
+find_band_end (const guint *histogram, guint peak, guint16 max_band)
+{
+  guint bin, end, empty_bins = 0;
+
+  end = peak;
+  for (bin = peak + 1;
+       bin < DEPTH_HISTOGRAM_NR_BINS &&
+         (bin - peak) * DEPTH_HISTOGRAM_BIN_SIZE <= max_band;
+       bin++)
+    {
+      if (histogram[bin] != 0)
+        {
+          end = bin;
+          empty_bins = 0;
+        }
+      else if (++empty_bins * DEPTH_HISTOGRAM_BIN_SIZE >= DEPTH_GATING_MIN_GAP)
+        {
+          break;
+        }
+    }
+
+  return end;
+}
+
+static guint
+find_nearest_peak (const guint *histogram,
+                   guint min_count,
+                   guint16 reference_depth)
+{
+  guint bin, peak, best_distance;
+
+  peak = DEPTH_HISTOGRAM_NR_BINS;
+  best_distance = G_MAXUINT;
+
+  for (bin = 0; bin < DEPTH_HISTOGRAM_NR_BINS; bin++)
+    {
+      guint center, distance;
+
+      if (histogram[bin] == 0 || histogram[bin] < min_count)
+        continue;
+
+      if ((bin > 0 && histogram[bin - 1] > histogram[bin]) ||
+          (bin + 1 < DEPTH_HISTOGRAM_NR_BINS &&
+           histogram[bin + 1] > histogram[bin]))
+        {
+          continue;
+        }
+
+      center = bin * DEPTH_HISTOGRAM_BIN_SIZE + DEPTH_HISTOGRAM_BIN_SIZE / 2;
+      distance = ABS ((gint) center - (gint) reference_depth);
+      if (distance < best_distance ||
+          (distance == best_distance && histogram[bin] > histogram[peak]))
+        {
+          peak = bin;
+          best_distance = distance;
+        }
+    }
+
+  return peak;
+}
+
+/* Keeps only the points in the band of depth around the histogram
+   peak closest to reference_depth, that is, the object at that depth.
+   Behind the peak, the band ends at the first gap in the histogram or
+   at max_band (in mm). In front of it, where the hands reach, there is
+   often a gap between them and the body so the band always extends
+   max_band. If there is no peak, all the points are kept.
+
+   The buffer is only read once, for the histogram: the band becomes
+   the range of depth the buffer is read in, so the points are gated
+   by whatever reads them next instead of being copied. */
+void
+gate_depth_range (DepthBuffer *buffer,
+                  guint        width,
+                  guint        height,
+                  guint16      reference_depth,
+                  guint16      max_band)
+{
+  guint histogram[DEPTH_HISTOGRAM_NR_BINS];
+  guint i, j, peak;
+
+  memset (histogram, 0, sizeof (histogram));
+
+  for (j = 0; j < height; j++)
+    {
+      for (i = 0; i < width; i++)
+        {
+          guint16 value = get_depth_value (buffer, i, j);
+
+          if (value == 0)
+            continue;
+
+          histogram[value / DEPTH_HISTOGRAM_BIN_SIZE]++;
+        }
+    }
+
+  peak = find_nearest_peak (histogram,
+                            width * height * DEPTH_GATING_MIN_PEAK,
+                            reference_depth);
+
+  if (peak < DEPTH_HISTOGRAM_NR_BINS)
+    {
+      guint end = find_band_end (histogram, peak, max_band);
+
+      buffer->min_depth = MAX ((gint) (peak * DEPTH_HISTOGRAM_BIN_SIZE) -
+                               max_band,
+                               buffer->min_depth);
+      buffer->max_depth = MIN ((end + 1) * DEPTH_HISTOGRAM_BIN_SIZE - 1,
+                               buffer->max_depth);
+    }
+}
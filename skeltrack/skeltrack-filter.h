@@ -0,0 +1,50 @@
+/*
+ * skeltrack-filter.h
+ *
+ * Skeltrack - A Free Software skeleton tracking library
+ * Copyright (C) 2012 Igalia S.L.
+ *
+ * Authors:
+ *  Joaquim Rocha <jrocha@igalia.com>
+ *  Eduardo Lima Mitev <elima@igalia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __SKELTRACK_FILTER_H__
+#define __SKELTRACK_FILTER_H__
+
+#include <glib.h>
+#include "skeltrack-util.h"
+
+/* Width, in mm, of the bins of the depth histogram used for gating */
+#define DEPTH_HISTOGRAM_BIN_SIZE 50
+#define DEPTH_HISTOGRAM_NR_BINS (G_MAXUINT16 / DEPTH_HISTOGRAM_BIN_SIZE + 1)
+
+void    filter_depth_median    (const DepthBuffer *buffer,
+                                guint              width,
+                                guint              height,
+                                guint16           *filtered);
+
+void    fill_depth_holes       (const DepthBuffer *buffer,
+                                guint              width,
+                                guint              height,
+                                guint              min_neighbors,
+                                guint16           *filled);
+
+void    gate_depth_range       (DepthBuffer       *buffer,
+                                guint              width,
+                                guint              height,
+                                guint16            reference_depth,
+                                guint16            max_band);
+
+#endif /* __SKELTRACK_FILTER_H__ */
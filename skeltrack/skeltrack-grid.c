@@ -0,0 +1,644 @@
+/*
+ * skeltrack-grid.c
+ *
+ * Skeltrack - A Free Software skeleton tracking library
+ * Copyright (C) 2012 Igalia S.L.
+ *
+ * Authors:
+ *  Joaquim Rocha <jrocha@igalia.com>
+ *  Eduardo Lima Mitev <elima@igalia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include "skeltrack-grid.h"
+
+typedef struct {
+  gint di;
+  gint dj;
+  NodeGridEdge edge;
+  NodeGridEdge opposite;
+} Direction;
+
+/* Listed in the order the graph building prepends each neighbor to
+   a node, so rebuilt neighbor lists match a full rebuild. The first
+   four are the neighbors that come before a node in the scan. */
+static const Direction directions[] =
+  {
+    {-1,  0, NODE_GRID_EDGE_W,  NODE_GRID_EDGE_E},
+    {-1,  1, NODE_GRID_EDGE_SW, NODE_GRID_EDGE_NE},
+    { 0, -1, NODE_GRID_EDGE_N,  NODE_GRID_EDGE_S},
+    {-1, -1, NODE_GRID_EDGE_NW, NODE_GRID_EDGE_SE},
+    { 0,  1, NODE_GRID_EDGE_S,  NODE_GRID_EDGE_N},
+    { 1, -1, NODE_GRID_EDGE_NE, NODE_GRID_EDGE_SW},
+    { 1,  0, NODE_GRID_EDGE_E,  NODE_GRID_EDGE_W},
+    { 1,  1, NODE_GRID_EDGE_SE, NODE_GRID_EDGE_NW}
+  };
+
+#define NR_DIRECTIONS G_N_ELEMENTS (directions)
+#define NR_BACKWARD_DIRECTIONS 4
+
+#define NO_COMPONENT G_MAXUINT8
+
+static guint
+get_nr_tiles (guint length)
+{
+  return (length + NODE_GRID_TILE_SIZE - 1) / NODE_GRID_TILE_SIZE;
+}
+
+static gboolean
+is_cell_in_dirty_tile (NodeGrid *grid, gint i, gint j)
+{
+  guint tiles_x = get_nr_tiles (grid->width);
+  return grid->dirty_tiles[(j / NODE_GRID_TILE_SIZE) * tiles_x +
+                           i / NODE_GRID_TILE_SIZE];
+}
+
+static gboolean
+tile_changed (NodeGrid *grid,
+              const DepthBuffer *buffer,
+              guint tile_x,
+              guint tile_y,
+              guint16 tolerance)
+{
+  guint i, j, end_i, end_j;
+
+  end_i = MIN ((tile_x + 1) * NODE_GRID_TILE_SIZE, grid->width);
+  end_j = MIN ((tile_y + 1) * NODE_GRID_TILE_SIZE, grid->height);
+
+  for (j = tile_y * NODE_GRID_TILE_SIZE; j < end_j; j++)
+    {
+      for (i = tile_x * NODE_GRID_TILE_SIZE; i < end_i; i++)
+        {
+          guint16 old_value, new_value;
+
+          old_value = grid->buffer[j * grid->width + i];
+          new_value = get_depth_value (buffer, i, j);
+
+          /* A node appearing or disappearing is always a change */
+          if ((old_value == 0) != (new_value == 0) ||
+              ABS (old_value - new_value) > tolerance)
+            {
+              return TRUE;
+            }
+        }
+    }
+
+  return FALSE;
+}
+
+static void
+rebuild_tile_nodes (NodeGrid *grid,
+                    const DepthBuffer *buffer,
+                    const Projection *projection,
+                    guint tile_x,
+                    guint tile_y)
+{
+  guint i, j, end_i, end_j;
+
+  end_i = MIN ((tile_x + 1) * NODE_GRID_TILE_SIZE, grid->width);
+  end_j = MIN ((tile_y + 1) * NODE_GRID_TILE_SIZE, grid->height);
+
+  for (j = tile_y * NODE_GRID_TILE_SIZE; j < end_j; j++)
+    {
+      for (i = tile_x * NODE_GRID_TILE_SIZE; i < end_i; i++)
+        {
+          Node *node;
+          guint16 value;
+          guint index = j * grid->width + i;
+
+          /* Neighbors pointing to the old node get their
+             lists rebuilt once all the edges are updated */
+          if (grid->nodes[index] != NULL)
+            {
+              free_node (grid->nodes[index], FALSE);
+              grid->nodes[index] = NULL;
+            }
+
+          value = get_depth_value (buffer, i, j);
+          grid->buffer[index] = value;
+          if (value == 0)
+            continue;
+
+          node = g_slice_new0 (Node);
+          node->i = i;
+          node->j = j;
+          node->z = value;
+          convert_screen_coords_to_mm (projection,
+                                       i, j,
+                                       node->z,
+                                       &(node->x),
+                                       &(node->y));
+          node->neighbors = NULL;
+          node->linked_nodes = NULL;
+
+          grid->nodes[index] = node;
+        }
+    }
+}
+
+static void
+update_tile_edges (NodeGrid *grid, guint tile_x, guint tile_y)
+{
+  guint i, j, d, end_i, end_j;
+
+  end_i = MIN ((tile_x + 1) * NODE_GRID_TILE_SIZE, grid->width);
+  end_j = MIN ((tile_y + 1) * NODE_GRID_TILE_SIZE, grid->height);
+
+  for (j = tile_y * NODE_GRID_TILE_SIZE; j < end_j; j++)
+    {
+      for (i = tile_x * NODE_GRID_TILE_SIZE; i < end_i; i++)
+        {
+          Node *node, *neighbor;
+          guint squared_distance;
+          guint index = j * grid->width + i;
+
+          node = grid->nodes[index];
+          for (d = 0; d < NR_DIRECTIONS; d++)
+            {
+              gint neighbor_i, neighbor_j;
+              guint neighbor_index;
+
+              neighbor_i = i + directions[d].di;
+              neighbor_j = j + directions[d].dj;
+              if (neighbor_i < 0 || neighbor_i >= grid->width ||
+                  neighbor_j < 0 || neighbor_j >= grid->height)
+                {
+                  continue;
+                }
+
+              /* Edges between two rebuilt cells are only
+                 computed from the later one in the scan */
+              if (d >= NR_BACKWARD_DIRECTIONS &&
+                  is_cell_in_dirty_tile (grid, neighbor_i, neighbor_j))
+                {
+                  continue;
+                }
+
+              neighbor_index = neighbor_j * grid->width + neighbor_i;
+              neighbor = grid->nodes[neighbor_index];
+
+              if (node == NULL || neighbor == NULL)
+                {
+                  grid->edges[index] &= ~directions[d].edge;
+                  grid->edges[neighbor_index] &= ~directions[d].opposite;
+                  continue;
+                }
+
+              /* The weights kept by the nodes are updated along with the
+                 edges, as a neighbor may now be a different node */
+              squared_distance = get_squared_distance (neighbor, node);
+              if (squared_distance <
+                  (guint) grid->distance_threshold * grid->distance_threshold)
+                {
+                  grid->edges[index] |= directions[d].edge;
+                  grid->edges[neighbor_index] |= directions[d].opposite;
+                  set_edge_weight (node,
+                                   neighbor,
+                                   get_integer_sqrt (squared_distance));
+                }
+              else
+                {
+                  grid->edges[index] &= ~directions[d].edge;
+                  grid->edges[neighbor_index] &= ~directions[d].opposite;
+                  clear_edge_weight (node, neighbor);
+                }
+            }
+        }
+    }
+}
+
+static void
+rebuild_neighbors (NodeGrid *grid, guint i, guint j)
+{
+  Node *node;
+  guint d;
+  guint8 edges;
+
+  node = grid->nodes[j * grid->width + i];
+  if (node == NULL)
+    return;
+
+  g_list_free (node->neighbors);
+  node->neighbors = NULL;
+
+  edges = grid->edges[j * grid->width + i];
+  for (d = 0; d < NR_DIRECTIONS; d++)
+    {
+      if (edges & directions[d].edge)
+        {
+          guint neighbor_index = (j + directions[d].dj) * grid->width +
+            i + directions[d].di;
+          node->neighbors = g_list_prepend (node->neighbors,
+                                            grid->nodes[neighbor_index]);
+        }
+    }
+}
+
+static void
+rebuild_tile_neighbors (NodeGrid *grid, guint tile_x, guint tile_y)
+{
+  gint i, j, start_i, start_j, end_i, end_j;
+
+  /* Include the seam with the neighboring tiles */
+  start_i = MAX ((gint) (tile_x * NODE_GRID_TILE_SIZE) - 1, 0);
+  start_j = MAX ((gint) (tile_y * NODE_GRID_TILE_SIZE) - 1, 0);
+  end_i = MIN ((tile_x + 1) * NODE_GRID_TILE_SIZE + 1, grid->width);
+  end_j = MIN ((tile_y + 1) * NODE_GRID_TILE_SIZE + 1, grid->height);
+
+  for (j = start_j; j < end_j; j++)
+    {
+      for (i = start_i; i < end_i; i++)
+        {
+          rebuild_neighbors (grid, i, j);
+        }
+    }
+}
+
+static guint
+get_tile_index (NodeGrid *grid, guint i, guint j)
+{
+  return (j / NODE_GRID_TILE_SIZE) * get_nr_tiles (grid->width) +
+    i / NODE_GRID_TILE_SIZE;
+}
+
+/* Gives each node of the tile the component it belongs to when only
+   the edges inside the tile are followed */
+static void
+label_tile_components (NodeGrid *grid, guint tile_x, guint tile_y)
+{
+  guint i, j, d, start_i, start_j, end_i, end_j;
+  guint stack[NODE_GRID_TILE_CELLS];
+  guint8 nr_components = 0;
+
+  start_i = tile_x * NODE_GRID_TILE_SIZE;
+  start_j = tile_y * NODE_GRID_TILE_SIZE;
+  end_i = MIN (start_i + NODE_GRID_TILE_SIZE, grid->width);
+  end_j = MIN (start_j + NODE_GRID_TILE_SIZE, grid->height);
+
+  for (j = start_j; j < end_j; j++)
+    {
+      for (i = start_i; i < end_i; i++)
+        {
+          grid->components[j * grid->width + i] = NO_COMPONENT;
+        }
+    }
+
+  for (i = start_i; i < end_i; i++)
+    {
+      for (j = start_j; j < end_j; j++)
+        {
+          guint index, nr_stacked = 0;
+
+          index = j * grid->width + i;
+          if (grid->nodes[index] == NULL ||
+              grid->components[index] != NO_COMPONENT)
+            {
+              continue;
+            }
+
+          grid->components[index] = nr_components;
+          stack[nr_stacked++] = index;
+
+          while (nr_stacked > 0)
+            {
+              guint current, current_i, current_j;
+
+              current = stack[--nr_stacked];
+              current_i = current % grid->width;
+              current_j = current / grid->width;
+
+              for (d = 0; d < NR_DIRECTIONS; d++)
+                {
+                  guint neighbor_i, neighbor_j, neighbor_index;
+
+                  if (!(grid->edges[current] & directions[d].edge))
+                    continue;
+
+                  neighbor_i = current_i + directions[d].di;
+                  neighbor_j = current_j + directions[d].dj;
+                  if (neighbor_i < start_i || neighbor_i >= end_i ||
+                      neighbor_j < start_j || neighbor_j >= end_j)
+                    {
+                      continue;
+                    }
+
+                  neighbor_index = neighbor_j * grid->width + neighbor_i;
+                  if (grid->components[neighbor_index] != NO_COMPONENT)
+                    continue;
+
+                  grid->components[neighbor_index] = nr_components;
+                  stack[nr_stacked++] = neighbor_index;
+                }
+            }
+
+          nr_components++;
+        }
+    }
+
+  grid->nr_components[tile_y * get_nr_tiles (grid->width) + tile_x] =
+    nr_components;
+}
+
+static guint
+find_component (NodeGrid *grid, guint component)
+{
+  while (grid->parents[component] != component)
+    {
+      grid->parents[component] = grid->parents[grid->parents[component]];
+      component = grid->parents[component];
+    }
+
+  return component;
+}
+
+static guint
+get_cell_component (NodeGrid *grid, guint i, guint j)
+{
+  return get_tile_index (grid, i, j) * NODE_GRID_TILE_CELLS +
+    grid->components[j * grid->width + i];
+}
+
+static void
+join_cell_components (NodeGrid *grid, guint i, guint j)
+{
+  guint d;
+  guint8 edges;
+
+  edges = grid->edges[j * grid->width + i];
+  if (edges == 0)
+    return;
+
+  /* Each edge is followed only from the node it goes forward from */
+  for (d = NR_BACKWARD_DIRECTIONS; d < NR_DIRECTIONS; d++)
+    {
+      guint neighbor_i, neighbor_j, root, neighbor_root;
+
+      if (!(edges & directions[d].edge))
+        continue;
+
+      neighbor_i = i + directions[d].di;
+      neighbor_j = j + directions[d].dj;
+      if (neighbor_i / NODE_GRID_TILE_SIZE == i / NODE_GRID_TILE_SIZE &&
+          neighbor_j / NODE_GRID_TILE_SIZE == j / NODE_GRID_TILE_SIZE)
+        {
+          continue;
+        }
+
+      root = find_component (grid, get_cell_component (grid, i, j));
+      neighbor_root = find_component (grid,
+                                      get_cell_component (grid,
+                                                          neighbor_i,
+                                                          neighbor_j));
+      if (root < neighbor_root)
+        grid->parents[neighbor_root] = root;
+      else
+        grid->parents[root] = neighbor_root;
+    }
+}
+
+/* Joins the components of the tiles through the edges that cross
+   their seams, which start at the first or last rows or columns */
+static void
+join_tile_components (NodeGrid *grid, guint tile_x, guint tile_y)
+{
+  guint i, j, start_i, start_j, end_i, end_j;
+
+  start_i = tile_x * NODE_GRID_TILE_SIZE;
+  start_j = tile_y * NODE_GRID_TILE_SIZE;
+  end_i = MIN (start_i + NODE_GRID_TILE_SIZE, grid->width);
+  end_j = MIN (start_j + NODE_GRID_TILE_SIZE, grid->height);
+
+  for (j = start_j; j < end_j; j++)
+    {
+      if (j == start_j || j == end_j - 1)
+        {
+          for (i = start_i; i < end_i; i++)
+            {
+              if (grid->nodes[j * grid->width + i] != NULL)
+                join_cell_components (grid, i, j);
+            }
+        }
+      else if (grid->nodes[j * grid->width + end_i - 1] != NULL)
+        {
+          join_cell_components (grid, end_i - 1, j);
+        }
+    }
+}
+
+void
+update_node_grid (NodeGrid          *grid,
+                  const DepthBuffer *buffer,
+                  const Projection  *projection,
+                  guint16            distance_threshold,
+                  guint16            tolerance)
+{
+  guint i, tile_x, tile_y, tiles_x, tiles_y;
+  guint width, height, dimension_reduction;
+  gboolean reset;
+
+  width = projection->width;
+  height = projection->height;
+  dimension_reduction = projection->dimension_reduction;
+
+  reset = grid->nodes == NULL ||
+    grid->width != width ||
+    grid->height != height ||
+    grid->dimension_reduction != dimension_reduction ||
+    grid->distance_threshold != distance_threshold;
+
+  tiles_x = get_nr_tiles (width);
+  tiles_y = get_nr_tiles (height);
+
+  if (reset)
+    {
+      clean_node_grid (grid);
+
+      grid->width = width;
+      grid->height = height;
+      grid->dimension_reduction = dimension_reduction;
+      grid->distance_threshold = distance_threshold;
+      grid->buffer = g_slice_alloc0 (width * height * sizeof (guint16));
+      grid->nodes = g_slice_alloc0 (width * height * sizeof (Node *));
+      grid->edges = g_slice_alloc0 (width * height * sizeof (guint8));
+      grid->dirty_tiles = g_slice_alloc0 (tiles_x * tiles_y *
+                                          sizeof (gboolean));
+      grid->dirty_list = g_slice_alloc (tiles_x * tiles_y * sizeof (guint));
+      grid->components = g_slice_alloc (width * height * sizeof (guint8));
+      grid->nr_components = g_slice_alloc0 (tiles_x * tiles_y *
+                                            sizeof (guint8));
+      grid->parents = g_slice_alloc (tiles_x * tiles_y *
+                                     NODE_GRID_TILE_CELLS * sizeof (guint));
+      grid->labels = g_slice_alloc (tiles_x * tiles_y *
+                                    NODE_GRID_TILE_CELLS * sizeof (Label *));
+    }
+
+  grid->nr_dirty_tiles = 0;
+  for (tile_y = 0; tile_y < tiles_y; tile_y++)
+    {
+      for (tile_x = 0; tile_x < tiles_x; tile_x++)
+        {
+          gboolean dirty;
+          guint tile = tile_y * tiles_x + tile_x;
+
+          dirty = reset || tile_changed (grid,
+                                         buffer,
+                                         tile_x,
+                                         tile_y,
+                                         tolerance);
+
+          grid->dirty_tiles[tile] = dirty;
+          if (dirty)
+            {
+              grid->dirty_list[grid->nr_dirty_tiles++] = tile;
+              rebuild_tile_nodes (grid, buffer, projection, tile_x, tile_y);
+            }
+        }
+    }
+
+  for (i = 0; i < grid->nr_dirty_tiles; i++)
+    {
+      tile_x = grid->dirty_list[i] % tiles_x;
+      tile_y = grid->dirty_list[i] / tiles_x;
+      update_tile_edges (grid, tile_x, tile_y);
+    }
+
+  for (i = 0; i < grid->nr_dirty_tiles; i++)
+    {
+      tile_x = grid->dirty_list[i] % tiles_x;
+      tile_y = grid->dirty_list[i] / tiles_x;
+      rebuild_tile_neighbors (grid, tile_x, tile_y);
+      label_tile_components (grid, tile_x, tile_y);
+    }
+}
+
+/* Gives the nodes of the grid the label of the component they belong
+   to, returning them in the order of a scan of the buffer. Only the
+   components of the tiles are joined here, the ones inside each tile
+   are kept from the frames it did not change in. */
+GList *
+label_node_grid (NodeGrid *grid, GList **labels)
+{
+  guint i, j, tile, component, nr_tiles, tiles_x, tiles_y;
+  GList *nodes = NULL;
+  gint next_label = -1;
+
+  tiles_x = get_nr_tiles (grid->width);
+  tiles_y = get_nr_tiles (grid->height);
+  nr_tiles = tiles_x * tiles_y;
+
+  for (tile = 0; tile < nr_tiles; tile++)
+    {
+      for (component = 0; component < grid->nr_components[tile]; component++)
+        {
+          guint index = tile * NODE_GRID_TILE_CELLS + component;
+          grid->parents[index] = index;
+          grid->labels[index] = NULL;
+        }
+    }
+
+  for (tile = 0; tile < nr_tiles; tile++)
+    {
+      if (grid->nr_components[tile] > 0)
+        join_tile_components (grid, tile % tiles_x, tile / tiles_x);
+    }
+
+  /* Labels are created in the order their first node is found, as
+     when the nodes are labelled while scanning the buffer */
+  for (i = 0; i < grid->width; i++)
+    {
+      for (j = 0; j < grid->height; j++)
+        {
+          Node *node;
+          guint root;
+
+          node = grid->nodes[j * grid->width + i];
+          if (node == NULL)
+            continue;
+
+          root = find_component (grid, get_cell_component (grid, i, j));
+          if (grid->labels[root] == NULL)
+            {
+              next_label++;
+              grid->labels[root] = new_label (next_label);
+              *labels = g_list_prepend (*labels, grid->labels[root]);
+            }
+
+          node->label = grid->labels[root];
+          nodes = g_list_prepend (nodes, node);
+        }
+    }
+
+  return nodes;
+}
+
+/* Rebuilds the neighbors of a node, and of the nodes around it, from
+   the grid's edges, undoing any link added or removed while
+   tracking a frame */
+void
+restore_node_grid_neighbors (NodeGrid *grid, Node *node)
+{
+  gint i, j;
+
+  for (i = MAX (node->i - 1, 0); i <= node->i + 1 && i < grid->width; i++)
+    {
+      for (j = MAX (node->j - 1, 0); j <= node->j + 1 && j < grid->height; j++)
+        {
+          rebuild_neighbors (grid, i, j);
+        }
+    }
+}
+
+void
+clean_node_grid (NodeGrid *grid)
+{
+  guint i, size, nr_tiles;
+
+  if (grid->nodes == NULL)
+    return;
+
+  size = grid->width * grid->height;
+  for (i = 0; i < size; i++)
+    {
+      if (grid->nodes[i] != NULL)
+        free_node (grid->nodes[i], FALSE);
+    }
+
+  g_slice_free1 (size * sizeof (guint16), grid->buffer);
+  g_slice_free1 (size * sizeof (Node *), grid->nodes);
+  g_slice_free1 (size * sizeof (guint8), grid->edges);
+  nr_tiles = get_nr_tiles (grid->width) * get_nr_tiles (grid->height);
+  g_slice_free1 (nr_tiles * sizeof (gboolean), grid->dirty_tiles);
+  g_slice_free1 (nr_tiles * sizeof (guint), grid->dirty_list);
+  g_slice_free1 (size * sizeof (guint8), grid->components);
+  g_slice_free1 (nr_tiles * sizeof (guint8), grid->nr_components);
+  g_slice_free1 (nr_tiles * NODE_GRID_TILE_CELLS * sizeof (guint),
+                 grid->parents);
+  g_slice_free1 (nr_tiles * NODE_GRID_TILE_CELLS * sizeof (Label *),
+                 grid->labels);
+
+  grid->buffer = NULL;
+  grid->nodes = NULL;
+  grid->edges = NULL;
+  grid->dirty_tiles = NULL;
+  grid->dirty_list = NULL;
+  grid->nr_dirty_tiles = 0;
+  grid->components = NULL;
+  grid->nr_components = NULL;
+  grid->parents = NULL;
+  grid->labels = NULL;
+  grid->width = 0;
+  grid->height = 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * skeltrack-grid.h
+ *
+ * Skeltrack - A Free Software skeleton tracking library
+ * Copyright (C) 2012 Igalia S.L.
+ *
+ * Authors:
+ *  Joaquim Rocha <jrocha@igalia.com>
+ *  Eduardo Lima Mitev <elima@igalia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __SKELTRACK_GRID_H__
+#define __SKELTRACK_GRID_H__
+
+#include <glib.h>
+#include "skeltrack-util.h"
+
+/* Side, in cells, of the square tiles the grid is updated by */
+#define NODE_GRID_TILE_SIZE 8
+#define NODE_GRID_TILE_CELLS (NODE_GRID_TILE_SIZE * NODE_GRID_TILE_SIZE)
+
+typedef enum {
+  NODE_GRID_EDGE_W  = 1 << 0,
+  NODE_GRID_EDGE_SW = 1 << 1,
+  NODE_GRID_EDGE_N  = 1 << 2,
+  NODE_GRID_EDGE_NW = 1 << 3,
+  NODE_GRID_EDGE_S  = 1 << 4,
+  NODE_GRID_EDGE_NE = 1 << 5,
+  NODE_GRID_EDGE_E  = 1 << 6,
+  NODE_GRID_EDGE_SE = 1 << 7
+} NodeGridEdge;
+
+/* Nodes and edges kept across frames so only the tiles whose
+   depth changed need to be rebuilt. The components of each tile
+   are kept too, so only the ones of the changed tiles are labelled
+   again and then joined across the tiles' seams. */
+typedef struct {
+  guint width;
+  guint height;
+  guint16 dimension_reduction;
+  guint16 distance_threshold;
+  guint16 *buffer;
+  Node **nodes;
+  guint8 *edges;
+  gboolean *dirty_tiles;
+  guint *dirty_list;
+  guint nr_dirty_tiles;
+  guint8 *components;
+  guint8 *nr_components;
+  guint *parents;
+  Label **labels;
+} NodeGrid;
+
+void    update_node_grid            (NodeGrid          *grid,
+                                     const DepthBuffer *buffer,
+                                     const Projection  *projection,
+                                     guint16            distance_threshold,
+                                     guint16            tolerance);
+
+GList * label_node_grid             (NodeGrid          *grid,
+                                     GList            **labels);
+
+void    restore_node_grid_neighbors (NodeGrid          *grid,
+                                     Node              *node);
+
+void    clean_node_grid             (NodeGrid          *grid);
+
+#endif /* __SKELTRACK_GRID_H__ */
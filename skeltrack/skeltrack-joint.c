@@ -36,6 +36,22 @@
  * taking into account the #SkeltrackSkeleton:dimension-reduction (it will
  * be multiplied by this value).
  *
+ * The @confidence of a joint tells how reliable it is, from 0 to 1, so
+ * only the less reliable joints need to be checked by other means. It
+ * is taken from what was already computed to find the joint:
+ * the shoulders are given the part of the arc around the head that
+ * the user covers until them, and the head the average of theirs
+ * unless it was close to the head of the previous frame. The head and
+ * hands are also given the number of nodes around them, when
+ * #SkeltrackSkeleton:extrema-sphere-radius is not 0, compared to
+ * #SkeltrackSkeleton:graph-minimum-number-nodes; and the hands their
+ * distance along the arm from the shoulder, compared to
+ * #SkeltrackSkeleton:hands-minimum-distance. An elbow found on the way
+ * to its hand is as reliable as the hand, while one found at the end of
+ * the arm is scored like a hand. The other joints have a @confidence of
+ * 1. When smoothing, a joint that was not found keeps losing confidence
+ * while it persists.
+ *
  * The tracked list of joints is represented by #SkeltrackJointList and given
  * by skeltrack_skeleton_track_joints_finish().
  * To get a #SkeltrackJoint from a #SkeltrackJointList object, use the
@@ -66,6 +82,61 @@ skeltrack_joint_get_type (void)
   return type;
 }
 
+/**
+ * skeltrack_joint_mask_get_type:
+ *
+ * Returns: The registered #GType for #SkeltrackJointMask flags type
+ **/
+GType
+skeltrack_joint_mask_get_type (void)
+{
+  static GType type = 0;
+  static const GFlagsValue values[] =
+    {
+      { SKELTRACK_JOINT_MASK_HEAD,
+        "SKELTRACK_JOINT_MASK_HEAD", "head" },
+      { SKELTRACK_JOINT_MASK_LEFT_SHOULDER,
+        "SKELTRACK_JOINT_MASK_LEFT_SHOULDER", "left-shoulder" },
+      { SKELTRACK_JOINT_MASK_RIGHT_SHOULDER,
+        "SKELTRACK_JOINT_MASK_RIGHT_SHOULDER", "right-shoulder" },
+      { SKELTRACK_JOINT_MASK_LEFT_ELBOW,
+        "SKELTRACK_JOINT_MASK_LEFT_ELBOW", "left-elbow" },
+      { SKELTRACK_JOINT_MASK_RIGHT_ELBOW,
+        "SKELTRACK_JOINT_MASK_RIGHT_ELBOW", "right-elbow" },
+      { SKELTRACK_JOINT_MASK_LEFT_HAND,
+        "SKELTRACK_JOINT_MASK_LEFT_HAND", "left-hand" },
+      { SKELTRACK_JOINT_MASK_RIGHT_HAND,
+        "SKELTRACK_JOINT_MASK_RIGHT_HAND", "right-hand" },
+      { SKELTRACK_JOINT_MASK_TORSO,
+        "SKELTRACK_JOINT_MASK_TORSO", "torso" },
+      { SKELTRACK_JOINT_MASK_LEFT_HIP,
+        "SKELTRACK_JOINT_MASK_LEFT_HIP", "left-hip" },
+      { SKELTRACK_JOINT_MASK_RIGHT_HIP,
+        "SKELTRACK_JOINT_MASK_RIGHT_HIP", "right-hip" },
+      { SKELTRACK_JOINT_MASK_LEFT_KNEE,
+        "SKELTRACK_JOINT_MASK_LEFT_KNEE", "left-knee" },
+      { SKELTRACK_JOINT_MASK_RIGHT_KNEE,
+        "SKELTRACK_JOINT_MASK_RIGHT_KNEE", "right-knee" },
+      { SKELTRACK_JOINT_MASK_LEFT_FOOT,
+        "SKELTRACK_JOINT_MASK_LEFT_FOOT", "left-foot" },
+      { SKELTRACK_JOINT_MASK_RIGHT_FOOT,
+        "SKELTRACK_JOINT_MASK_RIGHT_FOOT", "right-foot" },
+      { SKELTRACK_JOINT_MASK_HEAD_AND_HANDS,
+        "SKELTRACK_JOINT_MASK_HEAD_AND_HANDS", "head-and-hands" },
+      { SKELTRACK_JOINT_MASK_UPPER_BODY,
+        "SKELTRACK_JOINT_MASK_UPPER_BODY", "upper-body" },
+      { SKELTRACK_JOINT_MASK_LOWER_BODY,
+        "SKELTRACK_JOINT_MASK_LOWER_BODY", "lower-body" },
+      { SKELTRACK_JOINT_MASK_ALL,
+        "SKELTRACK_JOINT_MASK_ALL", "all" },
+      { 0, NULL, NULL }
+    };
+
+  if (G_UNLIKELY (type == 0))
+    type = g_flags_register_static ("SkeltrackJointMask", values);
+  return type;
+}
+
 /**
  * skeltrack_joint_copy:
  * @joint: The #SkeltrackJoint to copy
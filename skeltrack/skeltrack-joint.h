@@ -29,7 +29,8 @@
 G_BEGIN_DECLS
 
 #define SKELTRACK_TYPE_JOINT (skeltrack_joint_get_type ())
-#define SKELTRACK_JOINT_MAX_JOINTS 7
+#define SKELTRACK_TYPE_JOINT_MASK (skeltrack_joint_mask_get_type ())
+#define SKELTRACK_JOINT_MAX_JOINTS 14
 
 typedef struct _SkeltrackJoint SkeltrackJoint;
 typedef SkeltrackJoint **SkeltrackJointList;
@@ -43,8 +44,16 @@ typedef SkeltrackJoint **SkeltrackJointList;
  * @SKELTRACK_JOINT_ID_RIGHT_ELBOW: The right elbow
  * @SKELTRACK_JOINT_ID_LEFT_HAND: The left hand
  * @SKELTRACK_JOINT_ID_RIGHT_HAND: The right hand
+ * @SKELTRACK_JOINT_ID_TORSO: The center of the torso
+ * @SKELTRACK_JOINT_ID_LEFT_HIP: The left hip
+ * @SKELTRACK_JOINT_ID_RIGHT_HIP: The right hip
+ * @SKELTRACK_JOINT_ID_LEFT_KNEE: The left knee
+ * @SKELTRACK_JOINT_ID_RIGHT_KNEE: The right knee
+ * @SKELTRACK_JOINT_ID_LEFT_FOOT: The left foot
+ * @SKELTRACK_JOINT_ID_RIGHT_FOOT: The right foot
  *
- * Available joint ids.
+ * Available joint ids. The torso and lower body joints are only tracked
+ * when requested by #SkeltrackSkeleton:joint-mask.
  **/
 typedef enum {
   SKELTRACK_JOINT_ID_HEAD,
@@ -53,9 +62,68 @@ typedef enum {
   SKELTRACK_JOINT_ID_LEFT_ELBOW,
   SKELTRACK_JOINT_ID_RIGHT_ELBOW,
   SKELTRACK_JOINT_ID_LEFT_HAND,
-  SKELTRACK_JOINT_ID_RIGHT_HAND
+  SKELTRACK_JOINT_ID_RIGHT_HAND,
+  SKELTRACK_JOINT_ID_TORSO,
+  SKELTRACK_JOINT_ID_LEFT_HIP,
+  SKELTRACK_JOINT_ID_RIGHT_HIP,
+  SKELTRACK_JOINT_ID_LEFT_KNEE,
+  SKELTRACK_JOINT_ID_RIGHT_KNEE,
+  SKELTRACK_JOINT_ID_LEFT_FOOT,
+  SKELTRACK_JOINT_ID_RIGHT_FOOT
 } SkeltrackJointId;
 
+/**
+ * SkeltrackJointMask:
+ * @SKELTRACK_JOINT_MASK_HEAD: The head
+ * @SKELTRACK_JOINT_MASK_LEFT_SHOULDER: The left shoulder
+ * @SKELTRACK_JOINT_MASK_RIGHT_SHOULDER: The right shoulder
+ * @SKELTRACK_JOINT_MASK_LEFT_ELBOW: The left elbow
+ * @SKELTRACK_JOINT_MASK_RIGHT_ELBOW: The right elbow
+ * @SKELTRACK_JOINT_MASK_LEFT_HAND: The left hand
+ * @SKELTRACK_JOINT_MASK_RIGHT_HAND: The right hand
+ * @SKELTRACK_JOINT_MASK_TORSO: The center of the torso
+ * @SKELTRACK_JOINT_MASK_LEFT_HIP: The left hip
+ * @SKELTRACK_JOINT_MASK_RIGHT_HIP: The right hip
+ * @SKELTRACK_JOINT_MASK_LEFT_KNEE: The left knee
+ * @SKELTRACK_JOINT_MASK_RIGHT_KNEE: The right knee
+ * @SKELTRACK_JOINT_MASK_LEFT_FOOT: The left foot
+ * @SKELTRACK_JOINT_MASK_RIGHT_FOOT: The right foot
+ * @SKELTRACK_JOINT_MASK_HEAD_AND_HANDS: The head and both hands
+ * @SKELTRACK_JOINT_MASK_UPPER_BODY: The head, shoulders, elbows and hands
+ * @SKELTRACK_JOINT_MASK_LOWER_BODY: The hips, knees and feet
+ * @SKELTRACK_JOINT_MASK_ALL: All the joints
+ *
+ * Sets of joints to track, given by #SkeltrackSkeleton:joint-mask. The
+ * flag of each joint is 1 shifted by its #SkeltrackJointId.
+ **/
+typedef enum {
+  SKELTRACK_JOINT_MASK_HEAD           = 1 << SKELTRACK_JOINT_ID_HEAD,
+  SKELTRACK_JOINT_MASK_LEFT_SHOULDER  = 1 << SKELTRACK_JOINT_ID_LEFT_SHOULDER,
+  SKELTRACK_JOINT_MASK_RIGHT_SHOULDER = 1 << SKELTRACK_JOINT_ID_RIGHT_SHOULDER,
+  SKELTRACK_JOINT_MASK_LEFT_ELBOW     = 1 << SKELTRACK_JOINT_ID_LEFT_ELBOW,
+  SKELTRACK_JOINT_MASK_RIGHT_ELBOW    = 1 << SKELTRACK_JOINT_ID_RIGHT_ELBOW,
+  SKELTRACK_JOINT_MASK_LEFT_HAND      = 1 << SKELTRACK_JOINT_ID_LEFT_HAND,
+  SKELTRACK_JOINT_MASK_RIGHT_HAND     = 1 << SKELTRACK_JOINT_ID_RIGHT_HAND,
+  SKELTRACK_JOINT_MASK_TORSO          = 1 << SKELTRACK_JOINT_ID_TORSO,
+  SKELTRACK_JOINT_MASK_LEFT_HIP       = 1 << SKELTRACK_JOINT_ID_LEFT_HIP,
+  SKELTRACK_JOINT_MASK_RIGHT_HIP      = 1 << SKELTRACK_JOINT_ID_RIGHT_HIP,
+  SKELTRACK_JOINT_MASK_LEFT_KNEE      = 1 << SKELTRACK_JOINT_ID_LEFT_KNEE,
+  SKELTRACK_JOINT_MASK_RIGHT_KNEE     = 1 << SKELTRACK_JOINT_ID_RIGHT_KNEE,
+  SKELTRACK_JOINT_MASK_LEFT_FOOT      = 1 << SKELTRACK_JOINT_ID_LEFT_FOOT,
+  SKELTRACK_JOINT_MASK_RIGHT_FOOT     = 1 << SKELTRACK_JOINT_ID_RIGHT_FOOT,
+  SKELTRACK_JOINT_MASK_HEAD_AND_HANDS = SKELTRACK_JOINT_MASK_HEAD |
+                                        SKELTRACK_JOINT_MASK_LEFT_HAND |
+                                        SKELTRACK_JOINT_MASK_RIGHT_HAND,
+  SKELTRACK_JOINT_MASK_UPPER_BODY     = (1 << SKELTRACK_JOINT_ID_TORSO) - 1,
+  SKELTRACK_JOINT_MASK_LOWER_BODY     = SKELTRACK_JOINT_MASK_LEFT_HIP |
+                                        SKELTRACK_JOINT_MASK_RIGHT_HIP |
+                                        SKELTRACK_JOINT_MASK_LEFT_KNEE |
+                                        SKELTRACK_JOINT_MASK_RIGHT_KNEE |
+                                        SKELTRACK_JOINT_MASK_LEFT_FOOT |
+                                        SKELTRACK_JOINT_MASK_RIGHT_FOOT,
+  SKELTRACK_JOINT_MASK_ALL            = (1 << SKELTRACK_JOINT_MAX_JOINTS) - 1
+} SkeltrackJointMask;
+
 /**
  * SkeltrackJoint:
  * @id: The id of the joint
@@ -64,6 +132,7 @@ typedef enum {
  * @z: The z coordinate of the joint in the space (in mm)
  * @screen_x: The x coordinate of the joint in the screen (in pixels)
  * @screen_y: The y coordinate of the joint in the screen (in pixels)
+ * @confidence: How reliable the joint is, from 0 to 1
  **/
 struct _SkeltrackJoint
 {
@@ -75,9 +144,12 @@ struct _SkeltrackJoint
 
   gint screen_x;
   gint screen_y;
+
+  gfloat confidence;
 };
 
 GType                skeltrack_joint_get_type          (void);
+GType                skeltrack_joint_mask_get_type     (void);
 gpointer             skeltrack_joint_copy              (SkeltrackJoint    *joint);
 void                 skeltrack_joint_free              (SkeltrackJoint    *joint);
 void                 skeltrack_joint_list_free         (SkeltrackJointList list);
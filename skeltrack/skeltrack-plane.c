@@ -0,0 +1,317 @@
+/*
+ * skeltrack-plane.c
+ *
+ * Skeltrack - A Free Software skeleton tracking library
+ * Copyright (C) 2012 Igalia S.L.
+ *
+ * Authors:
+ *  Joaquim Rocha <jrocha@igalia.com>
+ *  Eduardo Lima Mitev <elima@igalia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#include <glib.h>
+#include <math.h>
+
+#include "skeltrack-plane.h"
+
+/* Number of points the planes are fitted to */
+#define PLANE_SAMPLE_SIZE 256
+
+/* Number of random planes tried for each dominant plane */
+#define PLANE_ITERATIONS 64
+
+/* Fraction of the sampled points, not in a previous plane, that a
+   plane needs to be dominant */
+#define PLANE_MIN_INLIERS .4
+
+/* Size (in mm) a plane needs to span, so a person facing the
+   camera is not taken for one */
+#define PLANE_MIN_EXTENT 2000
+
+typedef struct {
+  gfloat x;
+  gfloat y;
+  gfloat z;
+  gboolean used;
+} SamplePoint;
+
+static gfloat
+get_plane_distance (const Plane *plane, gfloat x, gfloat y, gfloat z)
+{
+  return fabsf (plane->normal[0] * x + plane->normal[1] * y +
+                plane->normal[2] * z + plane->offset);
+}
+
+static gboolean
+get_plane_from_points (const SamplePoint *a,
+                       const SamplePoint *b,
+                       const SamplePoint *c,
+                       Plane *plane)
+{
+  gfloat u[3], v[3], length;
+
+  u[0] = b->x - a->x;
+  u[1] = b->y - a->y;
+  u[2] = b->z - a->z;
+  v[0] = c->x - a->x;
+  v[1] = c->y - a->y;
+  v[2] = c->z - a->z;
+
+  plane->normal[0] = u[1] * v[2] - u[2] * v[1];
+  plane->normal[1] = u[2] * v[0] - u[0] * v[2];
+  plane->normal[2] = u[0] * v[1] - u[1] * v[0];
+
+  length = sqrtf (plane->normal[0] * plane->normal[0] +
+                  plane->normal[1] * plane->normal[1] +
+                  plane->normal[2] * plane->normal[2]);
+  if (length == 0)
+    return FALSE;
+
+  plane->normal[0] /= length;
+  plane->normal[1] /= length;
+  plane->normal[2] /= length;
+  plane->offset = - (plane->normal[0] * a->x +
+                     plane->normal[1] * a->y +
+                     plane->normal[2] * a->z);
+
+  return TRUE;
+}
+
+/* Counts the points not used by a previous plane that are in the
+   given one, or returns 0 if they do not span a large enough area */
+static guint
+count_inliers (const Plane *plane,
+               const SamplePoint *points,
+               guint nr_points,
+               guint16 tolerance)
+{
+  guint i, count = 0;
+  gfloat min[3] = {G_MAXFLOAT, G_MAXFLOAT, G_MAXFLOAT};
+  gfloat max[3] = {-G_MAXFLOAT, -G_MAXFLOAT, -G_MAXFLOAT};
+
+  for (i = 0; i < nr_points; i++)
+    {
+      if (points[i].used ||
+          get_plane_distance (plane, points[i].x, points[i].y, points[i].z) >
+          tolerance)
+        {
+          continue;
+        }
+
+      min[0] = MIN (min[0], points[i].x);
+      min[1] = MIN (min[1], points[i].y);
+      min[2] = MIN (min[2], points[i].z);
+      max[0] = MAX (max[0], points[i].x);
+      max[1] = MAX (max[1], points[i].y);
+      max[2] = MAX (max[2], points[i].z);
+      count++;
+    }
+
+  if (count == 0 ||
+      (max[0] - min[0] < PLANE_MIN_EXTENT &&
+       max[1] - min[1] < PLANE_MIN_EXTENT &&
+       max[2] - min[2] < PLANE_MIN_EXTENT))
+    {
+      return 0;
+    }
+
+  return count;
+}
+
+static guint
+sample_points (PlaneModel *model,
+               const DepthBuffer *buffer,
+               const Projection *projection,
+               SamplePoint *points)
+{
+  guint attempt, nr_points = 0;
+
+  for (attempt = 0;
+       attempt < 4 * PLANE_SAMPLE_SIZE && nr_points < PLANE_SAMPLE_SIZE;
+       attempt++)
+    {
+      guint i, j;
+      gint x, y;
+      guint16 value;
+
+      i = g_rand_int_range (model->rand, 0, model->width);
+      j = g_rand_int_range (model->rand, 0, model->height);
+      value = get_depth_value (buffer, i, j);
+      if (value == 0)
+        continue;
+
+      convert_screen_coords_to_mm (projection, i, j, value, &x, &y);
+      points[nr_points].x = x;
+      points[nr_points].y = y;
+      points[nr_points].z = value;
+      points[nr_points].used = FALSE;
+      nr_points++;
+    }
+
+  return nr_points;
+}
+
+/* Finds the plane with the most inliers among the points not used by
+   a previous plane, starting with the given one from the last frame */
+static gboolean
+find_dominant_plane (PlaneModel *model,
+                     SamplePoint *points,
+                     guint nr_points,
+                     const Plane *previous_plane,
+                     guint16 tolerance,
+                     Plane *plane)
+{
+  guint iteration, i, nr_unused = 0, best_inliers = 0;
+
+  for (i = 0; i < nr_points; i++)
+    {
+      if (! points[i].used)
+        nr_unused++;
+    }
+
+  if (previous_plane != NULL)
+    {
+      *plane = *previous_plane;
+      best_inliers = count_inliers (plane, points, nr_points, tolerance);
+    }
+
+  for (iteration = 0; iteration < PLANE_ITERATIONS; iteration++)
+    {
+      Plane candidate;
+      guint a, b, c, inliers;
+
+      a = g_rand_int_range (model->rand, 0, nr_points);
+      b = g_rand_int_range (model->rand, 0, nr_points);
+      c = g_rand_int_range (model->rand, 0, nr_points);
+      if (points[a].used || points[b].used || points[c].used ||
+          ! get_plane_from_points (&points[a], &points[b], &points[c],
+                                   &candidate))
+        {
+          continue;
+        }
+
+      inliers = count_inliers (&candidate, points, nr_points, tolerance);
+      if (inliers > best_inliers)
+        {
+          *plane = candidate;
+          best_inliers = inliers;
+        }
+    }
+
+  if (best_inliers == 0 || best_inliers < PLANE_MIN_INLIERS * nr_unused)
+    return FALSE;
+
+  for (i = 0; i < nr_points; i++)
+    {
+      if (get_plane_distance (plane, points[i].x, points[i].y, points[i].z) <=
+          tolerance)
+        {
+          points[i].used = TRUE;
+        }
+    }
+
+  return TRUE;
+}
+
+/* Writes the buffer into the model's output buffer, with the points
+   that are within the tolerance (in mm) of up to max_planes dominant
+   planes, like the floor or a wall, set to 0. The planes are fitted
+   with RANSAC to a random sample of the points; a plane needs to hold
+   a significant part of them and to be larger than a person. */
+void
+remove_planes (PlaneModel        *model,
+               const DepthBuffer *buffer,
+               const Projection  *projection,
+               guint              max_planes,
+               guint16            tolerance)
+{
+  SamplePoint points[PLANE_SAMPLE_SIZE];
+  Plane planes[PLANE_REMOVAL_MAX_PLANES];
+  guint i, j, k, nr_points, nr_planes = 0;
+
+  if (model->width != projection->width ||
+      model->height != projection->height)
+    {
+      clean_plane_model (model);
+
+      model->width = projection->width;
+      model->height = projection->height;
+      model->output = g_slice_alloc (model->width * model->height *
+                                     sizeof (guint16));
+      model->rand = g_rand_new_with_seed (0);
+    }
+
+  max_planes = MIN (max_planes, PLANE_REMOVAL_MAX_PLANES);
+
+  nr_points = sample_points (model, buffer, projection, points);
+  if (nr_points >= 3)
+    {
+      while (nr_planes < max_planes &&
+             find_dominant_plane (model,
+                                  points,
+                                  nr_points,
+                                  nr_planes < model->nr_planes ?
+                                  &model->planes[nr_planes] : NULL,
+                                  tolerance,
+                                  &planes[nr_planes]))
+        {
+          nr_planes++;
+        }
+    }
+
+  for (k = 0; k < nr_planes; k++)
+    model->planes[k] = planes[k];
+  model->nr_planes = nr_planes;
+
+  for (j = 0; j < model->height; j++)
+    {
+      for (i = 0; i < model->width; i++)
+        {
+          guint16 value;
+          gint x, y;
+
+          value = get_depth_value (buffer, i, j);
+          model->output[j * model->width + i] = value;
+          if (value == 0 || nr_planes == 0)
+            continue;
+
+          convert_screen_coords_to_mm (projection, i, j, value, &x, &y);
+          for (k = 0; k < nr_planes; k++)
+            {
+              if (get_plane_distance (&planes[k], x, y, value) <= tolerance)
+                {
+                  model->output[j * model->width + i] = 0;
+                  break;
+                }
+            }
+        }
+    }
+}
+
+void
+clean_plane_model (PlaneModel *model)
+{
+  if (model->output == NULL)
+    return;
+
+  g_slice_free1 (model->width * model->height * sizeof (guint16),
+                 model->output);
+  g_rand_free (model->rand);
+
+  model->output = NULL;
+  model->rand = NULL;
+  model->nr_planes = 0;
+  model->width = 0;
+  model->height = 0;
+}
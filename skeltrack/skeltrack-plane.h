@@ -0,0 +1,57 @@
+/*
+ * skeltrack-plane.h
+ *
+ * Skeltrack - A Free Software skeleton tracking library
+ * Copyright (C) 2012 Igalia S.L.
+ *
+ * Authors:
+ *  Joaquim Rocha <jrocha@igalia.com>
+ *  Eduardo Lima Mitev <elima@igalia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License at http://www.gnu.org/licenses/lgpl-3.0.txt
+ * for more details.
+ */
+
+#ifndef __SKELTRACK_PLANE_H__
+#define __SKELTRACK_PLANE_H__
+
+#include <glib.h>
+#include "skeltrack-util.h"
+
+#define PLANE_REMOVAL_MAX_PLANES 2
+
+/* The points (x, y, z) of the plane, in mm, are those where
+   normal . (x, y, z) + offset = 0 */
+typedef struct {
+  gfloat normal[3];
+  gfloat offset;
+} Plane;
+
+/* The dominant planes found in the last frame, which are tried first
+   in the next one */
+typedef struct {
+  guint width;
+  guint height;
+  guint16 *output;
+  GRand *rand;
+  Plane planes[PLANE_REMOVAL_MAX_PLANES];
+  guint nr_planes;
+} PlaneModel;
+
+void    remove_planes             (PlaneModel        *model,
+                                   const DepthBuffer *buffer,
+                                   const Projection  *projection,
+                                   guint              max_planes,
+                                   guint16            tolerance);
+
+void    clean_plane_model         (PlaneModel        *model);
+
+#endif /* __SKELTRACK_PLANE_H__ */
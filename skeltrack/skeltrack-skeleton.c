@@ -40,8 +40,10 @@
  *
  * Tracking the skeleton joints can be computational heavy so it is advised that
  * the given buffer's dimension is reduced before setting it. To do it,
- * simply choose the reduction factor and loop through the original buffer
- * (using this factor as a step) and set the reduced buffer's values accordingly.
+ * choose the reduction factor and use skeltrack_depth_reduce_buffer(), or
+ * give the full resolution buffer to skeltrack_skeleton_track_joints_full(),
+ * which reduces it while reading it and also reads other depth formats and
+ * row strides.
  * The #SkeltrackSkeleton:dimension-reduction property holds this reduction
  * value and should be changed to the reduction factor used (alternatively you
  * can retrieve its default value and use it in the reduction, if it fits your
@@ -55,7 +57,30 @@
  * #SkeltrackSkeleton:shoulders-arc-start-point ,
  * #SkeltrackSkeleton:shoulders-arc-length ,
  * #SkeltrackSkeleton:shoulders-circumference-radius ,
- * #SkeltrackSkeleton:shoulders-search-step .
+ * #SkeltrackSkeleton:shoulders-search-step ,
+ * #SkeltrackSkeleton:torso-minimum-number-nodes ,
+ * #SkeltrackSkeleton:extrema-sphere-radius ,
+ * #SkeltrackSkeleton:region-of-interest-margin ,
+ * #SkeltrackSkeleton:incremental-graph-tolerance ,
+ * #SkeltrackSkeleton:static-scene-tolerance ,
+ * #SkeltrackSkeleton:pyramid-factor ,
+ * #SkeltrackSkeleton:hand-refinement-radius ,
+ * #SkeltrackSkeleton:hole-filling-min-neighbors ,
+ * #SkeltrackSkeleton:background-tolerance ,
+ * #SkeltrackSkeleton:background-learning-frames ,
+ * #SkeltrackSkeleton:background-absorption-frames ,
+ * #SkeltrackSkeleton:plane-removal-tolerance ,
+ * #SkeltrackSkeleton:plane-removal-max-planes ,
+ * #SkeltrackSkeleton:depth-gating-max-band ,
+ * #SkeltrackSkeleton:adaptive-graph-max-cell-size ,
+ * #SkeltrackSkeleton:adaptive-graph-tolerance ,
+ * #SkeltrackSkeleton:prediction-interval ,
+ * #SkeltrackSkeleton:prediction-tolerance .
+ *
+ * The stages that prepare the buffer, and the ones that make the tracking
+ * cheaper, are enabled with the enable-* properties, like
+ * #SkeltrackSkeleton:enable-region-of-interest or
+ * #SkeltrackSkeleton:enable-background-subtraction .
  **/
 #include <string.h>
 #include <math.h>
@@ -63,6 +88,10 @@
 
 #include "skeltrack-skeleton.h"
 #include "skeltrack-smooth.h"
+#include "skeltrack-grid.h"
+#include "skeltrack-filter.h"
+#include "skeltrack-background.h"
+#include "skeltrack-plane.h"
 #include "skeltrack-util.h"
 
 #define SKELTRACK_SKELETON_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), \
@@ -83,11 +112,91 @@
 #define DEFAULT_FOCUS_POINT_Z 1000
 #define TORSO_MINIMUM_NUMBER_NODES_DEFAULT 16.0
 #define EXTREMA_SPHERE_RADIUS 300
+#define ENABLE_REGION_OF_INTEREST_DEFAULT FALSE
+#define REGION_OF_INTEREST_MARGIN 300
+#define REGION_OF_INTEREST_VELOCITY_FACTOR 2
+#define ENABLE_INCREMENTAL_GRAPH_DEFAULT FALSE
+#define INCREMENTAL_GRAPH_TOLERANCE 0
+#define ENABLE_STATIC_SCENE_DETECTION_DEFAULT FALSE
+#define STATIC_SCENE_TOLERANCE 5
+#define STATIC_SCENE_MAXIMUM_CHANGES 0
+#define ENABLE_PYRAMID_DEFAULT FALSE
+#define PYRAMID_FACTOR 2
+#define PYRAMID_REFINEMENT_RADIUS 50
+#define HAND_REFINEMENT_RADIUS 60
+#define ENABLE_MEDIAN_FILTER_DEFAULT FALSE
+#define ENABLE_HOLE_FILLING_DEFAULT FALSE
+#define HOLE_FILLING_MIN_NEIGHBORS 5
+#define ENABLE_BACKGROUND_SUBTRACTION_DEFAULT FALSE
+#define BACKGROUND_TOLERANCE 50
+#define BACKGROUND_LEARNING_FRAMES 30
+#define BACKGROUND_ABSORPTION_FRAMES 900
+#define ENABLE_PLANE_REMOVAL_DEFAULT FALSE
+#define PLANE_REMOVAL_TOLERANCE 30
+#define PLANE_REMOVAL_MAX_PLANES_DEFAULT 2
+#define ENABLE_DEPTH_GATING_DEFAULT FALSE
+#define DEPTH_GATING_MAX_BAND 800
+#define ENABLE_ADAPTIVE_GRAPH_DEFAULT FALSE
+#define ADAPTIVE_GRAPH_MAX_CELL_SIZE 4
+#define ADAPTIVE_GRAPH_TOLERANCE 30
+#define ENABLE_TEMPORAL_ARM_ASSIGNMENT_DEFAULT FALSE
+/* How much shorter (in mm) the path to an extrema has to be from the
+   shoulder of its arm than from the other one to keep the assignment */
+#define ARM_ASSIGNMENT_MINIMUM_MARGIN 100
+/* The farthest (in mm) an extrema can move from one frame to the next
+   and still be given to the same arm */
+#define ARM_ASSIGNMENT_MAXIMUM_DISPLACEMENT 100
+/* Frames after which the paths from both shoulders are compared again */
+#define ARM_ASSIGNMENT_MAXIMUM_REUSES 10
+#define ENABLE_PREDICTION_DEFAULT FALSE
+#define PREDICTION_INTERVAL 2
+#define PREDICTION_TOLERANCE 100
+/* Radius, in points of the buffer, around a predicted joint where its
+   depth is looked for */
+#define PREDICTION_CHECK_RADIUS 1
+#define PREDICTION_MINIMUM_CONFIDENCE .5
+/* Fraction of the length of a leg, from where the legs split, at which
+   its knee is, and at which the hip is above the split */
+#define LEG_HIP_FRACTION .1
+#define LEG_KNEE_FRACTION .5
+#define JOINT_MASK_DEFAULT SKELTRACK_JOINT_MASK_UPPER_BODY
+#define JOINT_MASK_ARMS (SKELTRACK_JOINT_MASK_LEFT_ELBOW | \
+                         SKELTRACK_JOINT_MASK_RIGHT_ELBOW | \
+                         SKELTRACK_JOINT_MASK_LEFT_HAND | \
+                         SKELTRACK_JOINT_MASK_RIGHT_HAND)
+#define MAX_USERS_DEFAULT 2
+/* The farthest (in mm) the center of a user can move from one frame
+   to the next and still be given the same id */
+#define USER_MAXIMUM_DISPLACEMENT 500
+
+/* The extremas given to each arm in the previous frame */
+typedef struct {
+  gboolean valid;
+  guint reuses;
+  SkeltrackJoint left;
+  SkeltrackJoint right;
+} ArmAssignment;
+
+/* What is kept of a user between frames, with what lets each of the
+   users tracked by track_users() keep its id */
+typedef struct {
+  gboolean active;
+  gboolean found;
+  guint missing_frames;
+  gint x;
+  gint y;
+  gint z;
+  SkeltrackJoint *previous_head;
+  ArmAssignment arm_assignment;
+  SmoothData smooth_data;
+} TrackedUser;
 
 /* private data */
 struct _SkeltrackSkeletonPrivate
 {
-  guint16 *buffer;
+  DepthBuffer buffer;
+  const SkeltrackDepthPoint *points;
+  guint nr_points;
   guint buffer_width;
   guint buffer_height;
 
@@ -110,21 +219,110 @@ struct _SkeltrackSkeletonPrivate
   guint16 shoulders_arc_start_point;
   guint16 shoulders_arc_length;
   gfloat shoulders_search_step;
+  /* Cosine and sine of each step of the shoulders search, for the
+     step and number of steps they were computed for */
+  gdouble *shoulders_arc;
+  gfloat shoulders_arc_step;
+  guint shoulders_arc_nr_steps;
 
   guint16 extrema_sphere_radius;
 
   Node *focus_node;
 
   gboolean enable_smoothing;
-  SmoothData smooth_data;
 
   gfloat torso_minimum_number_nodes;
 
-  SkeltrackJoint *previous_head;
+  /* What is kept of the user between frames when tracking a single
+     one */
+  TrackedUser single_user;
+  SkeltrackJointList previous_joints;
+
+  gboolean enable_region_of_interest;
+  guint16 region_of_interest_margin;
+
+  gboolean enable_incremental_graph;
+  guint16 incremental_graph_tolerance;
+  NodeGrid node_grid;
+  gboolean graph_is_persistent;
+  GList *detached_nodes;
+
+  gboolean enable_static_scene_detection;
+  guint16 static_scene_tolerance;
+  guint skipped_frames;
+  guint16 *frame_signature;
+  guint frame_signature_width;
+  guint frame_signature_height;
+
+  gboolean enable_pyramid;
+  guint16 pyramid_factor;
+
+  guint16 hand_refinement_radius;
+
+  SkeltrackCameraIntrinsics *camera_intrinsics;
+  /* Set while a buffer may be tracked in another thread, so it only
+     replaces camera_intrinsics when the next one is tracked */
+  SkeltrackCameraIntrinsics *new_camera_intrinsics;
+  gboolean camera_intrinsics_changed;
+  Projection projection;
+  Projection fine_projection;
+
+  gboolean enable_median_filter;
+  gboolean enable_hole_filling;
+  guint16 hole_filling_min_neighbors;
+  guint16 *filtered_buffers[2];
+  guint filtered_width;
+  guint filtered_height;
+
+  gboolean enable_background_subtraction;
+  guint16 background_tolerance;
+  guint16 background_learning_frames;
+  guint16 background_absorption_frames;
+  BackgroundModel background_model;
+  /* Set when the model has to be learned again, which is only done
+     when the next buffer is tracked */
+  gboolean background_model_changed;
+
+  gboolean enable_plane_removal;
+  guint16 plane_removal_tolerance;
+  guint16 plane_removal_max_planes;
+  PlaneModel plane_model;
+
+  gboolean enable_depth_gating;
+  guint16 depth_gating_max_band;
+
+  gboolean enable_adaptive_graph;
+  guint16 adaptive_graph_max_cell_size;
+  guint16 adaptive_graph_tolerance;
+  guint graph_nodes;
+
+  gboolean enable_temporal_arm_assignment;
+
+  gboolean enable_prediction;
+  guint16 prediction_interval;
+  guint16 prediction_tolerance;
+  guint predicted_frames;
+  guint frames_since_tracking;
+
+  SkeltrackJointMask joint_mask;
+
+  guint16 max_users;
+  TrackedUser *users;
+  guint nr_users;
+  /* The user whose joints are tracked, whose nodes are the only ones
+     taken from the node matrix, or NULL when tracking a single user */
+  Label *user_label;
+  /* What is kept between frames of the user whose joints are tracked,
+     which is single_user unless in the copies made by track_users() */
+  TrackedUser *user;
+  GThreadPool *users_pool;
+  GMutex users_mutex;
+  GCond users_cond;
+  guint nr_pending_users;
 };
 
 /* Currently searches for head and hands */
-static const guint NR_EXTREMAS_TO_SEARCH  = 3;
+#define NR_EXTREMAS_TO_SEARCH 3
 
 /* properties */
 enum
@@ -142,7 +340,41 @@ enum
     PROP_SMOOTHING_FACTOR,
     PROP_JOINTS_PERSISTENCY,
     PROP_ENABLE_SMOOTHING,
-    PROP_TORSO_MINIMUM_NUMBER_NODES
+    PROP_TORSO_MINIMUM_NUMBER_NODES,
+    PROP_ENABLE_REGION_OF_INTEREST,
+    PROP_REGION_OF_INTEREST_MARGIN,
+    PROP_ENABLE_INCREMENTAL_GRAPH,
+    PROP_INCREMENTAL_GRAPH_TOLERANCE,
+    PROP_ENABLE_STATIC_SCENE_DETECTION,
+    PROP_STATIC_SCENE_TOLERANCE,
+    PROP_SKIPPED_FRAMES,
+    PROP_ENABLE_PYRAMID,
+    PROP_PYRAMID_FACTOR,
+    PROP_HAND_REFINEMENT_RADIUS,
+    PROP_CAMERA_INTRINSICS,
+    PROP_ENABLE_MEDIAN_FILTER,
+    PROP_ENABLE_HOLE_FILLING,
+    PROP_HOLE_FILLING_MIN_NEIGHBORS,
+    PROP_ENABLE_BACKGROUND_SUBTRACTION,
+    PROP_BACKGROUND_TOLERANCE,
+    PROP_BACKGROUND_LEARNING_FRAMES,
+    PROP_BACKGROUND_ABSORPTION_FRAMES,
+    PROP_ENABLE_PLANE_REMOVAL,
+    PROP_PLANE_REMOVAL_TOLERANCE,
+    PROP_PLANE_REMOVAL_MAX_PLANES,
+    PROP_ENABLE_DEPTH_GATING,
+    PROP_DEPTH_GATING_MAX_BAND,
+    PROP_ENABLE_ADAPTIVE_GRAPH,
+    PROP_ADAPTIVE_GRAPH_MAX_CELL_SIZE,
+    PROP_ADAPTIVE_GRAPH_TOLERANCE,
+    PROP_JOINT_MASK,
+    PROP_MAX_USERS,
+    PROP_ENABLE_TEMPORAL_ARM_ASSIGNMENT,
+    PROP_ENABLE_PREDICTION,
+    PROP_PREDICTION_INTERVAL,
+    PROP_PREDICTION_TOLERANCE,
+    PROP_PREDICTED_FRAMES,
+    PROP_GRAPH_NODES
   };
 
 
@@ -163,6 +395,14 @@ static void     skeltrack_skeleton_get_property       (GObject *obj,
 
 static void     clean_tracking_resources              (SkeltrackSkeleton *self);
 
+static guint    get_frame_signature_size              (guint width,
+                                                       guint height);
+
+static void     clean_filtered_buffers                (SkeltrackSkeleton *self);
+
+static void     clean_tracked_user                    (TrackedUser *user);
+static void     clean_tracked_users                   (SkeltrackSkeleton *self);
+
 G_DEFINE_TYPE (SkeltrackSkeleton, skeltrack_skeleton, G_TYPE_OBJECT)
 
 static void
@@ -433,100 +673,941 @@ skeltrack_skeleton_class_init (SkeltrackSkeletonClass *class)
                                             G_PARAM_READWRITE |
                                             G_PARAM_STATIC_STRINGS));
 
+  /**
+   * SkeltrackSkeleton:enable-region-of-interest:
+   *
+   * Whether the graph should only be built inside a region around the
+   * joints found in the previous frame.
+   *
+   * The region is the bounding box of the previous joints, expanded by
+   * #SkeltrackSkeleton:region-of-interest-margin and by the joints'
+   * trend when smoothing is enabled, and it extends down to the bottom
+   * of the buffer. If no joints were found in the previous frame, or if
+   * a joint found inside the region touches its border, the whole
+   * buffer is used instead.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_ENABLE_REGION_OF_INTEREST,
+                         g_param_spec_boolean ("enable-region-of-interest",
+                                               "Enable region of interest",
+                                               "Whether the graph should only "
+                                               "be built around the previous "
+                                               "joints",
+                                               ENABLE_REGION_OF_INTEREST_DEFAULT,
+                                               G_PARAM_READWRITE |
+                                               G_PARAM_STATIC_STRINGS));
 
-  /* add private structure */
-  g_type_class_add_private (obj_class, sizeof (SkeltrackSkeletonPrivate));
-}
-
-static void
-skeltrack_skeleton_init (SkeltrackSkeleton *self)
-{
-  guint i;
-  SkeltrackSkeletonPrivate *priv;
+  /**
+   * SkeltrackSkeleton:region-of-interest-margin:
+   *
+   * The margin (in mm) by which the region around the previous joints is
+   * expanded when #SkeltrackSkeleton:enable-region-of-interest is %TRUE.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_REGION_OF_INTEREST_MARGIN,
+                         g_param_spec_uint ("region-of-interest-margin",
+                                            "Region of interest margin",
+                                            "The margin (in mm) by which the "
+                                            "region around the previous "
+                                            "joints is expanded.",
+                                            0,
+                                            G_MAXUINT16,
+                                            REGION_OF_INTEREST_MARGIN,
+                                            G_PARAM_READWRITE |
+                                            G_PARAM_STATIC_STRINGS));
 
-  priv = SKELTRACK_SKELETON_GET_PRIVATE (self);
-  self->priv = priv;
+  /**
+   * SkeltrackSkeleton:enable-incremental-graph:
+   *
+   * Whether the graph's nodes and edges should be kept between frames
+   * and only rebuilt for the tiles of the buffer whose depth changed.
+   *
+   * With #SkeltrackSkeleton:incremental-graph-tolerance set to 0 the
+   * resulting graph is the same as the one built from scratch, which
+   * makes this mostly useful for fixed cameras where only a small part
+   * of the scene changes between frames. It is not used for frames
+   * tracked inside a region of interest.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_ENABLE_INCREMENTAL_GRAPH,
+                         g_param_spec_boolean ("enable-incremental-graph",
+                                               "Enable incremental graph",
+                                               "Whether the graph should only "
+                                               "be rebuilt where the depth "
+                                               "changed",
+                                               ENABLE_INCREMENTAL_GRAPH_DEFAULT,
+                                               G_PARAM_READWRITE |
+                                               G_PARAM_STATIC_STRINGS));
 
-  priv->buffer = NULL;
-  priv->buffer_width = 0;
-  priv->buffer_height = 0;
+  /**
+   * SkeltrackSkeleton:incremental-graph-tolerance:
+   *
+   * The depth difference (in mm) a point needs to have from the previous
+   * frame for its tile of the graph to be rebuilt when
+   * #SkeltrackSkeleton:enable-incremental-graph is %TRUE. Tiles where no
+   * point changed more than this keep their previous depth values.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_INCREMENTAL_GRAPH_TOLERANCE,
+                         g_param_spec_uint ("incremental-graph-tolerance",
+                                            "Incremental graph tolerance",
+                                            "The depth difference (in mm) "
+                                            "needed to rebuild a part of "
+                                            "the graph.",
+                                            0,
+                                            G_MAXUINT16,
+                                            INCREMENTAL_GRAPH_TOLERANCE,
+                                            G_PARAM_READWRITE |
+                                            G_PARAM_STATIC_STRINGS));
 
-  priv->graph = NULL;
-  priv->labels = NULL;
-  priv->main_component = NULL;
-  priv->node_matrix = NULL;
-  priv->distances_matrix = NULL;
+  /**
+   * SkeltrackSkeleton:enable-static-scene-detection:
+   *
+   * Whether tracking should be skipped when the buffer is nearly the
+   * same as the last one that was tracked, in which case the joints
+   * returned for that one are returned again.
+   *
+   * The buffers are compared point by point, see
+   * #SkeltrackSkeleton:static-scene-tolerance.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_ENABLE_STATIC_SCENE_DETECTION,
+                         g_param_spec_boolean ("enable-static-scene-detection",
+                                               "Enable static scene detection",
+                                               "Whether tracking should be "
+                                               "skipped when the scene does "
+                                               "not change",
+                                               ENABLE_STATIC_SCENE_DETECTION_DEFAULT,
+                                               G_PARAM_READWRITE |
+                                               G_PARAM_STATIC_STRINGS));
 
-  priv->dimension_reduction = DIMENSION_REDUCTION;
-  priv->distance_threshold = GRAPH_DISTANCE_THRESHOLD;
+  /**
+   * SkeltrackSkeleton:static-scene-tolerance:
+   *
+   * The depth difference (in mm) above which a point of a buffer is
+   * considered changed from the last tracked one. A buffer with no
+   * changed points is considered the same when
+   * #SkeltrackSkeleton:enable-static-scene-detection is %TRUE.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_STATIC_SCENE_TOLERANCE,
+                         g_param_spec_uint ("static-scene-tolerance",
+                                            "Static scene tolerance",
+                                            "The depth difference (in mm) "
+                                            "above which a point is "
+                                            "considered changed.",
+                                            0,
+                                            G_MAXUINT16,
+                                            STATIC_SCENE_TOLERANCE,
+                                            G_PARAM_READWRITE |
+                                            G_PARAM_STATIC_STRINGS));
 
-  priv->min_nr_nodes = GRAPH_MINIMUM_NUMBER_OF_NODES;
+  /**
+   * SkeltrackSkeleton:skipped-frames:
+   *
+   * The number of buffers for which tracking was skipped because of
+   * #SkeltrackSkeleton:enable-static-scene-detection.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_SKIPPED_FRAMES,
+                         g_param_spec_uint ("skipped-frames",
+                                            "Skipped frames",
+                                            "The number of buffers for "
+                                            "which tracking was skipped.",
+                                            0,
+                                            G_MAXUINT,
+                                            0,
+                                            G_PARAM_READABLE |
+                                            G_PARAM_STATIC_STRINGS));
 
-  priv->hands_minimum_distance = HANDS_MINIMUM_DISTANCE;
+  /**
+   * SkeltrackSkeleton:enable-pyramid:
+   *
+   * Whether the joints tracked in the buffer reduced by
+   * #SkeltrackSkeleton:dimension-reduction should be refined in a finer
+   * level, reduced #SkeltrackSkeleton:pyramid-factor times less, which
+   * is only read in small windows around each joint.
+   *
+   * In its window, a graph of the points of the finer level is built,
+   * and only the points connected to the joint are used: a hand or a
+   * foot is moved to the one farthest from its elbow or knee, and any
+   * other joint to their center. Points the enabled stages removed from
+   * the buffer, like the background or the planes, are left out.
+   *
+   * The finer level is read from the full resolution buffer, so this is
+   * only used with skeltrack_skeleton_track_joints_full().
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_ENABLE_PYRAMID,
+                         g_param_spec_boolean ("enable-pyramid",
+                                               "Enable pyramid",
+                                               "Whether the joints should "
+                                               "be refined in a finer level",
+                                               ENABLE_PYRAMID_DEFAULT,
+                                               G_PARAM_READWRITE |
+                                               G_PARAM_STATIC_STRINGS));
 
-  priv->shoulders_circumference_radius = SHOULDERS_CIRCUMFERENCE_RADIUS;
-  priv->shoulders_arc_start_point = SHOULDERS_ARC_START_POINT;
-  priv->shoulders_arc_length = SHOULDERS_ARC_LENGTH;
-  priv->shoulders_search_step = SHOULDERS_SEARCH_STEP;
+  /**
+   * SkeltrackSkeleton:pyramid-factor:
+   *
+   * How many times less, in each direction, the level the joints are
+   * refined in is reduced when #SkeltrackSkeleton:enable-pyramid is
+   * %TRUE. The finer level is never finer than the full resolution
+   * buffer.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_PYRAMID_FACTOR,
+                         g_param_spec_uint ("pyramid-factor",
+                                            "Pyramid factor",
+                                            "The factor by which the finer "
+                                            "level is reduced less than the "
+                                            "buffer.",
+                                            2,
+                                            16,
+                                            PYRAMID_FACTOR,
+                                            G_PARAM_READWRITE |
+                                            G_PARAM_STATIC_STRINGS));
 
-  priv->extrema_sphere_radius = EXTREMA_SPHERE_RADIUS;
+  /**
+   * SkeltrackSkeleton:hand-refinement-radius:
+   *
+   * The radius (in mm) of the window around each hand that is used by
+   * skeltrack_skeleton_refine_hands().
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_HAND_REFINEMENT_RADIUS,
+                         g_param_spec_uint ("hand-refinement-radius",
+                                            "Hand refinement radius",
+                                            "The radius (in mm) of the "
+                                            "window around each hand used "
+                                            "to refine it.",
+                                            0,
+                                            G_MAXUINT16,
+                                            HAND_REFINEMENT_RADIUS,
+                                            G_PARAM_READWRITE |
+                                            G_PARAM_STATIC_STRINGS));
 
-  priv->focus_node = g_slice_new0 (Node);
-  priv->focus_node->x = 0;
-  priv->focus_node->y = 0;
-  priv->focus_node->z = DEFAULT_FOCUS_POINT_Z;
+  /**
+   * SkeltrackSkeleton:camera-intrinsics:
+   *
+   * The #SkeltrackCameraIntrinsics of the camera that produces the depth
+   * buffers, used to convert their points into coordinates in the space.
+   * If it is %NULL, the default, the Kinect's parameters are used.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_CAMERA_INTRINSICS,
+                         g_param_spec_boxed ("camera-intrinsics",
+                                             "Camera intrinsics",
+                                             "The intrinsic parameters of "
+                                             "the depth camera.",
+                                             SKELTRACK_TYPE_CAMERA_INTRINSICS,
+                                             G_PARAM_READWRITE |
+                                             G_PARAM_STATIC_STRINGS));
 
-  priv->track_joints_result = NULL;
+  /**
+   * SkeltrackSkeleton:enable-median-filter:
+   *
+   * Whether each point of the buffer should be replaced by the median
+   * of the 3x3 points around it before building the graph. This removes
+   * the isolated points and single point holes of noisy sensors, which
+   * would otherwise become small components of the graph.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_ENABLE_MEDIAN_FILTER,
+                         g_param_spec_boolean ("enable-median-filter",
+                                               "Enable median filter",
+                                               "Whether the buffer should "
+                                               "be filtered by a 3x3 median",
+                                               ENABLE_MEDIAN_FILTER_DEFAULT,
+                                               G_PARAM_READWRITE |
+                                               G_PARAM_STATIC_STRINGS));
 
-  g_mutex_init (&priv->track_joints_mutex);
+  /**
+   * SkeltrackSkeleton:enable-hole-filling:
+   *
+   * Whether the invalid points of the buffer that are surrounded by
+   * at least #SkeltrackSkeleton:hole-filling-min-neighbors valid points
+   * should be filled with their median before building the graph. It
+   * is done after #SkeltrackSkeleton:enable-median-filter.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_ENABLE_HOLE_FILLING,
+                         g_param_spec_boolean ("enable-hole-filling",
+                                               "Enable hole filling",
+                                               "Whether the small holes of "
+                                               "the buffer should be filled",
+                                               ENABLE_HOLE_FILLING_DEFAULT,
+                                               G_PARAM_READWRITE |
+                                               G_PARAM_STATIC_STRINGS));
 
-  priv->enable_smoothing = ENABLE_SMOOTHING_DEFAULT;
-  priv->smooth_data.smoothing_factor = SMOOTHING_FACTOR_DEFAULT;
-  priv->smooth_data.smoothed_joints = NULL;
-  priv->smooth_data.trend_joints = NULL;
-  priv->smooth_data.joints_persistency = JOINTS_PERSISTENCY_DEFAULT;
-  for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
-    priv->smooth_data.joints_persistency_counter[i] = JOINTS_PERSISTENCY_DEFAULT;
+  /**
+   * SkeltrackSkeleton:hole-filling-min-neighbors:
+   *
+   * The minimum number of valid points, out of the 8 around it, that an
+   * invalid point needs to be filled when
+   * #SkeltrackSkeleton:enable-hole-filling is %TRUE.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_HOLE_FILLING_MIN_NEIGHBORS,
+                         g_param_spec_uint ("hole-filling-min-neighbors",
+                                            "Hole filling minimum neighbors",
+                                            "The minimum number of valid "
+                                            "neighbors of a point to fill.",
+                                            1,
+                                            8,
+                                            HOLE_FILLING_MIN_NEIGHBORS,
+                                            G_PARAM_READWRITE |
+                                            G_PARAM_STATIC_STRINGS));
 
-  priv->torso_minimum_number_nodes = TORSO_MINIMUM_NUMBER_NODES_DEFAULT;
+  /**
+   * SkeltrackSkeleton:enable-background-subtraction:
+   *
+   * Whether the static background of the scene should be learned and
+   * its points removed from the buffer before building the graph. This
+   * is meant for a fixed camera, where the walls, floor and furniture
+   * would otherwise become nodes in every frame.
+   *
+   * The background is learned from the valid values of the first
+   * #SkeltrackSkeleton:background-learning-frames buffers, so the scene
+   * should be empty while learning. Points that had no valid value then
+   * are never removed. The background keeps slowly adapting to the
+   * points that belong to it, and takes in the ones that keep the same
+   * depth for #SkeltrackSkeleton:background-absorption-frames. Setting
+   * this property starts learning it again.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_ENABLE_BACKGROUND_SUBTRACTION,
+                         g_param_spec_boolean ("enable-background-subtraction",
+                                               "Enable background subtraction",
+                                               "Whether the static "
+                                               "background should be "
+                                               "removed from the buffer",
+                                               ENABLE_BACKGROUND_SUBTRACTION_DEFAULT,
+                                               G_PARAM_READWRITE |
+                                               G_PARAM_STATIC_STRINGS));
 
-  priv->previous_head = NULL;
-}
+  /**
+   * SkeltrackSkeleton:background-tolerance:
+   *
+   * The maximum difference (in mm) between a point and the learned
+   * background for it to be considered background. Points whose depth
+   * varied more while learning are given a larger tolerance.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_BACKGROUND_TOLERANCE,
+                         g_param_spec_uint ("background-tolerance",
+                                            "Background tolerance",
+                                            "The maximum difference (in mm) "
+                                            "of a point to the background.",
+                                            0,
+                                            G_MAXUINT16,
+                                            BACKGROUND_TOLERANCE,
+                                            G_PARAM_READWRITE |
+                                            G_PARAM_STATIC_STRINGS));
 
-static void
-skeltrack_skeleton_dispose (GObject *obj)
-{
-  /* TODO: cancel any cancellable to interrupt joints tracking operation */
+  /**
+   * SkeltrackSkeleton:background-learning-frames:
+   *
+   * The number of buffers used to learn the background when
+   * #SkeltrackSkeleton:enable-background-subtraction is %TRUE.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_BACKGROUND_LEARNING_FRAMES,
+                         g_param_spec_uint ("background-learning-frames",
+                                            "Background learning frames",
+                                            "The number of frames used to "
+                                            "learn the background.",
+                                            1,
+                                            G_MAXUINT16,
+                                            BACKGROUND_LEARNING_FRAMES,
+                                            G_PARAM_READWRITE |
+                                            G_PARAM_STATIC_STRINGS));
 
-  G_OBJECT_CLASS (skeltrack_skeleton_parent_class)->dispose (obj);
-}
+  /**
+   * SkeltrackSkeleton:background-absorption-frames:
+   *
+   * The number of buffers a point out of the background has to keep
+   * the same depth, within #SkeltrackSkeleton:background-tolerance, to
+   * become part of the background, like a chair that was moved. This
+   * is also how points that had no valid value while learning get a
+   * background. If 0, points are never taken into the background.
+   *
+   * It should be long enough for a user standing still not to be
+   * taken in, the default being about half a minute at 30 frames per
+   * second.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_BACKGROUND_ABSORPTION_FRAMES,
+                         g_param_spec_uint ("background-absorption-frames",
+                                            "Background absorption frames",
+                                            "The number of frames a point "
+                                            "has to keep its depth to "
+                                            "become background.",
+                                            0,
+                                            G_MAXUINT16,
+                                            BACKGROUND_ABSORPTION_FRAMES,
+                                            G_PARAM_READWRITE |
+                                            G_PARAM_STATIC_STRINGS));
 
-static void
-skeltrack_skeleton_finalize (GObject *obj)
-{
-  SkeltrackSkeleton *self = SKELTRACK_SKELETON (obj);
+  /**
+   * SkeltrackSkeleton:enable-plane-removal:
+   *
+   * Whether the dominant planes of the scene, like the floor or a wall,
+   * should be found and their points removed from the buffer before
+   * building the graph. This keeps the feet from being joined to the
+   * floor and large walls from becoming components of the graph.
+   *
+   * Up to #SkeltrackSkeleton:plane-removal-max-planes planes are fitted
+   * to a random sample of the points, the planes of the previous frame
+   * being tried first. A plane needs to hold a significant part of the
+   * points to be removed.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_ENABLE_PLANE_REMOVAL,
+                         g_param_spec_boolean ("enable-plane-removal",
+                                               "Enable plane removal",
+                                               "Whether the dominant planes "
+                                               "should be removed from the "
+                                               "buffer",
+                                               ENABLE_PLANE_REMOVAL_DEFAULT,
+                                               G_PARAM_READWRITE |
+                                               G_PARAM_STATIC_STRINGS));
 
-  g_mutex_clear (&self->priv->track_joints_mutex);
+  /**
+   * SkeltrackSkeleton:plane-removal-tolerance:
+   *
+   * The maximum distance (in mm) from a point to a dominant plane for
+   * it to be removed when #SkeltrackSkeleton:enable-plane-removal is
+   * %TRUE.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_PLANE_REMOVAL_TOLERANCE,
+                         g_param_spec_uint ("plane-removal-tolerance",
+                                            "Plane removal tolerance",
+                                            "The maximum distance (in mm) "
+                                            "of a point to a removed plane.",
+                                            0,
+                                            G_MAXUINT16,
+                                            PLANE_REMOVAL_TOLERANCE,
+                                            G_PARAM_READWRITE |
+                                            G_PARAM_STATIC_STRINGS));
 
-  skeltrack_joint_list_free (self->priv->smooth_data.smoothed_joints);
-  skeltrack_joint_list_free (self->priv->smooth_data.trend_joints);
+  /**
+   * SkeltrackSkeleton:plane-removal-max-planes:
+   *
+   * The maximum number of dominant planes removed when
+   * #SkeltrackSkeleton:enable-plane-removal is %TRUE.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_PLANE_REMOVAL_MAX_PLANES,
+                         g_param_spec_uint ("plane-removal-max-planes",
+                                            "Plane removal maximum planes",
+                                            "The maximum number of planes "
+                                            "removed.",
+                                            1,
+                                            PLANE_REMOVAL_MAX_PLANES,
+                                            PLANE_REMOVAL_MAX_PLANES_DEFAULT,
+                                            G_PARAM_READWRITE |
+                                            G_PARAM_STATIC_STRINGS));
 
-  skeltrack_joint_free (self->priv->previous_head);
+  /**
+   * SkeltrackSkeleton:enable-depth-gating:
+   *
+   * Whether only the points around the depth of the user should be
+   * kept, instead of relying on a fixed range of depth given by the
+   * application.
+   *
+   * A histogram of the depth of each frame is built and the peak
+   * closest to the previous head, or to the focus point if there is
+   * none (see skeltrack_skeleton_set_focus_point()), is taken as the
+   * user. The points are kept from that peak until the first gap in
+   * the histogram, up to #SkeltrackSkeleton:depth-gating-max-band
+   * on each side, so the band follows the user as they move.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_ENABLE_DEPTH_GATING,
+                         g_param_spec_boolean ("enable-depth-gating",
+                                               "Enable depth gating",
+                                               "Whether only the points "
+                                               "around the depth of the "
+                                               "user should be kept",
+                                               ENABLE_DEPTH_GATING_DEFAULT,
+                                               G_PARAM_READWRITE |
+                                               G_PARAM_STATIC_STRINGS));
 
-  clean_tracking_resources (self);
+  /**
+   * SkeltrackSkeleton:depth-gating-max-band:
+   *
+   * The maximum distance (in mm), in front of and behind the depth of
+   * the user, of the points kept when
+   * #SkeltrackSkeleton:enable-depth-gating is %TRUE.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_DEPTH_GATING_MAX_BAND,
+                         g_param_spec_uint ("depth-gating-max-band",
+                                            "Depth gating maximum band",
+                                            "The maximum distance (in mm) "
+                                            "of the points kept from the "
+                                            "depth of the user.",
+                                            DEPTH_HISTOGRAM_BIN_SIZE,
+                                            G_MAXUINT16,
+                                            DEPTH_GATING_MAX_BAND,
+                                            G_PARAM_READWRITE |
+                                            G_PARAM_STATIC_STRINGS));
 
-  g_slice_free (Node, self->priv->focus_node);
+  /**
+   * SkeltrackSkeleton:enable-adaptive-graph:
+   *
+   * Whether blocks of points of similar depth, like the ones on the
+   * torso, should be merged into a single node of the graph, so there
+   * are fewer nodes to go through when looking for the extremas.
+   *
+   * The buffer is split as a quadtree, from blocks of
+   * #SkeltrackSkeleton:adaptive-graph-max-cell-size points down to
+   * single points. A block is merged if it has no hole and the standard
+   * deviation of the depth of its points is within
+   * #SkeltrackSkeleton:adaptive-graph-tolerance, so the points across
+   * a change of depth, like the ones of a hand in front of the torso,
+   * are kept as they are.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_ENABLE_ADAPTIVE_GRAPH,
+                         g_param_spec_boolean ("enable-adaptive-graph",
+                                               "Enable adaptive graph",
+                                               "Whether blocks of points "
+                                               "of similar depth should be "
+                                               "merged into a single node",
+                                               ENABLE_ADAPTIVE_GRAPH_DEFAULT,
+                                               G_PARAM_READWRITE |
+                                               G_PARAM_STATIC_STRINGS));
 
-  G_OBJECT_CLASS (skeltrack_skeleton_parent_class)->finalize (obj);
-}
+  /**
+   * SkeltrackSkeleton:adaptive-graph-max-cell-size:
+   *
+   * The side, in points of the buffer, of the largest blocks merged
+   * into a single node when #SkeltrackSkeleton:enable-adaptive-graph
+   * is %TRUE. It is rounded down to a power of 2.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_ADAPTIVE_GRAPH_MAX_CELL_SIZE,
+                         g_param_spec_uint ("adaptive-graph-max-cell-size",
+                                            "Adaptive graph maximum cell size",
+                                            "The side of the largest "
+                                            "blocks merged into a node.",
+                                            2,
+                                            16,
+                                            ADAPTIVE_GRAPH_MAX_CELL_SIZE,
+                                            G_PARAM_READWRITE |
+                                            G_PARAM_STATIC_STRINGS));
 
-static void
-skeltrack_skeleton_set_property (GObject      *obj,
-                                 guint         prop_id,
-                                 const GValue *value,
-                                 GParamSpec   *pspec)
-{
-  SkeltrackSkeleton *self;
+  /**
+   * SkeltrackSkeleton:adaptive-graph-tolerance:
+   *
+   * The maximum standard deviation of the depth (in mm) of the points
+   * of a block for it to be merged into a single node when
+   * #SkeltrackSkeleton:enable-adaptive-graph is %TRUE.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_ADAPTIVE_GRAPH_TOLERANCE,
+                         g_param_spec_uint ("adaptive-graph-tolerance",
+                                            "Adaptive graph tolerance",
+                                            "The maximum standard "
+                                            "deviation of depth (in mm) "
+                                            "in a merged block.",
+                                            0,
+                                            G_MAXUINT16,
+                                            ADAPTIVE_GRAPH_TOLERANCE,
+                                            G_PARAM_READWRITE |
+                                            G_PARAM_STATIC_STRINGS));
+
+  /**
+   * SkeltrackSkeleton:joint-mask:
+   *
+   * The joints to track, as a #SkeltrackJointMask. Joints not in the
+   * mask are not returned, and the stages only needed to find them are
+   * skipped: without elbows and hands, the paths along the arms are not
+   * searched, so tracking only the head is much faster.
+   *
+   * The head and shoulders are still found internally when only the
+   * arms are requested, since the arms are searched from them.
+   *
+   * The torso and lower body joints are not tracked by default. The
+   * legs are only found when they are apart, below where they split.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_JOINT_MASK,
+                         g_param_spec_flags ("joint-mask",
+                                             "Joint mask",
+                                             "The joints to track.",
+                                             SKELTRACK_TYPE_JOINT_MASK,
+                                             JOINT_MASK_DEFAULT,
+                                             G_PARAM_READWRITE |
+                                             G_PARAM_STATIC_STRINGS));
+
+  /**
+   * SkeltrackSkeleton:max-users:
+   *
+   * The maximum number of users tracked by
+   * skeltrack_skeleton_track_users_sync(), which are the ones closest
+   * to the focus point. Changing it forgets the users being tracked.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_MAX_USERS,
+                         g_param_spec_uint ("max-users",
+                                            "Maximum users",
+                                            "The maximum number of "
+                                            "users to track.",
+                                            1,
+                                            16,
+                                            MAX_USERS_DEFAULT,
+                                            G_PARAM_READWRITE |
+                                            G_PARAM_STATIC_STRINGS));
+
+  /**
+   * SkeltrackSkeleton:enable-temporal-arm-assignment:
+   *
+   * Whether the extremas given to each arm in the previous frame should
+   * be given to the same arms while they do not move much, so only the
+   * paths along the arms are searched instead of the paths from both
+   * shoulders to both extremas.
+   *
+   * The assignment is only kept when each arm got one of the extremas,
+   * clearly closer to its own shoulder, and it is checked again with
+   * the paths from both shoulders every few frames.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_ENABLE_TEMPORAL_ARM_ASSIGNMENT,
+                         g_param_spec_boolean ("enable-temporal-arm-assignment",
+                                               "Enable temporal arm assignment",
+                                               "Whether the extremas should "
+                                               "be given to the same arms "
+                                               "as in the previous frame",
+                                               ENABLE_TEMPORAL_ARM_ASSIGNMENT_DEFAULT,
+                                               G_PARAM_READWRITE |
+                                               G_PARAM_STATIC_STRINGS));
+
+  /**
+   * SkeltrackSkeleton:enable-prediction:
+   *
+   * Whether the joints should only be tracked every
+   * #SkeltrackSkeleton:prediction-interval buffers, and predicted in
+   * the buffers in between from the trend kept by the smoothing, so
+   * joints are still given for every buffer of a fast device.
+   *
+   * The buffer is tracked anyway when a predicted joint has a low
+   * confidence or, unless #SkeltrackSkeleton:prediction-tolerance is 0,
+   * when there are no points of the buffer close to its depth around
+   * it. Joints are only predicted when
+   * #SkeltrackSkeleton:enable-smoothing is %TRUE, and not for sparse
+   * points or when tracking several users.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_ENABLE_PREDICTION,
+                         g_param_spec_boolean ("enable-prediction",
+                                               "Enable prediction",
+                                               "Whether the joints should "
+                                               "be predicted in between "
+                                               "tracked buffers",
+                                               ENABLE_PREDICTION_DEFAULT,
+                                               G_PARAM_READWRITE |
+                                               G_PARAM_STATIC_STRINGS));
+
+  /**
+   * SkeltrackSkeleton:prediction-interval:
+   *
+   * The number of buffers from one tracked buffer to the next when
+   * #SkeltrackSkeleton:enable-prediction is %TRUE, so 1 means every
+   * buffer is tracked.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_PREDICTION_INTERVAL,
+                         g_param_spec_uint ("prediction-interval",
+                                            "Prediction interval",
+                                            "The number of buffers from "
+                                            "one tracked buffer to the "
+                                            "next.",
+                                            1,
+                                            G_MAXUINT16,
+                                            PREDICTION_INTERVAL,
+                                            G_PARAM_READWRITE |
+                                            G_PARAM_STATIC_STRINGS));
+
+  /**
+   * SkeltrackSkeleton:prediction-tolerance:
+   *
+   * The maximum difference (in mm) between the depth of a predicted
+   * joint and the depth of the points around it for the prediction to
+   * be used when #SkeltrackSkeleton:enable-prediction is %TRUE. If it
+   * is 0, the predicted joints are not checked against the buffer.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_PREDICTION_TOLERANCE,
+                         g_param_spec_uint ("prediction-tolerance",
+                                            "Prediction tolerance",
+                                            "The maximum depth difference "
+                                            "(in mm) of a predicted joint "
+                                            "to the buffer.",
+                                            0,
+                                            G_MAXUINT16,
+                                            PREDICTION_TOLERANCE,
+                                            G_PARAM_READWRITE |
+                                            G_PARAM_STATIC_STRINGS));
+
+  /**
+   * SkeltrackSkeleton:predicted-frames:
+   *
+   * The number of buffers for which the joints were predicted instead
+   * of tracked because of #SkeltrackSkeleton:enable-prediction.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_PREDICTED_FRAMES,
+                         g_param_spec_uint ("predicted-frames",
+                                            "Predicted frames",
+                                            "The number of buffers for "
+                                            "which the joints were "
+                                            "predicted.",
+                                            0,
+                                            G_MAXUINT,
+                                            0,
+                                            G_PARAM_READABLE |
+                                            G_PARAM_STATIC_STRINGS));
+
+  /**
+   * SkeltrackSkeleton:graph-nodes:
+   *
+   * The number of nodes in the graph built for the last buffer, which
+   * drops when #SkeltrackSkeleton:enable-adaptive-graph merges blocks
+   * of points.
+   **/
+  g_object_class_install_property (obj_class,
+                         PROP_GRAPH_NODES,
+                         g_param_spec_uint ("graph-nodes",
+                                            "Graph nodes",
+                                            "The number of nodes in the "
+                                            "last graph.",
+                                            0,
+                                            G_MAXUINT,
+                                            0,
+                                            G_PARAM_READABLE |
+                                            G_PARAM_STATIC_STRINGS));
+
+  /* add private structure */
+  g_type_class_add_private (obj_class, sizeof (SkeltrackSkeletonPrivate));
+}
+
+static void
+skeltrack_skeleton_init (SkeltrackSkeleton *self)
+{
+  SkeltrackSkeletonPrivate *priv;
+
+  priv = SKELTRACK_SKELETON_GET_PRIVATE (self);
+  self->priv = priv;
+
+  priv->buffer.data = NULL;
+  priv->buffer.rowstride = 0;
+  priv->buffer.step = 1;
+  priv->buffer.format = SKELTRACK_DEPTH_FORMAT_MM;
+  priv->buffer.disparity_table = NULL;
+  priv->buffer.min_depth = 0;
+  priv->buffer.max_depth = G_MAXUINT16;
+  priv->points = NULL;
+  priv->nr_points = 0;
+  priv->buffer_width = 0;
+  priv->buffer_height = 0;
+
+  priv->graph = NULL;
+  priv->labels = NULL;
+  priv->main_component = NULL;
+  priv->node_matrix = NULL;
+  priv->distances_matrix = NULL;
+
+  priv->dimension_reduction = DIMENSION_REDUCTION;
+  priv->distance_threshold = GRAPH_DISTANCE_THRESHOLD;
+
+  priv->min_nr_nodes = GRAPH_MINIMUM_NUMBER_OF_NODES;
+
+  priv->hands_minimum_distance = HANDS_MINIMUM_DISTANCE;
+
+  priv->shoulders_circumference_radius = SHOULDERS_CIRCUMFERENCE_RADIUS;
+  priv->shoulders_arc_start_point = SHOULDERS_ARC_START_POINT;
+  priv->shoulders_arc_length = SHOULDERS_ARC_LENGTH;
+  priv->shoulders_search_step = SHOULDERS_SEARCH_STEP;
+  priv->shoulders_arc = NULL;
+  priv->shoulders_arc_step = 0;
+  priv->shoulders_arc_nr_steps = 0;
+
+  priv->extrema_sphere_radius = EXTREMA_SPHERE_RADIUS;
+
+  priv->focus_node = g_slice_new0 (Node);
+  priv->focus_node->x = 0;
+  priv->focus_node->y = 0;
+  priv->focus_node->z = DEFAULT_FOCUS_POINT_Z;
+
+  priv->track_joints_result = NULL;
+
+  g_mutex_init (&priv->track_joints_mutex);
+
+  priv->enable_smoothing = ENABLE_SMOOTHING_DEFAULT;
+  priv->single_user.smooth_data.smoothing_factor = SMOOTHING_FACTOR_DEFAULT;
+  priv->single_user.smooth_data.smoothed_joints = NULL;
+  priv->single_user.smooth_data.trend_joints = NULL;
+  priv->single_user.smooth_data.joints_persistency =
+    JOINTS_PERSISTENCY_DEFAULT;
+  reset_joints_persistency_counter (&priv->single_user.smooth_data);
+
+  priv->torso_minimum_number_nodes = TORSO_MINIMUM_NUMBER_NODES_DEFAULT;
+
+  priv->single_user.previous_head = NULL;
+  priv->user = &priv->single_user;
+  priv->previous_joints = NULL;
+
+  priv->enable_region_of_interest = ENABLE_REGION_OF_INTEREST_DEFAULT;
+  priv->region_of_interest_margin = REGION_OF_INTEREST_MARGIN;
+
+  priv->enable_incremental_graph = ENABLE_INCREMENTAL_GRAPH_DEFAULT;
+  priv->incremental_graph_tolerance = INCREMENTAL_GRAPH_TOLERANCE;
+  memset (&priv->node_grid, 0, sizeof (NodeGrid));
+  priv->graph_is_persistent = FALSE;
+  priv->detached_nodes = NULL;
+
+  priv->enable_static_scene_detection = ENABLE_STATIC_SCENE_DETECTION_DEFAULT;
+  priv->static_scene_tolerance = STATIC_SCENE_TOLERANCE;
+  priv->skipped_frames = 0;
+  priv->frame_signature = NULL;
+  priv->frame_signature_width = 0;
+  priv->frame_signature_height = 0;
+
+  priv->enable_pyramid = ENABLE_PYRAMID_DEFAULT;
+  priv->pyramid_factor = PYRAMID_FACTOR;
+
+  priv->hand_refinement_radius = HAND_REFINEMENT_RADIUS;
+
+  priv->camera_intrinsics = NULL;
+  priv->new_camera_intrinsics = NULL;
+  priv->camera_intrinsics_changed = FALSE;
+  memset (&priv->projection, 0, sizeof (Projection));
+  memset (&priv->fine_projection, 0, sizeof (Projection));
+
+  priv->enable_median_filter = ENABLE_MEDIAN_FILTER_DEFAULT;
+  priv->enable_hole_filling = ENABLE_HOLE_FILLING_DEFAULT;
+  priv->hole_filling_min_neighbors = HOLE_FILLING_MIN_NEIGHBORS;
+  priv->filtered_buffers[0] = NULL;
+  priv->filtered_buffers[1] = NULL;
+  priv->filtered_width = 0;
+  priv->filtered_height = 0;
+
+  priv->enable_background_subtraction = ENABLE_BACKGROUND_SUBTRACTION_DEFAULT;
+  priv->background_tolerance = BACKGROUND_TOLERANCE;
+  priv->background_learning_frames = BACKGROUND_LEARNING_FRAMES;
+  priv->background_absorption_frames = BACKGROUND_ABSORPTION_FRAMES;
+  memset (&priv->background_model, 0, sizeof (BackgroundModel));
+  priv->background_model_changed = FALSE;
+
+  priv->enable_plane_removal = ENABLE_PLANE_REMOVAL_DEFAULT;
+  priv->plane_removal_tolerance = PLANE_REMOVAL_TOLERANCE;
+  priv->plane_removal_max_planes = PLANE_REMOVAL_MAX_PLANES_DEFAULT;
+  memset (&priv->plane_model, 0, sizeof (PlaneModel));
+
+  priv->enable_depth_gating = ENABLE_DEPTH_GATING_DEFAULT;
+  priv->depth_gating_max_band = DEPTH_GATING_MAX_BAND;
+
+  priv->enable_adaptive_graph = ENABLE_ADAPTIVE_GRAPH_DEFAULT;
+  priv->adaptive_graph_max_cell_size = ADAPTIVE_GRAPH_MAX_CELL_SIZE;
+  priv->adaptive_graph_tolerance = ADAPTIVE_GRAPH_TOLERANCE;
+  priv->graph_nodes = 0;
+
+  priv->joint_mask = JOINT_MASK_DEFAULT;
+
+  priv->max_users = MAX_USERS_DEFAULT;
+  priv->users = NULL;
+  priv->nr_users = 0;
+  priv->user_label = NULL;
+  priv->users_pool = NULL;
+  g_mutex_init (&priv->users_mutex);
+  g_cond_init (&priv->users_cond);
+  priv->nr_pending_users = 0;
+
+  priv->enable_temporal_arm_assignment =
+    ENABLE_TEMPORAL_ARM_ASSIGNMENT_DEFAULT;
+  memset (&priv->single_user.arm_assignment, 0, sizeof (ArmAssignment));
+
+  priv->enable_prediction = ENABLE_PREDICTION_DEFAULT;
+  priv->prediction_interval = PREDICTION_INTERVAL;
+  priv->prediction_tolerance = PREDICTION_TOLERANCE;
+  priv->predicted_frames = 0;
+  priv->frames_since_tracking = 0;
+}
+
+static void
+skeltrack_skeleton_dispose (GObject *obj)
+{
+  /* TODO: cancel any cancellable to interrupt joints tracking operation */
+
+  G_OBJECT_CLASS (skeltrack_skeleton_parent_class)->dispose (obj);
+}
+
+static void
+skeltrack_skeleton_finalize (GObject *obj)
+{
+  SkeltrackSkeleton *self = SKELTRACK_SKELETON (obj);
+
+  g_mutex_clear (&self->priv->track_joints_mutex);
+
+  if (self->priv->users_pool != NULL)
+    g_thread_pool_free (self->priv->users_pool, FALSE, TRUE);
+  g_mutex_clear (&self->priv->users_mutex);
+  g_cond_clear (&self->priv->users_cond);
+
+  clean_tracked_user (&self->priv->single_user);
+  skeltrack_joint_list_free (self->priv->previous_joints);
+
+  clean_tracking_resources (self);
+
+  clean_node_grid (&self->priv->node_grid);
+
+  clean_projection (&self->priv->projection);
+  clean_projection (&self->priv->fine_projection);
+  skeltrack_camera_intrinsics_free (self->priv->camera_intrinsics);
+  skeltrack_camera_intrinsics_free (self->priv->new_camera_intrinsics);
+
+  clean_filtered_buffers (self);
+
+  clean_background_model (&self->priv->background_model);
+
+  clean_plane_model (&self->priv->plane_model);
+
+  g_slice_free1 (get_frame_signature_size (self->priv->frame_signature_width,
+                                           self->priv->frame_signature_height) *
+                 sizeof (guint16),
+                 self->priv->frame_signature);
+
+  g_slice_free (Node, self->priv->focus_node);
+
+  g_slice_free1 (self->priv->shoulders_arc_nr_steps * 2 * sizeof (gdouble),
+                 self->priv->shoulders_arc);
+
+  clean_tracked_users (self);
+
+  G_OBJECT_CLASS (skeltrack_skeleton_parent_class)->finalize (obj);
+}
+
+/* The camera intrinsics last set, which may not be used yet */
+static SkeltrackCameraIntrinsics *
+get_camera_intrinsics (SkeltrackSkeletonPrivate *priv)
+{
+  if (priv->camera_intrinsics_changed)
+    return priv->new_camera_intrinsics;
+
+  return priv->camera_intrinsics;
+}
+
+static void
+skeltrack_skeleton_set_property (GObject      *obj,
+                                 guint         prop_id,
+                                 const GValue *value,
+                                 GParamSpec   *pspec)
+{
+  SkeltrackSkeleton *self;
 
   self = SKELTRACK_SKELETON (obj);
 
@@ -569,12 +1650,14 @@ skeltrack_skeleton_set_property (GObject      *obj,
       break;
 
     case PROP_SMOOTHING_FACTOR:
-      self->priv->smooth_data.smoothing_factor = g_value_get_float (value);
+      self->priv->single_user.smooth_data.smoothing_factor =
+        g_value_get_float (value);
       break;
 
     case PROP_JOINTS_PERSISTENCY:
-      self->priv->smooth_data.joints_persistency = g_value_get_uint (value);
-      reset_joints_persistency_counter (&self->priv->smooth_data);
+      self->priv->single_user.smooth_data.joints_persistency =
+        g_value_get_uint (value);
+      reset_joints_persistency_counter (&self->priv->single_user.smooth_data);
       break;
 
     case PROP_ENABLE_SMOOTHING:
@@ -585,6 +1668,138 @@ skeltrack_skeleton_set_property (GObject      *obj,
       self->priv->torso_minimum_number_nodes = g_value_get_float (value);
       break;
 
+    case PROP_ENABLE_REGION_OF_INTEREST:
+      self->priv->enable_region_of_interest = g_value_get_boolean (value);
+      break;
+
+    case PROP_REGION_OF_INTEREST_MARGIN:
+      self->priv->region_of_interest_margin = g_value_get_uint (value);
+      break;
+
+    case PROP_ENABLE_INCREMENTAL_GRAPH:
+      self->priv->enable_incremental_graph = g_value_get_boolean (value);
+      break;
+
+    case PROP_INCREMENTAL_GRAPH_TOLERANCE:
+      self->priv->incremental_graph_tolerance = g_value_get_uint (value);
+      break;
+
+    case PROP_ENABLE_STATIC_SCENE_DETECTION:
+      self->priv->enable_static_scene_detection = g_value_get_boolean (value);
+      break;
+
+    case PROP_STATIC_SCENE_TOLERANCE:
+      self->priv->static_scene_tolerance = g_value_get_uint (value);
+      break;
+
+    case PROP_ENABLE_PYRAMID:
+      self->priv->enable_pyramid = g_value_get_boolean (value);
+      break;
+
+    case PROP_PYRAMID_FACTOR:
+      self->priv->pyramid_factor = g_value_get_uint (value);
+      break;
+
+    case PROP_HAND_REFINEMENT_RADIUS:
+      self->priv->hand_refinement_radius = g_value_get_uint (value);
+      break;
+
+    case PROP_CAMERA_INTRINSICS:
+      g_mutex_lock (&self->priv->track_joints_mutex);
+      skeltrack_camera_intrinsics_free (self->priv->new_camera_intrinsics);
+      self->priv->new_camera_intrinsics = g_value_dup_boxed (value);
+      self->priv->camera_intrinsics_changed = TRUE;
+      g_mutex_unlock (&self->priv->track_joints_mutex);
+      break;
+
+    case PROP_ENABLE_MEDIAN_FILTER:
+      self->priv->enable_median_filter = g_value_get_boolean (value);
+      break;
+
+    case PROP_ENABLE_HOLE_FILLING:
+      self->priv->enable_hole_filling = g_value_get_boolean (value);
+      break;
+
+    case PROP_HOLE_FILLING_MIN_NEIGHBORS:
+      self->priv->hole_filling_min_neighbors = g_value_get_uint (value);
+      break;
+
+    case PROP_ENABLE_BACKGROUND_SUBTRACTION:
+      self->priv->enable_background_subtraction = g_value_get_boolean (value);
+      g_mutex_lock (&self->priv->track_joints_mutex);
+      self->priv->background_model_changed = TRUE;
+      g_mutex_unlock (&self->priv->track_joints_mutex);
+      break;
+
+    case PROP_BACKGROUND_TOLERANCE:
+      self->priv->background_tolerance = g_value_get_uint (value);
+      break;
+
+    case PROP_BACKGROUND_LEARNING_FRAMES:
+      self->priv->background_learning_frames = g_value_get_uint (value);
+      break;
+
+    case PROP_BACKGROUND_ABSORPTION_FRAMES:
+      self->priv->background_absorption_frames = g_value_get_uint (value);
+      break;
+
+    case PROP_ENABLE_PLANE_REMOVAL:
+      self->priv->enable_plane_removal = g_value_get_boolean (value);
+      break;
+
+    case PROP_PLANE_REMOVAL_TOLERANCE:
+      self->priv->plane_removal_tolerance = g_value_get_uint (value);
+      break;
+
+    case PROP_PLANE_REMOVAL_MAX_PLANES:
+      self->priv->plane_removal_max_planes = g_value_get_uint (value);
+      break;
+
+    case PROP_ENABLE_DEPTH_GATING:
+      self->priv->enable_depth_gating = g_value_get_boolean (value);
+      break;
+
+    case PROP_DEPTH_GATING_MAX_BAND:
+      self->priv->depth_gating_max_band = g_value_get_uint (value);
+      break;
+
+    case PROP_ENABLE_ADAPTIVE_GRAPH:
+      self->priv->enable_adaptive_graph = g_value_get_boolean (value);
+      break;
+
+    case PROP_ADAPTIVE_GRAPH_MAX_CELL_SIZE:
+      self->priv->adaptive_graph_max_cell_size = g_value_get_uint (value);
+      break;
+
+    case PROP_ADAPTIVE_GRAPH_TOLERANCE:
+      self->priv->adaptive_graph_tolerance = g_value_get_uint (value);
+      break;
+
+    case PROP_JOINT_MASK:
+      self->priv->joint_mask = g_value_get_flags (value);
+      break;
+
+    case PROP_MAX_USERS:
+      self->priv->max_users = g_value_get_uint (value);
+      break;
+
+    case PROP_ENABLE_TEMPORAL_ARM_ASSIGNMENT:
+      self->priv->enable_temporal_arm_assignment = g_value_get_boolean (value);
+      self->priv->single_user.arm_assignment.valid = FALSE;
+      break;
+
+    case PROP_ENABLE_PREDICTION:
+      self->priv->enable_prediction = g_value_get_boolean (value);
+      break;
+
+    case PROP_PREDICTION_INTERVAL:
+      self->priv->prediction_interval = g_value_get_uint (value);
+      break;
+
+    case PROP_PREDICTION_TOLERANCE:
+      self->priv->prediction_tolerance = g_value_get_uint (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (obj, prop_id, pspec);
       break;
@@ -640,11 +1855,13 @@ skeltrack_skeleton_get_property (GObject    *obj,
       break;
 
     case PROP_SMOOTHING_FACTOR:
-      g_value_set_float (value, self->priv->smooth_data.smoothing_factor);
+      g_value_set_float (value,
+                         self->priv->single_user.smooth_data.smoothing_factor);
       break;
 
     case PROP_JOINTS_PERSISTENCY:
-      g_value_set_uint (value, self->priv->smooth_data.joints_persistency);
+      g_value_set_uint (value,
+                        self->priv->single_user.smooth_data.joints_persistency);
       break;
 
     case PROP_ENABLE_SMOOTHING:
@@ -655,1106 +1872,3872 @@ skeltrack_skeleton_get_property (GObject    *obj,
       g_value_set_float (value, self->priv->torso_minimum_number_nodes);
       break;
 
-    default:
-      G_OBJECT_WARN_INVALID_PROPERTY_ID (obj, prop_id, pspec);
+    case PROP_ENABLE_REGION_OF_INTEREST:
+      g_value_set_boolean (value, self->priv->enable_region_of_interest);
       break;
-    }
-}
 
-static gint
-join_neighbor (SkeltrackSkeleton *self,
-               Node *node,
-               Label **neighbor_labels,
-               gint index,
-               gint i,
-               gint j)
-{
-  Node *neighbor;
-  if (i < 0 || i >= self->priv->buffer_width ||
-      j < 0 || j >= self->priv->buffer_height)
-    {
-      return index;
-    }
+    case PROP_REGION_OF_INTEREST_MARGIN:
+      g_value_set_uint (value, self->priv->region_of_interest_margin);
+      break;
 
-  neighbor = self->priv->node_matrix[self->priv->buffer_width * j + i];
-  if (neighbor != NULL)
-    {
-      gint distance;
-      distance = get_distance (neighbor, node);
-      if (distance < self->priv->distance_threshold)
-        {
-          neighbor->neighbors = g_list_prepend (neighbor->neighbors,
-                                                node);
-          node->neighbors = g_list_prepend (node->neighbors,
-                                            neighbor);
-          neighbor_labels[index] = neighbor->label;
-          index++;
-        }
+    case PROP_ENABLE_INCREMENTAL_GRAPH:
+      g_value_set_boolean (value, self->priv->enable_incremental_graph);
+      break;
+
+    case PROP_INCREMENTAL_GRAPH_TOLERANCE:
+      g_value_set_uint (value, self->priv->incremental_graph_tolerance);
+      break;
+
+    case PROP_ENABLE_STATIC_SCENE_DETECTION:
+      g_value_set_boolean (value, self->priv->enable_static_scene_detection);
+      break;
+
+    case PROP_STATIC_SCENE_TOLERANCE:
+      g_value_set_uint (value, self->priv->static_scene_tolerance);
+      break;
+
+    case PROP_SKIPPED_FRAMES:
+      g_value_set_uint (value, self->priv->skipped_frames);
+      break;
+
+    case PROP_ENABLE_PYRAMID:
+      g_value_set_boolean (value, self->priv->enable_pyramid);
+      break;
+
+    case PROP_PYRAMID_FACTOR:
+      g_value_set_uint (value, self->priv->pyramid_factor);
+      break;
+
+    case PROP_HAND_REFINEMENT_RADIUS:
+      g_value_set_uint (value, self->priv->hand_refinement_radius);
+      break;
+
+    case PROP_CAMERA_INTRINSICS:
+      g_mutex_lock (&self->priv->track_joints_mutex);
+      g_value_set_boxed (value, get_camera_intrinsics (self->priv));
+      g_mutex_unlock (&self->priv->track_joints_mutex);
+      break;
+
+    case PROP_ENABLE_MEDIAN_FILTER:
+      g_value_set_boolean (value, self->priv->enable_median_filter);
+      break;
+
+    case PROP_ENABLE_HOLE_FILLING:
+      g_value_set_boolean (value, self->priv->enable_hole_filling);
+      break;
+
+    case PROP_HOLE_FILLING_MIN_NEIGHBORS:
+      g_value_set_uint (value, self->priv->hole_filling_min_neighbors);
+      break;
+
+    case PROP_ENABLE_BACKGROUND_SUBTRACTION:
+      g_value_set_boolean (value, self->priv->enable_background_subtraction);
+      break;
+
+    case PROP_BACKGROUND_TOLERANCE:
+      g_value_set_uint (value, self->priv->background_tolerance);
+      break;
+
+    case PROP_BACKGROUND_LEARNING_FRAMES:
+      g_value_set_uint (value, self->priv->background_learning_frames);
+      break;
+
+    case PROP_BACKGROUND_ABSORPTION_FRAMES:
+      g_value_set_uint (value, self->priv->background_absorption_frames);
+      break;
+
+    case PROP_ENABLE_PLANE_REMOVAL:
+      g_value_set_boolean (value, self->priv->enable_plane_removal);
+      break;
+
+    case PROP_PLANE_REMOVAL_TOLERANCE:
+      g_value_set_uint (value, self->priv->plane_removal_tolerance);
+      break;
+
+    case PROP_PLANE_REMOVAL_MAX_PLANES:
+      g_value_set_uint (value, self->priv->plane_removal_max_planes);
+      break;
+
+    case PROP_ENABLE_DEPTH_GATING:
+      g_value_set_boolean (value, self->priv->enable_depth_gating);
+      break;
+
+    case PROP_DEPTH_GATING_MAX_BAND:
+      g_value_set_uint (value, self->priv->depth_gating_max_band);
+      break;
+
+    case PROP_ENABLE_ADAPTIVE_GRAPH:
+      g_value_set_boolean (value, self->priv->enable_adaptive_graph);
+      break;
+
+    case PROP_ADAPTIVE_GRAPH_MAX_CELL_SIZE:
+      g_value_set_uint (value, self->priv->adaptive_graph_max_cell_size);
+      break;
+
+    case PROP_ADAPTIVE_GRAPH_TOLERANCE:
+      g_value_set_uint (value, self->priv->adaptive_graph_tolerance);
+      break;
+
+    case PROP_JOINT_MASK:
+      g_value_set_flags (value, self->priv->joint_mask);
+      break;
+
+    case PROP_MAX_USERS:
+      g_value_set_uint (value, self->priv->max_users);
+      break;
+
+    case PROP_ENABLE_TEMPORAL_ARM_ASSIGNMENT:
+      g_value_set_boolean (value, self->priv->enable_temporal_arm_assignment);
+      break;
+
+    case PROP_ENABLE_PREDICTION:
+      g_value_set_boolean (value, self->priv->enable_prediction);
+      break;
+
+    case PROP_PREDICTION_INTERVAL:
+      g_value_set_uint (value, self->priv->prediction_interval);
+      break;
+
+    case PROP_PREDICTION_TOLERANCE:
+      g_value_set_uint (value, self->priv->prediction_tolerance);
+      break;
+
+    case PROP_PREDICTED_FRAMES:
+      g_value_set_uint (value, self->priv->predicted_frames);
+      break;
+
+    case PROP_GRAPH_NODES:
+      g_value_set_uint (value, self->priv->graph_nodes);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (obj, prop_id, pspec);
+      break;
+    }
+}
+
+static gint
+join_neighbor (SkeltrackSkeleton *self,
+               Node *node,
+               Label **neighbor_labels,
+               gint index,
+               gint i,
+               gint j)
+{
+  Node *neighbor;
+  if (i < 0 || i >= self->priv->buffer_width ||
+      j < 0 || j >= self->priv->buffer_height)
+    {
+      return index;
+    }
+
+  neighbor = self->priv->node_matrix[self->priv->buffer_width * j + i];
+  if (neighbor != NULL)
+    {
+      guint distance_threshold = self->priv->distance_threshold;
+      guint squared_distance = get_squared_distance (neighbor, node);
+      if (squared_distance < distance_threshold * distance_threshold)
+        {
+          neighbor->neighbors = g_list_prepend (neighbor->neighbors,
+                                                node);
+          node->neighbors = g_list_prepend (node->neighbors,
+                                            neighbor);
+          set_edge_weight (node,
+                           neighbor,
+                           get_integer_sqrt (squared_distance));
+          neighbor_labels[index] = neighbor->label;
+          index++;
+        }
     }
   return index;
 }
 
-GList *
-make_graph (SkeltrackSkeleton *self, GList **label_list)
+static Label *
+assign_label (Label **neighbor_labels, GList **labels, gint *next_label)
+{
+  Label *lowest_index_label;
+  gint index;
+
+  lowest_index_label = get_lowest_index_label (neighbor_labels);
+
+  /* No neighbors */
+  if (lowest_index_label == NULL)
+    {
+      Label *label;
+      (*next_label)++;
+      label = new_label (*next_label);
+      *labels = g_list_prepend (*labels, label);
+      lowest_index_label = label;
+    }
+  else
+    {
+      for (index = 0; index < 4; index++)
+        {
+          if (neighbor_labels[index] != NULL)
+            {
+              label_union (neighbor_labels[index], lowest_index_label);
+            }
+        }
+    }
+
+  return lowest_index_label;
+}
+
+/* Creates the node of the point at (i, j) and joins it to the
+   neighbors that come before it in the scan of the buffer */
+static Node *
+add_node (SkeltrackSkeleton *self,
+          gint i,
+          gint j,
+          guint16 value,
+          GList **labels,
+          gint *next_label)
+{
+  SkeltrackSkeletonPrivate *priv;
+  Node *node;
+  gint index = 0;
+  gint south, north, west;
+  Label *neighbor_labels[4] = {NULL, NULL, NULL, NULL};
+
+  priv = self->priv;
+
+  node = g_slice_new0 (Node);
+  node->i = i;
+  node->j = j;
+  node->z = value;
+  convert_screen_coords_to_mm (&priv->projection,
+                               i, j,
+                               node->z,
+                               &(node->x),
+                               &(node->y));
+  node->neighbors = NULL;
+  node->linked_nodes = NULL;
+
+  south = j + 1;
+  north = j - 1;
+  west = i - 1;
+
+  /* West */
+  index = join_neighbor (self,
+                         node,
+                         neighbor_labels,
+                         index,
+                         west, j);
+  /* South West*/
+  index = join_neighbor (self,
+                         node,
+                         neighbor_labels,
+                         index,
+                         west, south);
+  /* North */
+  index = join_neighbor (self,
+                         node,
+                         neighbor_labels,
+                         index,
+                         i, north);
+
+  /* North West */
+  index = join_neighbor (self,
+                         node,
+                         neighbor_labels,
+                         index,
+                         west, north);
+
+  node->label = assign_label (neighbor_labels, labels, next_label);
+  priv->node_matrix[priv->buffer_width * node->j + node->i] = node;
+
+  return node;
+}
+
+static GList *
+build_nodes (SkeltrackSkeleton *self, Region *region, GList **labels)
 {
   SkeltrackSkeletonPrivate *priv;
   gint i, j;
   Node *node;
   GList *nodes = NULL;
-  GList *labels = NULL;
-  GList *current_label;
-  GList *current_node;
-  Label *main_component_label = NULL;
-  gint index = 0;
   gint next_label = -1;
   guint16 value;
-  guint16 *buffer;
-  gint width, height;
 
-  buffer = self->priv->buffer;
-  width = self->priv->buffer_width;
-  height = self->priv->buffer_height;
+  priv = self->priv;
+
+  for (i = region->x; i < region->x + region->width; i++)
+    {
+      for (j = region->y; j < region->y + region->height; j++)
+        {
+          value = get_depth_value (&priv->buffer, i, j);
+          if (value == 0)
+            continue;
+
+          node = add_node (self, i, j, value, labels, &next_label);
+          nodes = g_list_prepend(nodes, node);
+        }
+    }
+
+  return nodes;
+}
+
+/* Whether the block of cells is inside the region, with no hole,
+   and the standard deviation of its depth is within tolerance */
+static gboolean
+is_block_homogeneous (SkeltrackSkeleton *self,
+                      Region *region,
+                      gint start_i,
+                      gint start_j,
+                      gint size)
+{
+  gint i, j, area;
+  guint64 sum = 0;
+  guint64 sum_squares = 0;
+  guint64 tolerance;
+
+  if (start_i + size > region->x + region->width ||
+      start_j + size > region->y + region->height)
+    {
+      return FALSE;
+    }
+
+  for (i = start_i; i < start_i + size; i++)
+    {
+      for (j = start_j; j < start_j + size; j++)
+        {
+          guint16 value = get_depth_value (&self->priv->buffer, i, j);
+
+          if (value == 0)
+            return FALSE;
+
+          sum += value;
+          sum_squares += (guint64) value * value;
+        }
+    }
+
+  /* area * variance = sum of squares - sum^2 / area */
+  area = size * size;
+  tolerance = self->priv->adaptive_graph_tolerance;
+  return sum_squares * area - sum * sum <=
+    tolerance * tolerance * area * area;
+}
+
+/* Merges the block into a node if it is homogeneous or otherwise
+   tries each of its quarters */
+static void
+split_block (SkeltrackSkeleton *self,
+             Region *region,
+             gint start_i,
+             gint start_j,
+             gint size)
+{
+  SkeltrackSkeletonPrivate *priv;
+  Node *node;
+  gint i, j, x = 0, y = 0, z = 0, area;
+
+  priv = self->priv;
+
+  if (size < 2)
+    return;
+
+  if (! is_block_homogeneous (self, region, start_i, start_j, size))
+    {
+      gint half = size / 2;
+
+      split_block (self, region, start_i, start_j, half);
+      split_block (self, region, start_i + half, start_j, half);
+      split_block (self, region, start_i, start_j + half, half);
+      split_block (self, region, start_i + half, start_j + half, half);
+      return;
+    }
+
+  for (i = start_i; i < start_i + size; i++)
+    {
+      for (j = start_j; j < start_j + size; j++)
+        {
+          gint value, cell_x, cell_y;
+
+          value = get_depth_value (&priv->buffer, i, j);
+          convert_screen_coords_to_mm (&priv->projection,
+                                       i, j,
+                                       value,
+                                       &cell_x,
+                                       &cell_y);
+          x += cell_x;
+          y += cell_y;
+          z += value;
+        }
+    }
+
+  area = size * size;
+  node = g_slice_new0 (Node);
+  node->i = start_i + size / 2;
+  node->j = start_j + size / 2;
+  node->x = x / area;
+  node->y = y / area;
+  node->z = z / area;
+  node->size = size;
+  node->neighbors = NULL;
+  node->linked_nodes = NULL;
+
+  set_node_cells (priv->node_matrix, priv->buffer_width, node, node);
+}
+
+/* Links the node of a cell to the one of a neighbor cell if the two
+   cells, taken at the depth of their nodes, are close enough, as
+   they would be when building the graph from single cells */
+static gint
+join_cell_neighbor (SkeltrackSkeleton *self,
+                    Node *node,
+                    Label **neighbor_labels,
+                    gint index,
+                    gint i,
+                    gint j,
+                    gint neighbor_i,
+                    gint neighbor_j)
+{
+  SkeltrackSkeletonPrivate *priv;
+  Node *neighbor;
+  gint x, y, neighbor_x, neighbor_y, dx, dy, dz;
+
+  priv = self->priv;
+
+  if (neighbor_i < 0 || neighbor_i >= priv->buffer_width ||
+      neighbor_j < 0 || neighbor_j >= priv->buffer_height)
+    {
+      return index;
+    }
+
+  neighbor = priv->node_matrix[priv->buffer_width * neighbor_j + neighbor_i];
+  if (neighbor == NULL || neighbor == node)
+    return index;
+
+  convert_screen_coords_to_mm (&priv->projection, i, j, node->z, &x, &y);
+  convert_screen_coords_to_mm (&priv->projection,
+                               neighbor_i, neighbor_j,
+                               neighbor->z,
+                               &neighbor_x,
+                               &neighbor_y);
+  dx = x - neighbor_x;
+  dy = y - neighbor_y;
+  dz = node->z - neighbor->z;
+
+  if ((guint) (dx * dx + dy * dy + dz * dz) >=
+      (guint) priv->distance_threshold * priv->distance_threshold)
+    return index;
+
+  if (g_list_find (node->neighbors, neighbor) == NULL)
+    {
+      neighbor->neighbors = g_list_prepend (neighbor->neighbors, node);
+      node->neighbors = g_list_prepend (node->neighbors, neighbor);
+      set_edge_weight (node, neighbor, get_distance (node, neighbor));
+    }
+
+  neighbor_labels[index] = neighbor->label;
+  return index + 1;
+}
+
+/* Builds the nodes like build_nodes, but with the homogeneous blocks
+   of the buffer merged into a single node. The cells are still
+   visited one by one so the nodes are linked and labelled as the
+   cells would be, a merged node being labelled when its first cell
+   is visited. */
+static GList *
+build_adaptive_nodes (SkeltrackSkeleton *self, Region *region, GList **labels)
+{
+  SkeltrackSkeletonPrivate *priv;
+  GList *nodes = NULL;
+  gint next_label = -1;
+  gint i, j, size;
+
+  priv = self->priv;
+
+  /* Largest power of 2 not above the maximum cell size */
+  for (size = 1; size * 2 <= priv->adaptive_graph_max_cell_size; size *= 2);
+
+  for (i = region->x; i < region->x + region->width; i += size)
+    {
+      for (j = region->y; j < region->y + region->height; j += size)
+        {
+          split_block (self, region, i, j, size);
+        }
+    }
+
+  for (i = region->x; i < region->x + region->width; i++)
+    {
+      for (j = region->y; j < region->y + region->height; j++)
+        {
+          Label *neighbor_labels[4] = {NULL, NULL, NULL, NULL};
+          Node *node;
+          guint16 value;
+          gint index = 0, k;
+          gboolean is_new;
+
+          node = priv->node_matrix[priv->buffer_width * j + i];
+          if (node == NULL)
+            {
+              value = get_depth_value (&priv->buffer, i, j);
+              if (value == 0)
+                continue;
+
+              node = g_slice_new0 (Node);
+              node->i = i;
+              node->j = j;
+              node->z = value;
+              convert_screen_coords_to_mm (&priv->projection,
+                                           i, j,
+                                           node->z,
+                                           &(node->x),
+                                           &(node->y));
+              node->neighbors = NULL;
+              node->linked_nodes = NULL;
+              priv->node_matrix[priv->buffer_width * j + i] = node;
+              is_new = TRUE;
+            }
+          else
+            {
+              is_new = node->label == NULL;
+            }
+
+          index = join_cell_neighbor (self, node, neighbor_labels, index,
+                                      i, j, i - 1, j);
+          index = join_cell_neighbor (self, node, neighbor_labels, index,
+                                      i, j, i - 1, j + 1);
+          index = join_cell_neighbor (self, node, neighbor_labels, index,
+                                      i, j, i, j - 1);
+          index = join_cell_neighbor (self, node, neighbor_labels, index,
+                                      i, j, i - 1, j - 1);
+
+          if (is_new)
+            {
+              node->label = assign_label (neighbor_labels,
+                                          labels,
+                                          &next_label);
+              nodes = g_list_prepend (nodes, node);
+              continue;
+            }
+
+          for (k = 0; k < index; k++)
+            label_union (neighbor_labels[k], node->label);
+        }
+    }
+
+  return nodes;
+}
+
+/* Gets the cell of the reduced buffer a point falls on, which is the
+   one of the dimension-reduction columns and rows it is in */
+static gboolean
+get_point_cell (SkeltrackSkeleton *self,
+                const SkeltrackDepthPoint *point,
+                guint *i,
+                guint *j)
+{
+  SkeltrackSkeletonPrivate *priv = self->priv;
+  guint16 step = priv->dimension_reduction;
+
+  if (point->z == 0)
+    return FALSE;
+
+  *i = point->i / step;
+  *j = point->j / step;
+
+  return *i < priv->buffer_width && *j < priv->buffer_height;
+}
+
+typedef enum {
+  POINT_KEY_PHASE,
+  POINT_KEY_ROW,
+  POINT_KEY_COLUMN
+} PointKey;
+
+/* The position of a point inside its cell, in the order of the rows,
+   or the row or column of its cell */
+static guint
+get_point_key (SkeltrackSkeleton *self,
+               const SkeltrackDepthPoint *point,
+               PointKey key)
+{
+  guint16 step = self->priv->dimension_reduction;
+  guint i = 0, j = 0;
+
+  get_point_cell (self, point, &i, &j);
+
+  switch (key)
+    {
+    case POINT_KEY_PHASE:
+      return (point->j % step) * step + point->i % step;
+    case POINT_KEY_ROW:
+      return j;
+    default:
+      return i;
+    }
+}
+
+static guint
+get_point_key_size (SkeltrackSkeleton *self, PointKey key)
+{
+  guint16 step = self->priv->dimension_reduction;
+
+  switch (key)
+    {
+    case POINT_KEY_PHASE:
+      return step * step;
+    case POINT_KEY_ROW:
+      return self->priv->buffer_height;
+    default:
+      return self->priv->buffer_width;
+    }
+}
+
+/* Counting sort of the points in input by the key, keeping the order
+   of the points with the same one */
+static void
+sort_points (SkeltrackSkeleton *self,
+             const guint *input,
+             guint nr_points,
+             PointKey key,
+             guint *output)
+{
+  guint *offsets;
+  guint k, size;
+
+  size = get_point_key_size (self, key);
+  offsets = g_slice_alloc0 ((size + 1) * sizeof (guint));
+
+  for (k = 0; k < nr_points; k++)
+    offsets[get_point_key (self, &self->priv->points[input[k]], key) + 1]++;
+
+  for (k = 0; k < size; k++)
+    offsets[k + 1] += offsets[k];
+
+  for (k = 0; k < nr_points; k++)
+    {
+      guint index = get_point_key (self, &self->priv->points[input[k]], key);
+      output[offsets[index]++] = input[k];
+    }
+
+  g_slice_free1 ((size + 1) * sizeof (guint), offsets);
+}
+
+/* Builds the nodes from the points given to
+   skeltrack_skeleton_track_joints_points(), visiting them in the same
+   order build_nodes does so the graph is the same as if they had been
+   given in a buffer. The points are sorted by their position in the
+   cell, and then by row and column, so the work depends on the number
+   of points only and the point of a cell is the first one in the
+   order of the rows, the one a reduction would read. */
+static GList *
+build_nodes_from_points (SkeltrackSkeleton *self, GList **labels)
+{
+  SkeltrackSkeletonPrivate *priv;
+  GList *nodes = NULL;
+  gint next_label = -1;
+  guint *valid, *sorted, *order;
+  guint i, j, k, nr_cells = 0, width;
+  gsize size;
+
+  priv = self->priv;
+  width = priv->buffer_width;
+
+  size = MAX (priv->nr_points, 1) * sizeof (guint);
+  valid = g_slice_alloc (size);
+
+  for (k = 0; k < priv->nr_points; k++)
+    {
+      if (get_point_cell (self, &priv->points[k], &i, &j))
+        valid[nr_cells++] = k;
+    }
+
+  if (nr_cells == 0)
+    {
+      g_slice_free1 (size, valid);
+      return NULL;
+    }
+
+  sorted = g_slice_alloc (size);
+  order = g_slice_alloc (size);
+  sort_points (self, valid, nr_cells, POINT_KEY_PHASE, order);
+  sort_points (self, order, nr_cells, POINT_KEY_ROW, sorted);
+  sort_points (self, sorted, nr_cells, POINT_KEY_COLUMN, order);
+
+  for (k = 0; k < nr_cells; k++)
+    {
+      const SkeltrackDepthPoint *point = &priv->points[order[k]];
+      Node *node;
+
+      get_point_cell (self, point, &i, &j);
+
+      /* Only the first point of a cell is used */
+      if (priv->node_matrix[j * width + i] != NULL)
+        continue;
+
+      node = add_node (self, i, j, point->z, labels, &next_label);
+      nodes = g_list_prepend (nodes, node);
+    }
+
+  g_slice_free1 (size, valid);
+  g_slice_free1 (size, sorted);
+  g_slice_free1 (size, order);
+
+  return nodes;
+}
+
+/* Labels the nodes kept in the node grid, which are updated only in
+   the tiles whose depth changed, and returns them in the same order
+   build_nodes does */
+static GList *
+build_nodes_from_grid (SkeltrackSkeleton *self, GList **labels)
+{
+  SkeltrackSkeletonPrivate *priv;
+  GList *nodes, *current;
+
+  priv = self->priv;
+
+  update_node_grid (&priv->node_grid,
+                    &priv->buffer,
+                    &priv->projection,
+                    priv->distance_threshold,
+                    priv->incremental_graph_tolerance);
+
+  nodes = label_node_grid (&priv->node_grid, labels);
+  for (current = nodes; current != NULL; current = g_list_next (current))
+    {
+      Node *node = (Node *) current->data;
+      priv->node_matrix[priv->buffer_width * node->j + node->i] = node;
+    }
+
+  return nodes;
+}
+
+static GList *
+remove_label_nodes (SkeltrackSkeleton *self, GList *nodes, Label *label)
+{
+  /* Nodes from the node grid are kept for the next frame */
+  if (self->priv->graph_is_persistent)
+    {
+      return detach_nodes_with_label (nodes,
+                                      self->priv->node_matrix,
+                                      self->priv->buffer_width,
+                                      label,
+                                      &self->priv->detached_nodes);
+    }
+
+  return remove_nodes_with_label (nodes,
+                                  self->priv->node_matrix,
+                                  self->priv->buffer_width,
+                                  label);
+}
+
+/* The number of cells of the buffer the nodes stand for, which is
+   their number unless some were merged */
+static guint
+get_nodes_area (GList *nodes)
+{
+  GList *current;
+  guint area = 0;
+
+  for (current = g_list_first (nodes);
+       current != NULL;
+       current = g_list_next (current))
+    {
+      area += get_node_area ((Node *) current->data);
+    }
+
+  return area;
+}
+
+/* Builds the nodes of the region and resolves their labels, which
+   are given the size of their component */
+static GList *
+build_labelled_nodes (SkeltrackSkeleton *self, Region *region, GList **label_list)
+{
+  SkeltrackSkeletonPrivate *priv;
+  GList *nodes = NULL;
+  GList *labels = NULL;
+  GList *current_label;
+  GList *current_node;
+  gint width, height;
+
+  width = self->priv->buffer_width;
+  height = self->priv->buffer_height;
+
+  priv = self->priv;
+
+
+  if (priv->node_matrix == NULL)
+    {
+      priv->node_matrix = g_slice_alloc0 (width * height * sizeof (Node *));
+    }
+  else
+    {
+      memset (self->priv->node_matrix,
+              0,
+              width * height * sizeof (Node *));
+    }
+
+  if (priv->points != NULL)
+    nodes = build_nodes_from_points (self, &labels);
+  else if (priv->enable_adaptive_graph)
+    nodes = build_adaptive_nodes (self, region, &labels);
+  else if (priv->graph_is_persistent)
+    nodes = build_nodes_from_grid (self, &labels);
+  else
+    nodes = build_nodes (self, region, &labels);
+
+  for (current_node = g_list_first (nodes);
+       current_node != NULL;
+       current_node = g_list_next (current_node))
+    {
+      Node *node = (Node *) current_node->data;
+      node->label = label_find (node->label);
+      node->label->nodes = g_list_prepend (node->label->nodes,
+                                          node);
+
+      /* Assign lower node so we can extract the
+         lower graph's component */
+      if (node->label->lower_screen_y == -1 ||
+         node->j > node->label->lower_screen_y)
+      {
+        node->label->lower_screen_y = node->j;
+      }
+
+      /* Assign farther to the camera node so we
+         can extract the main graph component */
+      if (node->label->higher_z == -1 ||
+         node->z > node->label->higher_z)
+        {
+          node->label->higher_z = node->z;
+        }
+
+      /* Assign closer to the camera node so we
+         can extract the main graph component */
+      if (node->label->lower_z == -1 ||
+         node->z < node->label->lower_z)
+        {
+          node->label->lower_z = node->z;
+        }
+    }
+
+  for (current_label = g_list_first (labels);
+       current_label != NULL;
+       current_label = g_list_next (current_label))
+    {
+      Label *label;
+      GList *current_nodes;
+
+      label = (Label *) current_label->data;
+      current_nodes = label->nodes;
+
+      label->normalized_num_nodes =  get_nodes_area (current_nodes) *
+                                     ((label->higher_z - label->lower_z)/2 +
+                                     label->lower_z) *
+                                     (pow (DIMENSION_REDUCTION, 2)/2) /
+                                     1000000;
+    }
+
+  *label_list = labels;
+
+  return nodes;
+}
+
+static GList *
+remove_small_labels (SkeltrackSkeleton *self, GList *nodes, GList **label_list)
+{
+  GList *labels = *label_list;
+  GList *current_label;
+
+  current_label = g_list_first (labels);
+  while (current_label != NULL)
+    {
+      Label *label;
+      label = (Label *) current_label->data;
+
+      /* Remove label if number of nodes is less than
+         the minimum required */
+      if (get_nodes_area (label->nodes) < self->priv->min_nr_nodes)
+        {
+          nodes = remove_label_nodes (self, nodes, label);
+
+          GList *link = current_label;
+          current_label = g_list_next (current_label);
+          labels = g_list_delete_link (labels, link);
+          free_label (label);
+          continue;
+        }
+
+      current_label = g_list_next (current_label);
+    }
+
+  *label_list = labels;
+
+  return nodes;
+}
+
+/* Links a label to the component it was joined to, through the
+   bridge found for it */
+static void
+add_label_bridge (Label *label)
+{
+  label->bridge_node->neighbors =
+    g_list_prepend (label->bridge_node->neighbors, label->to_node);
+  label->to_node->neighbors = g_list_prepend (label->to_node->neighbors,
+                                              label->bridge_node);
+}
+
+GList *
+make_graph (SkeltrackSkeleton *self, Region *region, GList **label_list)
+{
+  SkeltrackSkeletonPrivate *priv;
+  GList *nodes = NULL;
+  GList *labels = NULL;
+  GList *current_label;
+  Label *main_component_label = NULL;
+
+  priv = self->priv;
+
+  /* The node grid only covers the whole buffer */
+  priv->graph_is_persistent = priv->enable_incremental_graph &&
+    ! priv->enable_adaptive_graph &&
+    priv->points == NULL &&
+    region->x == 0 && region->y == 0 &&
+    region->width == priv->buffer_width &&
+    region->height == priv->buffer_height;
+
+  if (!priv->enable_incremental_graph)
+    clean_node_grid (&priv->node_grid);
+
+  nodes = build_labelled_nodes (self, region, &labels);
+
+  main_component_label = get_main_component (nodes,
+                                             priv->focus_node,
+                                             priv->torso_minimum_number_nodes);
+
+  nodes = remove_small_labels (self, nodes, &labels);
+
+  if (main_component_label)
+    {
+      join_components_to_main (labels,
+                               main_component_label,
+                               priv->distance_threshold,
+                               priv->hands_minimum_distance,
+                               priv->distance_threshold);
+
+      current_label = g_list_first (labels);
+      while (current_label != NULL)
+        {
+          Label *label;
+          label = (Label *) current_label->data;
+          if (label == main_component_label)
+            {
+              current_label = g_list_next (current_label);
+              continue;
+            }
+
+          if (label->bridge_node == NULL)
+            {
+              nodes = remove_label_nodes (self, nodes, label);
+
+              GList *link = current_label;
+              current_label = g_list_next (current_label);
+              labels = g_list_delete_link (labels, link);
+              free_label (label);
+              continue;
+            }
+
+          add_label_bridge (label);
+
+          current_label = g_list_next (current_label);
+        }
+
+      priv->main_component = main_component_label->nodes;
+    }
+
+  priv->graph_nodes = g_list_length (nodes);
+  *label_list = labels;
+
+  return nodes;
+}
+
+/* Sets the real world coordinates of center to the average of the
+   ones of the nodes, weighted by their area */
+static void
+get_nodes_center (GList *nodes, Node *center)
+{
+  gint avg_x = 0;
+  gint avg_y = 0;
+  gint avg_z = 0;
+  gint length;
+  GList *node_list;
+
+  for (node_list = g_list_first (nodes);
+       node_list != NULL;
+       node_list = g_list_next (node_list))
+    {
+      Node *node;
+      node = (Node *) node_list->data;
+      avg_x += node->x * get_node_area (node);
+      avg_y += node->y * get_node_area (node);
+      avg_z += node->z * get_node_area (node);
+    }
+
+  length = get_nodes_area (nodes);
+  center->x = avg_x / length;
+  center->y = avg_y / length;
+  center->z = avg_z / length;
+}
+
+Node *
+get_centroid (SkeltrackSkeletonPrivate *priv)
+{
+  Node *cent = NULL;
+  Node *centroid = NULL;
+
+  if (priv->main_component == NULL)
+    return NULL;
+
+  cent = g_slice_new0 (Node);
+  get_nodes_center (priv->main_component, cent);
+  cent->linked_nodes = NULL;
+
+  centroid = get_closest_node (priv->graph, cent);
+
+  g_slice_free (Node, cent);
+
+  return centroid;
+}
+
+static Node *
+get_lowest (SkeltrackSkeletonPrivate *priv, Node *centroid)
+{
+  Node *lowest = NULL;
+  /* @TODO: Use the node_matrix instead of the lowest
+     component to look for the lowest node as it's faster. */
+  if (priv->main_component != NULL)
+    {
+      GList *node_list;
+      for (node_list = g_list_first (priv->main_component);
+           node_list != NULL;
+           node_list = g_list_next (node_list))
+        {
+          Node *node;
+          node = (Node *) node_list->data;
+          if (node->i != centroid->i)
+            continue;
+          if (lowest == NULL ||
+              lowest->j < node->j)
+            {
+              lowest = node;
+            }
+        }
+    }
+  return lowest;
+}
+
+/* Only the cells of the reachable nodes are set in distances, so
+   its maximum is the farthest node */
+static Node *
+get_longer_distance (SkeltrackSkeletonPrivate *priv, gint *distances)
+{
+  gint index;
+
+  index = get_field_maximum (distances,
+                             priv->buffer_width,
+                             priv->buffer_height);
+  if (index == -1)
+    return NULL;
+
+  return priv->node_matrix[index];
+}
+
+/* Each extrema is also given, in supports, how many nodes were
+   around it compared to the smallest component kept in the graph */
+static void
+set_average_extremas (SkeltrackSkeletonPrivate *priv,
+                      GList *extremas,
+                      gfloat *supports)
+{
+  GList *current_extrema, *averaged_extremas = NULL;
+  guint k;
+
+  for (current_extrema = g_list_first (extremas), k = 0;
+       current_extrema != NULL;
+       current_extrema = g_list_next (current_extrema), k++)
+    {
+      GList *current_node;
+      Node *extrema, *node = NULL, *cent = NULL, *node_centroid = NULL;
+      gint avg_x = 0, avg_y = 0, avg_z = 0, length = 0;
+      guint radius = priv->extrema_sphere_radius;
+
+      extrema = (Node *) current_extrema->data;
+
+      for (current_node = g_list_first (priv->graph);
+           current_node != NULL;
+           current_node = g_list_next (current_node))
+        {
+          node = (Node *) current_node->data;
+
+          if (get_squared_distance (extrema, node) < radius * radius)
+            {
+              avg_x += node->x * get_node_area (node);
+              avg_y += node->y * get_node_area (node);
+              avg_z += node->z * get_node_area (node);
+
+              length += get_node_area (node);
+            }
+        }
+
+      supports[k] = CLAMP (length / (gfloat) priv->min_nr_nodes, 0, 1);
+
+      /* if the length is 1 then it is because no other
+         nodes were considered for the average */
+      if (length > 1)
+        {
+          cent = g_slice_new0 (Node);
+          cent->x = avg_x / length;
+          cent->y = avg_y / length;
+          cent->z = avg_z / length;
+          cent->linked_nodes = NULL;
+
+          node_centroid = get_closest_node (priv->graph, cent);
+
+          /* If the new averaged extrema is not already an extrema
+             set it for addition */
+          if (g_list_find (averaged_extremas, node_centroid) == NULL &&
+              g_list_find (extremas, node_centroid) == NULL)
+            {
+              current_extrema->data = node_centroid;
+            }
+
+          g_slice_free (Node, cent);
+        }
+    }
+}
+
+/* The distances of the nodes to the lowest one, before they are
+   lowered by the searches from the extremas, are copied to
+   lowest_distances unless it is NULL. The support of each extrema,
+   in the order of the list, is set in supports. */
+static GList *
+get_extremas (SkeltrackSkeletonPrivate *priv,
+              Node *lowest,
+              gint *lowest_distances,
+              gfloat *supports)
+{
+  gint i, nr_nodes, matrix_size;
+  Node *source, *node;
+  GList *extremas = NULL;
+
+  source = lowest;
+
+  matrix_size = priv->buffer_width * priv->buffer_height;
+  if (priv->distances_matrix == NULL)
+    {
+      priv->distances_matrix = g_slice_alloc0 (matrix_size * sizeof (gint));
+    }
+
+  for (i = 0; i < matrix_size; i++)
+    {
+      priv->distances_matrix[i] = -1;
+    }
+
+  for (i = 0; i < NR_EXTREMAS_TO_SEARCH; i++)
+    {
+      supports[i] = 1;
+    }
+
+  for (nr_nodes = NR_EXTREMAS_TO_SEARCH;
+       source != NULL && nr_nodes > 0;
+       nr_nodes--)
+    {
+      dijkstra_to (priv->graph,
+                   source,
+                   NULL,
+                   priv->buffer_width,
+                   priv->buffer_height,
+                   priv->distances_matrix,
+                   NULL);
+
+      if (nr_nodes == NR_EXTREMAS_TO_SEARCH && lowest_distances != NULL)
+        {
+          memcpy (lowest_distances,
+                  priv->distances_matrix,
+                  matrix_size * sizeof (gint));
+        }
+
+      node = get_longer_distance (priv, priv->distances_matrix);
+
+      if (node == NULL)
+        continue;
+
+      if (node != source)
+        {
+          priv->distances_matrix[node->j * priv->buffer_width + node->i] = 0;
+          source->linked_nodes = g_list_prepend (source->linked_nodes, node);
+          node->linked_nodes = g_list_prepend (node->linked_nodes, source);
+          source = node;
+          extremas = g_list_prepend (extremas, node);
+        }
+    }
+
+  if (priv->extrema_sphere_radius != 0)
+    {
+      set_average_extremas (priv, extremas, supports);
+    }
+
+  return extremas;
+}
+
+/* Computes the cosine and sine of each step of the shoulders search
+   once, so the arc around every head candidate is a rotation of them
+   by its tilt */
+static void
+update_shoulders_arc (SkeltrackSkeletonPrivate *priv)
+{
+  gfloat step;
+  guint nr_steps, k;
+
+  step = priv->shoulders_search_step;
+
+  /* Enough steps to cover the arc when starting from the largest
+     tilt of a head, M_PI_4 */
+  nr_steps = ((priv->shoulders_arc_start_point + priv->shoulders_arc_length) /
+              (gfloat) priv->shoulders_circumference_radius + M_PI_4) /
+    step + 2;
+
+  if (priv->shoulders_arc != NULL &&
+      priv->shoulders_arc_step == step &&
+      priv->shoulders_arc_nr_steps == nr_steps)
+    {
+      return;
+    }
+
+  g_slice_free1 (priv->shoulders_arc_nr_steps * 2 * sizeof (gdouble),
+                 priv->shoulders_arc);
+
+  priv->shoulders_arc = g_slice_alloc (nr_steps * 2 * sizeof (gdouble));
+  priv->shoulders_arc_step = step;
+  priv->shoulders_arc_nr_steps = nr_steps;
+
+  for (k = 0; k < nr_steps; k++)
+    {
+      priv->shoulders_arc[2 * k] = cos (k * step);
+      priv->shoulders_arc[2 * k + 1] = sin (k * step);
+    }
+}
+
+/* The label of the user a node belongs to, which is the one of the
+   node it was joined to if its component was bridged */
+static Label *
+get_node_user_label (Node *node)
+{
+  Label *label = node->label;
+
+  if (label->bridge_node != NULL)
+    label = label->to_node->label;
+
+  return label;
+}
+
+/* The coverage is the part of the arc, from its start, that is
+   covered by the nodes until the shoulder. When tracking several
+   users, the nodes of the others are not part of the arc. */
+static Node *
+get_shoulder_node (SkeltrackSkeletonPrivate *priv,
+                   gfloat alpha,
+                   gfloat step,
+                   gint x_node,
+                   gint y_node,
+                   gint z_centroid,
+                   gfloat *coverage)
+{
+  guint radius, arc_start_point, arc_length, current_i, current_j, k;
+  gfloat last_node_arc, current_arc, current_x, current_y;
+  gdouble cos_alpha, sin_alpha, direction;
+  Node *current_node = NULL;
+  Node *last_node = NULL;
+
+  radius = priv->shoulders_circumference_radius;
+  arc_start_point = priv->shoulders_arc_start_point;
+  arc_length = priv->shoulders_arc_length;
+
+  /* The arc starts at the bottom of the circumference, M_PI_2, turned
+     by alpha; so each step at angle M_PI_2 + alpha + k * step is at
+     (-sin (alpha + k * step), cos (alpha + k * step)) */
+  cos_alpha = cos (alpha);
+  sin_alpha = sin (alpha);
+  direction = step < 0 ? -1 : 1;
+
+  current_x = x_node - radius * sin_alpha;
+  current_y = y_node + radius * cos_alpha;
+  current_arc = 0;
+  last_node_arc = 0;
+  current_node = NULL;
+  last_node = NULL;
+
+  for (k = 1; current_arc <= (arc_start_point + arc_length); k++)
+    {
+      gdouble cos_step, sin_step;
+
+      convert_mm_to_screen_coords (&priv->projection,
+                                   current_x,
+                                   current_y,
+                                   z_centroid,
+                                   &current_i,
+                                   &current_j);
+
+      if (current_i >= priv->buffer_width || current_j >= priv->buffer_height)
+        break;
+
+      current_node = priv->node_matrix[current_j * priv->buffer_width +
+                                       current_i];
+
+      if (current_node != NULL &&
+          (priv->user_label == NULL ||
+           get_node_user_label (current_node) == priv->user_label))
+        {
+          last_node = current_node;
+          last_node_arc = current_arc;
+        }
+
+      /* The table covers the whole arc, this only guards its end */
+      if (k == priv->shoulders_arc_nr_steps)
+        break;
+
+      cos_step = priv->shoulders_arc[2 * k];
+      sin_step = direction * priv->shoulders_arc[2 * k + 1];
+      current_x = x_node -
+        radius * (sin_alpha * cos_step + cos_alpha * sin_step);
+      current_y = y_node +
+        radius * (cos_alpha * cos_step - sin_alpha * sin_step);
+      current_arc = ABS (alpha + k * step) * radius;
+    }
+
+  if (last_node_arc < arc_start_point)
+    return NULL;
+
+  *coverage = CLAMP (last_node_arc / (arc_start_point + arc_length), 0, 1);
+
+  return last_node;
+}
+
+static gboolean
+check_if_node_can_be_head (SkeltrackSkeletonPrivate *priv,
+                           Node *node,
+                           Node *centroid,
+                           Node **left_shoulder,
+                           Node **right_shoulder,
+                           gfloat *left_coverage,
+                           gfloat *right_coverage)
+{
+  gfloat alpha;
+  Node *found_right_shoulder = NULL, *found_left_shoulder = NULL;
+
+  *left_shoulder = NULL;
+  *right_shoulder = NULL;
+
+  if (node->j > centroid->j)
+    return FALSE;
+
+  if ((node->y - centroid->y) != 0)
+    alpha = atan( ABS (node->x - centroid->x) / ABS (node->y - centroid->y));
+  else
+    return FALSE;
+
+  /* too much tilt, cannot be the head */
+  if (alpha >= M_PI_4)
+    return FALSE;
+
+  if (node->x < centroid->x)
+    alpha = -alpha;
+
+  update_shoulders_arc (priv);
+
+  found_right_shoulder = get_shoulder_node (priv,
+                                            alpha,
+                                            priv->shoulders_search_step,
+                                            node->x,
+                                            node->y,
+                                            centroid->z,
+                                            right_coverage);
+  if (found_right_shoulder == NULL)
+    return FALSE;
+
+  found_left_shoulder = get_shoulder_node (priv,
+                                           alpha,
+                                           -priv->shoulders_search_step,
+                                           node->x,
+                                           node->y,
+                                           centroid->z,
+                                           left_coverage);
+
+  if (found_left_shoulder == NULL)
+    return FALSE;
+
+  *right_shoulder = found_right_shoulder;
+  *left_shoulder = found_left_shoulder;
+
+  return TRUE;
+}
+
+static gboolean
+get_head_and_shoulders (SkeltrackSkeletonPrivate *priv,
+                        GList  *extremas,
+                        Node   *centroid,
+                        Node  **head,
+                        Node  **left_shoulder,
+                        Node  **right_shoulder,
+                        gfloat *left_coverage,
+                        gfloat *right_coverage)
+{
+  Node *node;
+  GList *current_extrema;
+
+  for (current_extrema = g_list_first (extremas);
+       current_extrema != NULL;
+       current_extrema = g_list_next (current_extrema))
+    {
+      node = (Node *) current_extrema->data;
+
+      if (check_if_node_can_be_head (priv,
+                                     node,
+                                     centroid,
+                                     left_shoulder,
+                                     right_shoulder,
+                                     left_coverage,
+                                     right_coverage))
+        {
+          *head = node;
+          return TRUE;
+        }
+    }
+  return FALSE;
+}
+
+static void
+set_joint_confidence (SkeltrackJointList joints,
+                      SkeltrackJointId id,
+                      gfloat confidence)
+{
+  if (joints != NULL && joints[id] != NULL && confidence >= 0)
+    joints[id]->confidence = confidence;
+}
+
+/* The confidence of one of the extremas found for an arm, from its
+   support and how far along the arm it is from the shoulder compared
+   to the hands minimum distance, or -1 if the node is not one of them */
+static gfloat
+get_arm_extrema_confidence (SkeltrackSkeletonPrivate *priv,
+                            GList *extremas,
+                            const gfloat *supports,
+                            Node **arm_extremas,
+                            gint **distances,
+                            Node *node)
+{
+  gint k, distance;
+
+  if (node == NULL)
+    return -1;
+
+  for (k = 0; k < 2; k++)
+    {
+      if (arm_extremas[k] != node)
+        continue;
+
+      distance = distances[k][node->j * priv->buffer_width + node->i];
+      return supports[g_list_index (extremas, node)] *
+        CLAMP (distance / (gfloat) priv->hands_minimum_distance, 0, 1);
+    }
+
+  return -1;
+}
+
+/* An elbow found on the path to the hand is as reliable as the hand */
+static void
+set_arm_confidence (SkeltrackSkeletonPrivate *priv,
+                    GList *extremas,
+                    const gfloat *supports,
+                    Node **arm_extremas,
+                    gint **distances,
+                    Node *elbow,
+                    Node *hand,
+                    SkeltrackJointId elbow_id,
+                    SkeltrackJointId hand_id,
+                    SkeltrackJointList joints)
+{
+  gfloat elbow_confidence, hand_confidence;
+
+  hand_confidence = get_arm_extrema_confidence (priv,
+                                                extremas,
+                                                supports,
+                                                arm_extremas,
+                                                distances,
+                                                hand);
+  elbow_confidence = get_arm_extrema_confidence (priv,
+                                                 extremas,
+                                                 supports,
+                                                 arm_extremas,
+                                                 distances,
+                                                 elbow);
+  if (elbow_confidence < 0)
+    elbow_confidence = hand_confidence;
+
+  set_joint_confidence (joints, hand_id, hand_confidence);
+  set_joint_confidence (joints, elbow_id, elbow_confidence);
+}
+
+static void
+identify_arm_extrema (gint *distances,
+                      Node **previous_nodes,
+                      gint width,
+                      gint hand_distance,
+                      Node *extrema,
+                      Node **elbow_extrema,
+                      Node **hand_extrema)
+{
+  gint total_dist;
+
+  if (extrema == NULL)
+    return;
+
+  total_dist = distances[width * extrema->j + extrema->i];
+  if (total_dist < hand_distance)
+    {
+      *elbow_extrema = extrema;
+      *hand_extrema = NULL;
+    }
+  else
+    {
+      Node *previous;
+      gint elbow_dist;
+
+      previous = previous_nodes[extrema->j * width + extrema->i];
+      elbow_dist = total_dist / 2;
+      while (previous &&
+             distances[previous->j * width + previous->i] > elbow_dist)
+        {
+          previous = previous_nodes[previous->j * width + previous->i];
+        }
+      *elbow_extrema = previous;
+      *hand_extrema = extrema;
+    }
+}
+
+/* Whether the extremas are still close to the ones given to each arm
+   in the previous frame, each to a single one of them, so that
+   assignment can be kept without comparing the paths from both
+   shoulders */
+static gboolean
+can_reuse_arm_assignment (SkeltrackSkeletonPrivate *priv,
+                          Node *ext_a,
+                          Node *ext_b,
+                          gboolean *a_is_left)
+{
+  ArmAssignment *assignment = &priv->user->arm_assignment;
+  gboolean a_left, a_right, b_left, b_right;
+
+  if (! assignment->valid ||
+      assignment->reuses >= ARM_ASSIGNMENT_MAXIMUM_REUSES)
+    return FALSE;
+
+  a_left = get_distance_from_joint (ext_a, &assignment->left) <=
+    ARM_ASSIGNMENT_MAXIMUM_DISPLACEMENT;
+  a_right = get_distance_from_joint (ext_a, &assignment->right) <=
+    ARM_ASSIGNMENT_MAXIMUM_DISPLACEMENT;
+  b_left = get_distance_from_joint (ext_b, &assignment->left) <=
+    ARM_ASSIGNMENT_MAXIMUM_DISPLACEMENT;
+  b_right = get_distance_from_joint (ext_b, &assignment->right) <=
+    ARM_ASSIGNMENT_MAXIMUM_DISPLACEMENT;
+
+  if (a_left && b_right && ! a_right && ! b_left)
+    {
+      *a_is_left = TRUE;
+      return TRUE;
+    }
+
+  if (a_right && b_left && ! a_left && ! b_right)
+    {
+      *a_is_left = FALSE;
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gboolean
+is_clear_arm_assignment (gint left_distance, gint right_distance)
+{
+  return left_distance != -1 && right_distance != -1 &&
+    ABS (left_distance - right_distance) >= ARM_ASSIGNMENT_MINIMUM_MARGIN;
+}
+
+static void
+update_arm_assignment (SkeltrackSkeletonPrivate *priv,
+                       Node *left_extrema,
+                       Node *right_extrema,
+                       gboolean reused)
+{
+  ArmAssignment *assignment = &priv->user->arm_assignment;
+
+  assignment->valid = TRUE;
+  assignment->reuses = reused ? assignment->reuses + 1 : 0;
+
+  assignment->left.x = left_extrema->x;
+  assignment->left.y = left_extrema->y;
+  assignment->left.z = left_extrema->z;
+  assignment->right.x = right_extrema->x;
+  assignment->right.y = right_extrema->y;
+  assignment->right.z = right_extrema->z;
+}
+
+/* Finds the shortest path from the shoulder to the extrema, unless it
+   was already found */
+static void
+find_arm_path (SkeltrackSkeletonPrivate *priv,
+               Node *shoulder,
+               Node *extrema,
+               gint **distances,
+               Node ***previous)
+{
+  gint matrix_size;
+
+  if (*distances != NULL)
+    return;
+
+  matrix_size = priv->buffer_width * priv->buffer_height;
+  *previous = g_slice_alloc0 (matrix_size * sizeof (Node *));
+  *distances = create_new_dist_matrix (matrix_size);
+  dijkstra_to (priv->graph,
+               shoulder,
+               extrema,
+               priv->buffer_width,
+               priv->buffer_height,
+               *distances,
+               *previous);
+}
+
+static void
+set_left_and_right_from_extremas (SkeltrackSkeletonPrivate *priv,
+                                  GList *extremas,
+                                  const gfloat *supports,
+                                  Node *head,
+                                  Node *left_shoulder,
+                                  Node *right_shoulder,
+                                  SkeltrackJointList *joints)
+{
+  gint *dist_left_a = NULL;
+  gint *dist_left_b = NULL;
+  gint *dist_right_a = NULL;
+  gint *dist_right_b = NULL;
+  gint total_dist_left_a = -1;
+  gint total_dist_right_a = -1;
+  gint total_dist_left_b = -1;
+  gint total_dist_right_b = -1;
+  gint *distances_left[2] = {NULL, NULL};
+  gint *distances_right[2] = {NULL, NULL};
+  gint index_left = -1;
+  gint index_right = -1;
+  Node *elbow_extrema, *hand_extrema;
+  Node **previous_left_a = NULL;
+  Node **previous_left_b = NULL;
+  Node **previous_right_a = NULL;
+  Node **previous_right_b = NULL;
+  Node **previous_left[2] = {NULL, NULL};
+  Node **previous_right[2] = {NULL, NULL};
+  Node *ext_a = NULL;
+  Node *ext_b = NULL;
+  Node *left_extrema[2] = {NULL, NULL};
+  Node *right_extrema[2] = {NULL, NULL};
+  GList *current_extrema;
+  gboolean a_is_left = FALSE;
+  gboolean reused = FALSE;
+  gint width, matrix_size;
+
+  for (current_extrema = g_list_first (extremas);
+       current_extrema != NULL;
+       current_extrema = g_list_next (current_extrema))
+    {
+      Node *node;
+      node = (Node *) current_extrema->data;
+      if (node != head)
+        {
+          if (ext_a == NULL)
+            ext_a = node;
+          else
+            ext_b = node;
+        }
+    }
+
+  if (head == NULL)
+    {
+      priv->user->arm_assignment.valid = FALSE;
+      return;
+    }
+
+  width = priv->buffer_width;
+  matrix_size = width * priv->buffer_height;
+
+  /* Only the paths along the arms are needed when the extremas were
+     given to the same arms in the previous frame */
+  if (priv->enable_temporal_arm_assignment &&
+      can_reuse_arm_assignment (priv, ext_a, ext_b, &a_is_left))
+    {
+      if (a_is_left)
+        {
+          find_arm_path (priv, left_shoulder, ext_a,
+                         &dist_left_a, &previous_left_a);
+          find_arm_path (priv, right_shoulder, ext_b,
+                         &dist_right_b, &previous_right_b);
+          total_dist_left_a = dist_left_a[ext_a->j * width + ext_a->i];
+          total_dist_right_b = dist_right_b[ext_b->j * width + ext_b->i];
+          reused = total_dist_left_a != -1 && total_dist_right_b != -1;
+        }
+      else
+        {
+          find_arm_path (priv, left_shoulder, ext_b,
+                         &dist_left_b, &previous_left_b);
+          find_arm_path (priv, right_shoulder, ext_a,
+                         &dist_right_a, &previous_right_a);
+          total_dist_left_b = dist_left_b[ext_b->j * width + ext_b->i];
+          total_dist_right_a = dist_right_a[ext_a->j * width + ext_a->i];
+          reused = total_dist_left_b != -1 && total_dist_right_a != -1;
+        }
+    }
+
+  if (reused)
+    {
+      index_left = 0;
+      index_right = 0;
+      if (a_is_left)
+        {
+          left_extrema[0] = ext_a;
+          distances_left[0] = dist_left_a;
+          previous_left[0] = previous_left_a;
+          right_extrema[0] = ext_b;
+          distances_right[0] = dist_right_b;
+          previous_right[0] = previous_right_b;
+        }
+      else
+        {
+          left_extrema[0] = ext_b;
+          distances_left[0] = dist_left_b;
+          previous_left[0] = previous_left_b;
+          right_extrema[0] = ext_a;
+          distances_right[0] = dist_right_a;
+          previous_right[0] = previous_right_a;
+        }
+    }
+  else
+    {
+      find_arm_path (priv, left_shoulder, ext_a,
+                     &dist_left_a, &previous_left_a);
+      find_arm_path (priv, left_shoulder, ext_b,
+                     &dist_left_b, &previous_left_b);
+      find_arm_path (priv, right_shoulder, ext_a,
+                     &dist_right_a, &previous_right_a);
+      find_arm_path (priv, right_shoulder, ext_b,
+                     &dist_right_b, &previous_right_b);
+
+      total_dist_left_a = dist_left_a[ext_a->j * width + ext_a->i];
+      total_dist_right_a = dist_right_a[ext_a->j * width + ext_a->i];
+      total_dist_left_b = dist_left_b[ext_b->j * width + ext_b->i];
+      total_dist_right_b = dist_right_b[ext_b->j * width + ext_b->i];
+
+      if (total_dist_left_a < total_dist_right_a)
+        {
+          index_left++;
+          left_extrema[index_left] = ext_a;
+          distances_left[index_left] = dist_left_a;
+          previous_left[index_left] = previous_left_a;
+        }
+      else
+        {
+          index_right++;
+          right_extrema[index_right] = ext_a;
+          distances_right[index_right] = dist_right_a;
+          previous_right[index_right] = previous_right_a;
+        }
+
+      if (total_dist_left_b < total_dist_right_b)
+        {
+          index_left++;
+          left_extrema[index_left] = ext_b;
+          distances_left[index_left] = dist_left_b;
+          previous_left[index_left] = previous_left_b;
+        }
+      else
+        {
+          index_right++;
+          right_extrema[index_right] = ext_b;
+          distances_right[index_right] = dist_right_b;
+          previous_right[index_right] = previous_right_b;
+        }
+    }
+
+  /* The assignment is kept for the next frames only if each arm got
+     one of the extremas, clearly closer to its shoulder */
+  if (reused ||
+      (index_left == 0 && index_right == 0 &&
+       is_clear_arm_assignment (total_dist_left_a, total_dist_right_a) &&
+       is_clear_arm_assignment (total_dist_left_b, total_dist_right_b)))
+    {
+      update_arm_assignment (priv,
+                             left_extrema[0],
+                             right_extrema[0],
+                             reused);
+    }
+  else
+    {
+      priv->user->arm_assignment.valid = FALSE;
+    }
+
+  elbow_extrema = NULL;
+  hand_extrema = NULL;
+  identify_arm_extrema (distances_left[0],
+                        previous_left[0],
+                        width,
+                        priv->hands_minimum_distance,
+                        left_extrema[0],
+                        &elbow_extrema,
+                        &hand_extrema);
+
+  /* Two left extremas */
+  if (index_left == 1)
+    {
+      if (hand_extrema == NULL)
+        {
+          hand_extrema = left_extrema[1];
+          elbow_extrema = left_extrema[0];
+        }
+      else
+        {
+          hand_extrema = left_extrema[0];
+          elbow_extrema = left_extrema[1];
+        }
+    }
+
+  set_joint_from_node (joints,
+                       elbow_extrema,
+                       SKELTRACK_JOINT_ID_LEFT_ELBOW,
+                       priv->dimension_reduction);
+  set_joint_from_node (joints,
+                       hand_extrema,
+                       SKELTRACK_JOINT_ID_LEFT_HAND,
+                       priv->dimension_reduction);
+  set_arm_confidence (priv,
+                      extremas,
+                      supports,
+                      left_extrema,
+                      distances_left,
+                      elbow_extrema,
+                      hand_extrema,
+                      SKELTRACK_JOINT_ID_LEFT_ELBOW,
+                      SKELTRACK_JOINT_ID_LEFT_HAND,
+                      *joints);
+
+
+  elbow_extrema = NULL;
+  hand_extrema = NULL;
+  identify_arm_extrema (distances_right[0],
+                        previous_right[0],
+                        width,
+                        priv->hands_minimum_distance,
+                        right_extrema[0],
+                        &elbow_extrema,
+                        &hand_extrema);
+
+  /* Two right extremas */
+  if (index_right == 1)
+    {
+      if (hand_extrema == NULL)
+        {
+          hand_extrema = right_extrema[1];
+          elbow_extrema = right_extrema[0];
+        }
+      else
+        {
+          hand_extrema = right_extrema[0];
+          elbow_extrema = right_extrema[1];
+        }
+    }
+
+  set_joint_from_node (joints,
+                       elbow_extrema,
+                       SKELTRACK_JOINT_ID_RIGHT_ELBOW,
+                       priv->dimension_reduction);
+  set_joint_from_node (joints,
+                       hand_extrema,
+                       SKELTRACK_JOINT_ID_RIGHT_HAND,
+                       priv->dimension_reduction);
+  set_arm_confidence (priv,
+                      extremas,
+                      supports,
+                      right_extrema,
+                      distances_right,
+                      elbow_extrema,
+                      hand_extrema,
+                      SKELTRACK_JOINT_ID_RIGHT_ELBOW,
+                      SKELTRACK_JOINT_ID_RIGHT_HAND,
+                      *joints);
+
+  g_slice_free1 (matrix_size * sizeof (Node *), previous_left_a);
+  g_slice_free1 (matrix_size * sizeof (Node *), previous_left_b);
+  g_slice_free1 (matrix_size * sizeof (Node *), previous_right_a);
+  g_slice_free1 (matrix_size * sizeof (Node *), previous_right_b);
+
+  g_slice_free1 (matrix_size * sizeof (gint), dist_left_a);
+  g_slice_free1 (matrix_size * sizeof (gint), dist_left_b);
+  g_slice_free1 (matrix_size * sizeof (gint), dist_right_a);
+  g_slice_free1 (matrix_size * sizeof (gint), dist_right_b);
+}
+
+static Node *
+get_adjusted_shoulder (const Projection *projection,
+                       GList *graph,
+                       Node *centroid,
+                       Node *head,
+                       Node *shoulder)
+{
+  Node *virtual_shoulder, *adjusted_shoulder = NULL;
+  virtual_shoulder = g_slice_new (Node);
+  virtual_shoulder->x = shoulder->x;
+  virtual_shoulder->y = shoulder->y;
+  virtual_shoulder->z = centroid->z;
+
+  convert_mm_to_screen_coords (projection,
+                               virtual_shoulder->x,
+                               virtual_shoulder->y,
+                               virtual_shoulder->z,
+                               (guint *) &virtual_shoulder->i,
+                               (guint *) &virtual_shoulder->j);
+
+  adjusted_shoulder = get_closest_torso_node (graph,
+                                              virtual_shoulder,
+                                              head);
+  g_slice_free (Node, virtual_shoulder);
+
+  return adjusted_shoulder;
+}
+
+static gboolean
+get_joints_region (SkeltrackSkeleton *self,
+                   SkeltrackJointList joints,
+                   SkeltrackJointList trend_joints,
+                   Region *region)
+{
+  SkeltrackSkeletonPrivate *priv;
+  gint min_i, max_i, min_j;
+  guint i;
+
+  priv = self->priv;
+
+  if (joints == NULL || joints[SKELTRACK_JOINT_ID_HEAD] == NULL)
+    return FALSE;
+
+  min_i = priv->buffer_width;
+  max_i = -1;
+  min_j = priv->buffer_height;
+
+  for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+    {
+      SkeltrackJoint *joint, *trend;
+      guint margin;
+      gint cells, cell_i, cell_j;
+
+      joint = joints[i];
+      if (joint == NULL)
+        continue;
+
+      /* Expand the margin by the distance the joint is
+         expected to move until the next frame */
+      margin = priv->region_of_interest_margin;
+      if (trend_joints != NULL)
+        {
+          trend = trend_joints[i];
+          if (trend != NULL)
+            margin += REGION_OF_INTEREST_VELOCITY_FACTOR *
+              MAX (ABS (trend->x), ABS (trend->y));
+        }
+
+      cells = convert_mm_to_screen_length (&priv->projection,
+                                           margin,
+                                           joint->z);
+      cell_i = joint->screen_x / priv->dimension_reduction;
+      cell_j = joint->screen_y / priv->dimension_reduction;
+
+      min_i = MIN (min_i, cell_i - cells);
+      max_i = MAX (max_i, cell_i + cells);
+      min_j = MIN (min_j, cell_j - cells);
+    }
+
+  region->x = MAX (min_i, 0);
+  region->y = CLAMP (min_j, 0, (gint) priv->buffer_height);
+  region->width = MIN (max_i + 1, (gint) priv->buffer_width) - region->x;
+  /* The region goes down to the bottom of the buffer so the lowest
+     node, from where the extremas are searched, is still found */
+  region->height = priv->buffer_height - region->y;
+
+  return region->width > 0 && region->height > 0;
+}
+
+static gboolean
+get_region_of_interest (SkeltrackSkeleton *self, Region *region)
+{
+  SkeltrackJointList trend_joints = NULL;
+
+  if (self->priv->enable_smoothing)
+    trend_joints = self->priv->user->smooth_data.trend_joints;
+
+  return get_joints_region (self,
+                            self->priv->previous_joints,
+                            trend_joints,
+                            region);
+}
+
+/* Whether the nodes of the user stay away from the borders of the
+   region, otherwise the user may go on outside of it */
+static gboolean
+graph_inside_region (SkeltrackSkeleton *self, Region *region)
+{
+  GList *current;
+
+  if (self->priv->main_component == NULL)
+    return FALSE;
+
+  for (current = g_list_first (self->priv->graph);
+       current != NULL;
+       current = g_list_next (current))
+    {
+      Node *node = (Node *) current->data;
+
+      /* Borders of the region that are also borders of the
+         buffer do not count */
+      if ((region->x > 0 && node->i <= region->x) ||
+          (region->x + region->width < self->priv->buffer_width &&
+           node->i >= region->x + region->width - 1) ||
+          (region->y > 0 && node->j <= region->y))
+        {
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static void
+clean_graph (SkeltrackSkeleton *self)
+{
+  GList *current;
 
-  priv = self->priv;
+  if (!self->priv->graph_is_persistent)
+    {
+      clean_nodes (self->priv->graph);
+      return;
+    }
 
+  /* The nodes belong to the node grid so only what was
+     changed in them while tracking this frame is undone */
+  for (current = g_list_first (self->priv->labels);
+       current != NULL;
+       current = g_list_next (current))
+    {
+      Label *label = (Label *) current->data;
+      if (label->bridge_node == NULL)
+        continue;
 
-  if (priv->node_matrix == NULL)
+      restore_node_grid_neighbors (&self->priv->node_grid,
+                                   label->bridge_node);
+      restore_node_grid_neighbors (&self->priv->node_grid,
+                                   label->to_node);
+    }
+
+  for (current = g_list_first (self->priv->detached_nodes);
+       current != NULL;
+       current = g_list_next (current))
     {
-      priv->node_matrix = g_slice_alloc0 (width * height * sizeof (Node *));
+      restore_node_grid_neighbors (&self->priv->node_grid,
+                                   (Node *) current->data);
     }
-  else
+  g_list_free (self->priv->detached_nodes);
+  self->priv->detached_nodes = NULL;
+
+  for (current = g_list_first (self->priv->graph);
+       current != NULL;
+       current = g_list_next (current))
     {
-      memset (self->priv->node_matrix,
-              0,
-              width * height * sizeof (Node *));
+      Node *node = (Node *) current->data;
+      g_list_free (node->linked_nodes);
+      node->linked_nodes = NULL;
     }
+}
+
+/* Drops the joints that were found on the way to the requested ones */
+static void
+mask_joints (SkeltrackJointList joints, SkeltrackJointMask mask)
+{
+  guint i;
 
-  for (i = 0; i < width; i++)
+  for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
     {
-      for (j = 0; j < height; j++)
+      if (joints[i] != NULL && (mask & (1 << i)) == 0)
         {
-          gint south, north, west;
-          Label *lowest_index_label = NULL;
-          Label *neighbor_labels[4] = {NULL, NULL, NULL, NULL};
+          skeltrack_joint_free (joints[i]);
+          joints[i] = NULL;
+        }
+    }
+}
 
-          value = buffer[j * width + i];
-          if (value == 0)
-            continue;
+/* The lowest node of the centroid's column is where the legs split
+   when they are apart, so the nodes below it on each side of it are
+   the legs */
+static gboolean
+is_leg_node (SkeltrackSkeletonPrivate *priv,
+             const gint *distances,
+             Node *node,
+             Node *lowest,
+             gint side)
+{
+  return node->j > lowest->j &&
+    (node->i - lowest->i) * side > 0 &&
+    distances[node->j * priv->buffer_width + node->i] != -1;
+}
 
-          node = g_slice_new0 (Node);
-          node->i = i;
-          node->j = j;
-          node->z = value;
-          convert_screen_coords_to_mm (self->priv->buffer_width,
-                                       self->priv->buffer_height,
-                                       self->priv->dimension_reduction,
-                                       i, j,
-                                       node->z,
-                                       &(node->x),
-                                       &(node->y));
-          node->neighbors = NULL;
-          node->linked_nodes = NULL;
-
-          index = 0;
-
-          south = j + 1;
-          north = j - 1;
-          west = i - 1;
-
-          /* West */
-          index = join_neighbor (self,
-                                 node,
-                                 neighbor_labels,
-                                 index,
-                                 west, j);
-          /* South West*/
-          index = join_neighbor (self,
-                                 node,
-                                 neighbor_labels,
-                                 index,
-                                 west, south);
-          /* North */
-          index = join_neighbor (self,
-                                 node,
-                                 neighbor_labels,
-                                 index,
-                                 i, north);
-
-          /* North West */
-          index = join_neighbor (self,
-                                 node,
-                                 neighbor_labels,
-                                 index,
-                                 west, north);
-
-          lowest_index_label = get_lowest_index_label (neighbor_labels);
-
-          /* No neighbors */
-          if (lowest_index_label == NULL)
-            {
-              Label *label;
-              next_label++;
-              label = new_label (next_label);
-              labels = g_list_prepend (labels, label);
-              lowest_index_label = label;
-            }
-          else
-            {
-              for (index = 0; index < 4; index++)
-                {
-                  if (neighbor_labels[index] != NULL)
-                    {
-                      label_union (neighbor_labels[index], lowest_index_label);
-                    }
-                }
-            }
+/* Gets the center of the cross section of a leg made by the nodes at
+   the given distance from where the legs split */
+static gboolean
+get_leg_section_center (SkeltrackSkeletonPrivate *priv,
+                        const gint *distances,
+                        Node *lowest,
+                        gint side,
+                        gint distance,
+                        Node *center)
+{
+  GList *current_node;
+  gint avg_x = 0, avg_y = 0, avg_z = 0, length = 0;
 
-          node->label = lowest_index_label;
-          nodes = g_list_prepend(nodes, node);
-          priv->node_matrix[width * node->j + node->i] = node;
-        }
+  for (current_node = g_list_first (priv->graph);
+       current_node != NULL;
+       current_node = g_list_next (current_node))
+    {
+      Node *node = (Node *) current_node->data;
+      gint node_distance;
+
+      if (!is_leg_node (priv, distances, node, lowest, side))
+        continue;
+
+      /* Edges are shorter than the threshold, so every path down the
+         leg has a node in the section */
+      node_distance = distances[node->j * priv->buffer_width + node->i];
+      if (ABS (node_distance - distance) > priv->distance_threshold)
+        continue;
+
+      avg_x += node->x * get_node_area (node);
+      avg_y += node->y * get_node_area (node);
+      avg_z += node->z * get_node_area (node);
+      length += get_node_area (node);
     }
 
-  for (current_node = g_list_first (nodes);
+  if (length == 0)
+    return FALSE;
+
+  center->x = avg_x / length;
+  center->y = avg_y / length;
+  center->z = avg_z / length;
+
+  return TRUE;
+}
+
+/* Gets the node closest to the center of the cross section of a leg
+   made by the nodes at the given distance from where the legs split */
+static Node *
+get_leg_section_node (SkeltrackSkeletonPrivate *priv,
+                      const gint *distances,
+                      Node *lowest,
+                      gint side,
+                      gint distance)
+{
+  GList *current_node;
+  Node center, *closest = NULL;
+  guint closest_distance = 0;
+
+  if (!get_leg_section_center (priv, distances, lowest, side, distance,
+                               &center))
+    return NULL;
+
+  for (current_node = g_list_first (priv->graph);
        current_node != NULL;
        current_node = g_list_next (current_node))
     {
       Node *node = (Node *) current_node->data;
-      node->label = label_find (node->label);
-      node->label->nodes = g_list_prepend (node->label->nodes,
-                                          node);
+      gint node_distance;
+      guint squared_distance;
 
-      /* Assign lower node so we can extract the
-         lower graph's component */
-      if (node->label->lower_screen_y == -1 ||
-         node->j > node->label->lower_screen_y)
-      {
-        node->label->lower_screen_y = node->j;
-      }
+      if (!is_leg_node (priv, distances, node, lowest, side))
+        continue;
 
-      /* Assign farther to the camera node so we
-         can extract the main graph component */
-      if (node->label->higher_z == -1 ||
-         node->z > node->label->higher_z)
-        {
-          node->label->higher_z = node->z;
-        }
+      node_distance = distances[node->j * priv->buffer_width + node->i];
+      if (ABS (node_distance - distance) > priv->distance_threshold)
+        continue;
 
-      /* Assign closer to the camera node so we
-         can extract the main graph component */
-      if (node->label->lower_z == -1 ||
-         node->z < node->label->lower_z)
+      squared_distance = get_squared_distance (node, &center);
+      if (closest == NULL || squared_distance < closest_distance)
         {
-          node->label->lower_z = node->z;
+          closest = node;
+          closest_distance = squared_distance;
         }
     }
 
-  for (current_label = g_list_first (labels);
-       current_label != NULL;
-       current_label = g_list_next (current_label))
+  return closest;
+}
+
+/* The hip is inside the pelvis, above where the legs split, so it is
+   the node of the user closest to the point that is as far above the
+   split as the top section of the leg is below it, and as far out as
+   the center of that section */
+static Node *
+get_hip_node (SkeltrackSkeletonPrivate *priv,
+              const gint *distances,
+              Node *lowest,
+              gint side,
+              gint distance)
+{
+  Node hip;
+
+  if (!get_leg_section_center (priv, distances, lowest, side, distance,
+                               &hip))
+    return NULL;
+
+  hip.y = lowest->y - ABS (hip.y - lowest->y);
+
+  return get_closest_node (priv->main_component, &hip);
+}
+
+/* Finds the joints of a leg from the distances to the lowest node
+   computed by get_extremas(), so no other search of the graph is
+   needed: the foot is the farthest node of the leg, the knee is the
+   center of its section at a fraction of the distance to the foot and
+   the hip is above the split, over the top section of the leg */
+static void
+set_leg_from_distances (SkeltrackSkeletonPrivate *priv,
+                        const gint *distances,
+                        Node *lowest,
+                        gint side,
+                        SkeltrackJointId hip_id,
+                        SkeltrackJointId knee_id,
+                        SkeltrackJointId foot_id,
+                        SkeltrackJointList *joints)
+{
+  GList *current_node;
+  Node *foot = NULL;
+  gint foot_distance = -1;
+
+  if (lowest == NULL)
+    return;
+
+  for (current_node = g_list_first (priv->graph);
+       current_node != NULL;
+       current_node = g_list_next (current_node))
     {
-      Label *label;
-      GList *current_nodes;
+      Node *node = (Node *) current_node->data;
+      gint distance;
 
-      label = (Label *) current_label->data;
-      current_nodes = label->nodes;
+      if (!is_leg_node (priv, distances, node, lowest, side))
+        continue;
 
-      label->normalized_num_nodes =  g_list_length (current_nodes) *
-                                     ((label->higher_z - label->lower_z)/2 +
-                                     label->lower_z) *
-                                     (pow (DIMENSION_REDUCTION, 2)/2) /
-                                     1000000;
+      distance = distances[node->j * priv->buffer_width + node->i];
+      if (distance > foot_distance)
+        {
+          foot = node;
+          foot_distance = distance;
+        }
     }
 
-  main_component_label = get_main_component (nodes,
-                                             priv->focus_node,
-                                             priv->torso_minimum_number_nodes);
+  if (foot == NULL)
+    return;
 
-  current_label = g_list_first (labels);
-  while (current_label != NULL)
+  set_joint_from_node (joints,
+                       get_hip_node (priv,
+                                     distances,
+                                     lowest,
+                                     side,
+                                     foot_distance * LEG_HIP_FRACTION),
+                       hip_id,
+                       priv->dimension_reduction);
+  set_joint_from_node (joints,
+                       get_leg_section_node (priv,
+                                             distances,
+                                             lowest,
+                                             side,
+                                             foot_distance * LEG_KNEE_FRACTION),
+                       knee_id,
+                       priv->dimension_reduction);
+  set_joint_from_node (joints,
+                       foot,
+                       foot_id,
+                       priv->dimension_reduction);
+}
+
+/* Tracks the joints in the graph already made, starting from its
+   main component */
+static SkeltrackJointList
+track_joints_in_graph (SkeltrackSkeletonPrivate *priv)
+{
+  Node * centroid;
+  Node *head = NULL;
+  Node *right_shoulder = NULL;
+  Node *left_shoulder = NULL;
+  Node *lowest;
+  GList *extremas;
+  SkeltrackJointList joints = NULL;
+  SkeltrackJointMask mask;
+  gboolean track_arms;
+  gint *lowest_distances = NULL;
+  gsize matrix_size;
+  gfloat supports[NR_EXTREMAS_TO_SEARCH];
+  gfloat left_coverage = 0, right_coverage = 0, head_confidence;
+
+  /* The arms are searched from the adjusted shoulders */
+  mask = priv->joint_mask;
+  track_arms = (mask & JOINT_MASK_ARMS) != 0;
+
+  matrix_size = priv->buffer_width * priv->buffer_height;
+  if (mask & SKELTRACK_JOINT_MASK_LOWER_BODY)
+    lowest_distances = g_slice_alloc (matrix_size * sizeof (gint));
+
+  centroid = get_centroid (priv);
+  lowest = get_lowest (priv, centroid);
+  extremas = get_extremas (priv, lowest, lowest_distances, supports);
+
+  if (g_list_length (extremas) > 2)
     {
-      Label *label;
-      label = (Label *) current_label->data;
+      if (priv->user->previous_head)
+        {
+          gint distance;
+          gboolean can_be_head = FALSE;
+          head = get_closest_node_to_joint (extremas,
+                                            priv->user->previous_head,
+                                            &distance);
+          if (head != NULL &&
+              distance < GRAPH_DISTANCE_THRESHOLD)
+            {
+              can_be_head = check_if_node_can_be_head (priv,
+                                                       head,
+                                                       centroid,
+                                                       &left_shoulder,
+                                                       &right_shoulder,
+                                                       &left_coverage,
+                                                       &right_coverage);
+            }
 
-      /* Remove label if number of nodes is less than
-         the minimum required */
-      if (g_list_length (label->nodes) < priv->min_nr_nodes)
+          if (!can_be_head)
+            head = NULL;
+        }
+
+      /* A head close to the previous one is trusted, otherwise it is
+         as reliable as the shoulders that made it the head */
+      head_confidence = 1;
+      if (head == NULL)
         {
-          nodes = remove_nodes_with_label (nodes,
-                                           priv->node_matrix,
-                                           priv->buffer_width,
-                                           label);
+          get_head_and_shoulders (priv,
+                                  extremas,
+                                  centroid,
+                                  &head,
+                                  &left_shoulder,
+                                  &right_shoulder,
+                                  &left_coverage,
+                                  &right_coverage);
+          head_confidence = (left_coverage + right_coverage) / 2;
+        }
 
-          GList *link = current_label;
-          current_label = g_list_next (current_label);
-          labels = g_list_delete_link (labels, link);
-          free_label (label);
-          continue;
+      if (joints == NULL)
+        joints = skeltrack_joint_list_new ();
+
+      set_joint_from_node (&joints,
+                           head,
+                           SKELTRACK_JOINT_ID_HEAD,
+                           priv->dimension_reduction);
+      if (head != NULL)
+        {
+          head_confidence *= supports[g_list_index (extremas, head)];
+          set_joint_confidence (joints,
+                                SKELTRACK_JOINT_ID_HEAD,
+                                head_confidence);
         }
 
-      current_label = g_list_next (current_label);
-    }
+      if (left_shoulder && head && head->z > left_shoulder->z &&
+          (track_arms || (mask & SKELTRACK_JOINT_MASK_LEFT_SHOULDER)))
+        {
+          Node *adjusted_shoulder;
+          adjusted_shoulder = get_adjusted_shoulder (&priv->projection,
+                                                priv->graph,
+                                                centroid,
+                                                head,
+                                                left_shoulder);
 
-  if (main_component_label)
-    {
-      join_components_to_main (labels,
-                               main_component_label,
-                               priv->distance_threshold,
-                               priv->hands_minimum_distance,
-                               priv->distance_threshold);
+          if (adjusted_shoulder)
+            left_shoulder = adjusted_shoulder;
+        }
 
-      current_label = g_list_first (labels);
-      while (current_label != NULL)
+      set_joint_from_node (&joints,
+                           left_shoulder,
+                           SKELTRACK_JOINT_ID_LEFT_SHOULDER,
+                           priv->dimension_reduction);
+      set_joint_confidence (joints,
+                            SKELTRACK_JOINT_ID_LEFT_SHOULDER,
+                            left_coverage);
+
+      if (right_shoulder && head && head->z > right_shoulder->z &&
+          (track_arms || (mask & SKELTRACK_JOINT_MASK_RIGHT_SHOULDER)))
         {
-          Label *label;
-          label = (Label *) current_label->data;
-          if (label == main_component_label)
-            {
-              current_label = g_list_next (current_label);
-              continue;
-            }
+          Node *adjusted_shoulder;
+          adjusted_shoulder = get_adjusted_shoulder (&priv->projection,
+                                                priv->graph,
+                                                centroid,
+                                                head,
+                                                right_shoulder);
 
-          if (label->bridge_node == NULL)
-            {
-              nodes = remove_nodes_with_label (nodes,
-                                               priv->node_matrix,
-                                               priv->buffer_width,
-                                               label);
+          if (adjusted_shoulder)
+            right_shoulder = adjusted_shoulder;
+        }
+      set_joint_from_node (&joints,
+                           right_shoulder,
+                           SKELTRACK_JOINT_ID_RIGHT_SHOULDER,
+                           priv->dimension_reduction);
+      set_joint_confidence (joints,
+                            SKELTRACK_JOINT_ID_RIGHT_SHOULDER,
+                            right_coverage);
+
+      if (track_arms)
+        {
+          set_left_and_right_from_extremas (priv,
+                                            extremas,
+                                            supports,
+                                            head,
+                                            left_shoulder,
+                                            right_shoulder,
+                                            &joints);
+        }
+
+      set_joint_from_node (&joints,
+                           centroid,
+                           SKELTRACK_JOINT_ID_TORSO,
+                           priv->dimension_reduction);
+
+      if (mask & SKELTRACK_JOINT_MASK_LOWER_BODY)
+        {
+          /* Larger columns are at the left of the user */
+          set_leg_from_distances (priv,
+                                  lowest_distances,
+                                  lowest,
+                                  1,
+                                  SKELTRACK_JOINT_ID_LEFT_HIP,
+                                  SKELTRACK_JOINT_ID_LEFT_KNEE,
+                                  SKELTRACK_JOINT_ID_LEFT_FOOT,
+                                  &joints);
+          set_leg_from_distances (priv,
+                                  lowest_distances,
+                                  lowest,
+                                  -1,
+                                  SKELTRACK_JOINT_ID_RIGHT_HIP,
+                                  SKELTRACK_JOINT_ID_RIGHT_KNEE,
+                                  SKELTRACK_JOINT_ID_RIGHT_FOOT,
+                                  &joints);
+        }
+
+      mask_joints (joints, mask);
+    }
+
+  g_list_free (extremas);
+
+  if (lowest_distances != NULL)
+    g_slice_free1 (matrix_size * sizeof (gint), lowest_distances);
+
+  return joints;
+}
 
-              GList *link = current_label;
-              current_label = g_list_next (current_label);
-              labels = g_list_delete_link (labels, link);
-              free_label (label);
-              continue;
-            }
+static void
+free_region_graph (SkeltrackSkeleton *self)
+{
+  self->priv->main_component = NULL;
 
-          label->bridge_node->neighbors =
-            g_list_prepend (label->bridge_node->neighbors, label->to_node);
-          label->to_node->neighbors = g_list_prepend (label->to_node->neighbors,
-                                                      label->bridge_node);
+  clean_graph (self);
+  g_list_free (self->priv->graph);
+  self->priv->graph = NULL;
 
-          current_label = g_list_next (current_label);
-        }
+  clean_labels (self->priv->labels);
+  g_list_free (self->priv->labels);
+  self->priv->labels = NULL;
+}
 
-      priv->main_component = main_component_label->nodes;
-    }
+static SkeltrackJointList
+track_joints_in_region (SkeltrackSkeleton *self, Region *region)
+{
+  SkeltrackJointList joints;
 
-  *label_list = labels;
+  self->priv->graph = make_graph (self, region, &self->priv->labels);
+  joints = track_joints_in_graph (self->priv);
+  free_region_graph (self);
 
-  return nodes;
+  return joints;
 }
 
-Node *
-get_centroid (SkeltrackSkeleton *self)
+/* Tracks the joints only inside the given region, returning NULL
+   if they are not found or if the user reaches its border */
+static SkeltrackJointList
+track_joints_in_window (SkeltrackSkeleton *self, Region *region)
 {
-  gint avg_x = 0;
-  gint avg_y = 0;
-  gint avg_z = 0;
-  gint length;
-  GList *node_list;
-  Node *cent = NULL;
-  Node *centroid = NULL;
+  SkeltrackJointList joints = NULL;
 
-  if (self->priv->main_component == NULL)
-    return NULL;
+  self->priv->graph = make_graph (self, region, &self->priv->labels);
+  if (graph_inside_region (self, region))
+    joints = track_joints_in_graph (self->priv);
+  free_region_graph (self);
 
-  for (node_list = g_list_first (self->priv->main_component);
-       node_list != NULL;
-       node_list = g_list_next (node_list))
+  if (joints != NULL && joints[SKELTRACK_JOINT_ID_HEAD] == NULL)
     {
-      Node *node;
-      node = (Node *) node_list->data;
-      avg_x += node->x;
-      avg_y += node->y;
-      avg_z += node->z;
+      skeltrack_joint_list_free (joints);
+      joints = NULL;
     }
 
-  length = g_list_length (self->priv->main_component);
-  cent = g_slice_new0 (Node);
-  cent->x = avg_x / length;
-  cent->y = avg_y / length;
-  cent->z = avg_z / length;
-  cent->linked_nodes = NULL;
-
-  centroid = get_closest_node (self->priv->graph, cent);
-
-  g_slice_free (Node, cent);
+  return joints;
+}
 
-  return centroid;
+/* The signature of a buffer is a copy of its points, so a change of
+   even a small part of the scene is not missed */
+static guint
+get_frame_signature_size (guint width, guint height)
+{
+  return width * height;
 }
 
-static Node *
-get_lowest (SkeltrackSkeleton *self, Node *centroid)
+/* The scene is static when no more than STATIC_SCENE_MAXIMUM_CHANGES
+   points moved further than the tolerance, as a mean over the points
+   would hide a change in a small part of the scene */
+static gboolean
+is_static_scene (SkeltrackSkeleton *self)
 {
-  Node *lowest = NULL;
-  /* @TODO: Use the node_matrix instead of the lowest
-     component to look for the lowest node as it's faster. */
-  if (self->priv->main_component != NULL)
+  SkeltrackSkeletonPrivate *priv;
+  guint i, j, index = 0, changes = 0;
+
+  priv = self->priv;
+
+  if (priv->frame_signature == NULL ||
+      priv->frame_signature_width != priv->buffer_width ||
+      priv->frame_signature_height != priv->buffer_height)
     {
-      GList *node_list;
-      for (node_list = g_list_first (self->priv->main_component);
-           node_list != NULL;
-           node_list = g_list_next (node_list))
+      return FALSE;
+    }
+
+  for (j = 0; j < priv->buffer_height; j++)
+    {
+      for (i = 0; i < priv->buffer_width; i++)
         {
-          Node *node;
-          node = (Node *) node_list->data;
-          if (node->i != centroid->i)
-            continue;
-          if (lowest == NULL ||
-              lowest->j < node->j)
+          guint16 value = get_depth_value (&priv->buffer, i, j);
+          if (ABS (value - priv->frame_signature[index]) >
+              priv->static_scene_tolerance)
             {
-              lowest = node;
+              changes++;
+              if (changes > STATIC_SCENE_MAXIMUM_CHANGES)
+                return FALSE;
             }
+          index++;
         }
     }
-  return lowest;
+
+  return TRUE;
 }
 
-static Node *
-get_longer_distance (SkeltrackSkeleton *self, gint *distances)
+static void
+update_frame_signature (SkeltrackSkeleton *self)
 {
-  GList *current;
-  Node *farthest_node;
+  SkeltrackSkeletonPrivate *priv;
+  guint i, j, index = 0;
 
-  current = g_list_first (self->priv->graph);
-  farthest_node = (Node *) current->data;
-  current = g_list_next (current);
+  priv = self->priv;
 
-  while (current != NULL)
+  if (priv->frame_signature_width != priv->buffer_width ||
+      priv->frame_signature_height != priv->buffer_height)
     {
-      Node *node;
-      node = (Node *) current->data;
-      if (node != NULL &&
-          (distances[farthest_node->j *
-                     self->priv->buffer_width +
-                     farthest_node->i] != -1 &&
-           distances[farthest_node->j *
-                     self->priv->buffer_width +
-                     farthest_node->i] < distances[node->j *
-                                                   self->priv->buffer_width +
-                                                   node->i]))
+      g_slice_free1 (get_frame_signature_size (priv->frame_signature_width,
+                                               priv->frame_signature_height) *
+                     sizeof (guint16),
+                     priv->frame_signature);
+      priv->frame_signature = NULL;
+    }
+
+  if (priv->frame_signature == NULL)
+    {
+      priv->frame_signature_width = priv->buffer_width;
+      priv->frame_signature_height = priv->buffer_height;
+      priv->frame_signature =
+        g_slice_alloc (get_frame_signature_size (priv->buffer_width,
+                                                 priv->buffer_height) *
+                       sizeof (guint16));
+    }
+
+  for (j = 0; j < priv->buffer_height; j++)
+    {
+      for (i = 0; i < priv->buffer_width; i++)
         {
-          farthest_node = node;
+          priv->frame_signature[index] = get_depth_value (&priv->buffer, i, j);
+          index++;
         }
-      current = g_list_next (current);
     }
-  return farthest_node;
 }
 
 static void
-set_average_extremas (SkeltrackSkeletonPrivate *priv, GList *extremas)
+clean_filtered_buffers (SkeltrackSkeleton *self)
 {
-  GList *current_extrema, *averaged_extremas = NULL;
+  SkeltrackSkeletonPrivate *priv = self->priv;
+  gsize size;
+  guint i;
 
-  for (current_extrema = g_list_first (extremas);
-       current_extrema != NULL;
-       current_extrema = g_list_next (current_extrema))
+  size = priv->filtered_width * priv->filtered_height * sizeof (guint16);
+  for (i = 0; i < G_N_ELEMENTS (priv->filtered_buffers); i++)
     {
-      GList *current_node;
-      Node *extrema, *node = NULL, *cent = NULL, *node_centroid = NULL;
-      gint avg_x = 0, avg_y = 0, avg_z = 0, length = 0;
+      g_slice_free1 (size, priv->filtered_buffers[i]);
+      priv->filtered_buffers[i] = NULL;
+    }
 
-      extrema = (Node *) current_extrema->data;
+  priv->filtered_width = 0;
+  priv->filtered_height = 0;
+}
 
-      for (current_node = g_list_first (priv->graph);
-           current_node != NULL;
-           current_node = g_list_next (current_node))
-        {
-          node = (Node *) current_node->data;
+/* Runs the enabled filters on the buffer, which is replaced by the
+   filtered one, before any graph is built from it. The depth gating
+   is only run if gate_depth is TRUE. */
+static void
+filter_buffer (SkeltrackSkeleton *self, gboolean gate_depth)
+{
+  SkeltrackSkeletonPrivate *priv = self->priv;
+  guint width, height, i, next = 0;
 
-          if ((get_distance (extrema, node) <
-               priv->extrema_sphere_radius))
-            {
-              avg_x += node->x;
-              avg_y += node->y;
-              avg_z += node->z;
+  /* The gating only sets the range of depth the buffer is read in,
+     so it is applied while the next stages read it */
+  if (gate_depth && priv->enable_depth_gating)
+    {
+      guint16 reference_depth;
 
-              length++;
-            }
-        }
+      if (priv->user->previous_head != NULL)
+        reference_depth = priv->user->previous_head->z;
+      else
+        reference_depth = priv->focus_node->z;
 
-      /* if the length is 1 then it is because no other
-         nodes were considered for the average */
-      if (length > 1)
-        {
-          cent = g_slice_new0 (Node);
-          cent->x = avg_x / length;
-          cent->y = avg_y / length;
-          cent->z = avg_z / length;
-          cent->linked_nodes = NULL;
+      gate_depth_range (&priv->buffer,
+                        priv->buffer_width,
+                        priv->buffer_height,
+                        reference_depth,
+                        priv->depth_gating_max_band);
+    }
 
-          node_centroid = get_closest_node (priv->graph, cent);
+  if (! priv->enable_median_filter && ! priv->enable_hole_filling)
+    return;
 
-          /* If the new averaged extrema is not already an extrema
-             set it for addition */
-          if (g_list_find (averaged_extremas, node_centroid) == NULL &&
-              g_list_find (extremas, node_centroid) == NULL)
-            {
-              current_extrema->data = node_centroid;
-            }
+  width = priv->buffer_width;
+  height = priv->buffer_height;
 
-          g_slice_free (Node, cent);
+  if (priv->filtered_width != width || priv->filtered_height != height)
+    {
+      clean_filtered_buffers (self);
+
+      for (i = 0; i < G_N_ELEMENTS (priv->filtered_buffers); i++)
+        {
+          priv->filtered_buffers[i] = g_slice_alloc (width * height *
+                                                     sizeof (guint16));
         }
+      priv->filtered_width = width;
+      priv->filtered_height = height;
+    }
+
+  /* Each filter reads the output of the previous one */
+  if (priv->enable_median_filter)
+    {
+      filter_depth_median (&priv->buffer,
+                           width,
+                           height,
+                           priv->filtered_buffers[next]);
+      init_depth_buffer (&priv->buffer, priv->filtered_buffers[next], width);
+      next = 1 - next;
+    }
+
+  if (priv->enable_hole_filling)
+    {
+      fill_depth_holes (&priv->buffer,
+                        width,
+                        height,
+                        priv->hole_filling_min_neighbors,
+                        priv->filtered_buffers[next]);
+      init_depth_buffer (&priv->buffer, priv->filtered_buffers[next], width);
     }
 }
 
-static GList *
-get_extremas (SkeltrackSkeleton *self, Node *centroid)
+/* Runs the enabled stages that prepare the buffer before any graph
+   is built from it */
+static void
+prepare_buffer (SkeltrackSkeleton *self, gboolean gate_depth)
 {
-  SkeltrackSkeletonPrivate *priv;
-  gint i, nr_nodes, matrix_size;
-  Node *lowest, *source, *node;
-  GList *extremas = NULL;
+  if (self->priv->enable_background_subtraction)
+    {
+      subtract_background (&self->priv->background_model,
+                           &self->priv->buffer,
+                           self->priv->buffer_width,
+                           self->priv->buffer_height,
+                           self->priv->background_tolerance,
+                           self->priv->background_learning_frames,
+                           self->priv->background_absorption_frames);
+      init_depth_buffer (&self->priv->buffer,
+                         self->priv->background_model.foreground,
+                         self->priv->buffer_width);
+    }
 
-  priv = self->priv;
-  lowest = get_lowest (self, centroid);
-  source = lowest;
+  if (self->priv->enable_plane_removal)
+    {
+      remove_planes (&self->priv->plane_model,
+                     &self->priv->buffer,
+                     &self->priv->projection,
+                     self->priv->plane_removal_max_planes,
+                     self->priv->plane_removal_tolerance);
+      init_depth_buffer (&self->priv->buffer,
+                         self->priv->plane_model.output,
+                         self->priv->buffer_width);
+    }
 
-  matrix_size = priv->buffer_width * priv->buffer_height;
-  if (priv->distances_matrix == NULL)
+  filter_buffer (self, gate_depth);
+}
+
+/* Whether the point is next to a point of the coarser mask, which is
+   read mask_ratio times fewer points apart: the points left out of the
+   mask by the stages that prepare it are left out of the finer level */
+static gboolean
+is_point_in_mask (SkeltrackSkeletonPrivate *priv,
+                  const DepthBuffer *mask,
+                  guint mask_ratio,
+                  gint i,
+                  gint j)
+{
+  guint mask_i, mask_j, k;
+
+  mask_i = i / mask_ratio;
+  mask_j = j / mask_ratio;
+
+  for (k = 0; k < 4; k++)
     {
-      priv->distances_matrix = g_slice_alloc0 (matrix_size * sizeof (gint));
+      guint neighbor_i = mask_i + k % 2;
+      guint neighbor_j = mask_j + k / 2;
+
+      if (neighbor_i < priv->buffer_width &&
+          neighbor_j < priv->buffer_height &&
+          get_depth_value (mask, neighbor_i, neighbor_j) != 0)
+        return TRUE;
     }
 
-  for (i = 0; i < matrix_size; i++)
+  return FALSE;
+}
+
+/* Builds a graph of the points of the buffer inside the window that
+   are in the sphere of the given radius (in mm) around the joint, so
+   it does not reach the body or the background. Nodes are indexed
+   inside the window in node_matrix. If a mask is given, only the
+   points in it are used. */
+static GList *
+make_window_graph (SkeltrackSkeletonPrivate *priv,
+                   const DepthBuffer *buffer,
+                   const Projection *projection,
+                   const Region *window,
+                   SkeltrackJoint *joint,
+                   guint radius,
+                   const DepthBuffer *mask,
+                   guint mask_ratio,
+                   Node **node_matrix)
+{
+  GList *nodes = NULL;
+  guint max_distance;
+  gint i, j;
+
+  /* The largest squared distance whose root, rounded down, is still
+     inside the sphere */
+  max_distance = radius * radius + 2 * radius;
+
+  for (i = 0; i < window->width; i++)
     {
-      priv->distances_matrix[i] = -1;
+      for (j = 0; j < window->height; j++)
+        {
+          Node *node;
+          gint k;
+          gint neighbors[4][2] = {{-1, 0}, {-1, 1}, {0, -1}, {-1, -1}};
+          guint16 value;
+
+          value = get_depth_value (buffer, window->x + i, window->y + j);
+          if (value == 0)
+            continue;
+
+          if (mask != NULL &&
+              !is_point_in_mask (priv,
+                                 mask,
+                                 mask_ratio,
+                                 window->x + i,
+                                 window->y + j))
+            continue;
+
+          node = g_slice_new0 (Node);
+          node->i = i;
+          node->j = j;
+          node->z = value;
+          convert_screen_coords_to_mm (projection,
+                                       window->x + i,
+                                       window->y + j,
+                                       node->z,
+                                       &(node->x),
+                                       &(node->y));
+
+          if (get_squared_distance_from_joint (node, joint) > max_distance)
+            {
+              g_slice_free (Node, node);
+              continue;
+            }
+
+          for (k = 0; k < 4; k++)
+            {
+              Node *neighbor;
+              guint squared_distance;
+              gint neighbor_i = i + neighbors[k][0];
+              gint neighbor_j = j + neighbors[k][1];
+
+              if (neighbor_i < 0 || neighbor_j < 0 ||
+                  neighbor_j >= window->height)
+                continue;
+
+              neighbor = node_matrix[neighbor_j * window->width + neighbor_i];
+              if (neighbor == NULL)
+                continue;
+
+              squared_distance = get_squared_distance (neighbor, node);
+              if (squared_distance <
+                  (guint) priv->distance_threshold * priv->distance_threshold)
+                {
+                  neighbor->neighbors = g_list_prepend (neighbor->neighbors,
+                                                        node);
+                  node->neighbors = g_list_prepend (node->neighbors,
+                                                    neighbor);
+                  set_edge_weight (node,
+                                   neighbor,
+                                   get_integer_sqrt (squared_distance));
+                }
+            }
+
+          node_matrix[j * window->width + i] = node;
+          nodes = g_list_prepend (nodes, node);
+        }
     }
 
-  for (nr_nodes = NR_EXTREMAS_TO_SEARCH;
-       source != NULL && nr_nodes > 0;
-       nr_nodes--)
+  return nodes;
+}
+
+/* Moves the joint to the points of the finer level around it that are
+   connected to it: to the one farthest from the reference joint, for
+   the joints at the end of a limb, or to their center otherwise */
+static void
+refine_joint_in_level (SkeltrackSkeletonPrivate *priv,
+                       SkeltrackJoint    *joint,
+                       SkeltrackJoint    *reference,
+                       const DepthBuffer *buffer,
+                       const Projection  *projection,
+                       gint               radius,
+                       const DepthBuffer *mask,
+                       guint              mask_ratio)
+{
+  Region window;
+  Node **node_matrix;
+  Node *source, *refined = NULL;
+  GList *nodes, *current;
+  gint *distances;
+  gint64 sum_x = 0, sum_y = 0, sum_z = 0, sum_i = 0, sum_j = 0;
+  guint count = 0, farthest_distance = 0;
+  gint center_i, center_j, distance;
+
+  center_i = joint->screen_x / projection->dimension_reduction;
+  center_j = joint->screen_y / projection->dimension_reduction;
+  window.x = MAX (center_i - radius, 0);
+  window.y = MAX (center_j - radius, 0);
+  window.width = MIN (center_i + radius + 1, (gint) projection->width) -
+    window.x;
+  window.height = MIN (center_j + radius + 1, (gint) projection->height) -
+    window.y;
+  if (window.width <= 0 || window.height <= 0)
+    return;
+
+  node_matrix = g_slice_alloc0 (window.width * window.height *
+                                sizeof (Node *));
+  nodes = make_window_graph (priv,
+                             buffer,
+                             projection,
+                             &window,
+                             joint,
+                             PYRAMID_REFINEMENT_RADIUS,
+                             mask,
+                             mask_ratio,
+                             node_matrix);
+
+  /* Only the points reachable from the joint are on its surface */
+  source = get_closest_node_to_joint (nodes, joint, &distance);
+  distances = create_new_dist_matrix (window.width * window.height);
+  if (source != NULL)
     {
-      dijkstra_to (priv->graph,
+      dijkstra_to (nodes,
                    source,
                    NULL,
-                   priv->buffer_width,
-                   priv->buffer_height,
-                   priv->distances_matrix,
+                   window.width,
+                   window.height,
+                   distances,
                    NULL);
+    }
 
-      node = get_longer_distance (self, priv->distances_matrix);
+  for (current = g_list_first (nodes);
+       current != NULL;
+       current = g_list_next (current))
+    {
+      Node *node = (Node *) current->data;
 
-      if (node == NULL)
+      if (distances[node->j * window.width + node->i] == -1)
         continue;
 
-      if (node != source)
+      sum_x += node->x;
+      sum_y += node->y;
+      sum_z += node->z;
+      sum_i += window.x + node->i;
+      sum_j += window.y + node->j;
+      count++;
+
+      if (reference != NULL &&
+          get_squared_distance_from_joint (node,
+                                           reference) >= farthest_distance)
         {
-          priv->distances_matrix[node->j * priv->buffer_width + node->i] = 0;
-          source->linked_nodes = g_list_prepend (source->linked_nodes, node);
-          node->linked_nodes = g_list_prepend (node->linked_nodes, source);
-          source = node;
-          extremas = g_list_prepend (extremas, node);
+          farthest_distance = get_squared_distance_from_joint (node,
+                                                               reference);
+          refined = node;
         }
     }
 
-  if (self->priv->extrema_sphere_radius != 0)
+  if (refined != NULL)
+    {
+      joint->x = refined->x;
+      joint->y = refined->y;
+      joint->z = refined->z;
+      joint->screen_x = (window.x + refined->i) *
+        projection->dimension_reduction;
+      joint->screen_y = (window.y + refined->j) *
+        projection->dimension_reduction;
+    }
+  else if (reference == NULL && count > 0)
+    {
+      joint->x = sum_x / count;
+      joint->y = sum_y / count;
+      joint->z = sum_z / count;
+      joint->screen_x = sum_i * projection->dimension_reduction / count;
+      joint->screen_y = sum_j * projection->dimension_reduction / count;
+    }
+
+  g_slice_free1 (window.width * window.height * sizeof (gint), distances);
+  g_slice_free1 (window.width * window.height * sizeof (Node *),
+                 node_matrix);
+  clean_nodes (nodes);
+  g_list_free (nodes);
+}
+
+/* Refines the joints tracked in the buffer, which is the coarse level,
+   by reading the full resolution buffer it was reduced from at a finer
+   level only in small windows around each joint. The buffer prepared
+   by the enabled stages is the mask of the finer level. */
+static void
+refine_joints (SkeltrackSkeleton *self,
+               SkeltrackJointList joints,
+               const DepthBuffer *input)
+{
+  SkeltrackSkeletonPrivate *priv;
+  DepthBuffer buffer;
+  guint i, step;
+
+  priv = self->priv;
+
+  /* A buffer that was already reduced has no finer level */
+  if (input->step <= 1)
+    return;
+
+  step = MAX (input->step / priv->pyramid_factor, 1);
+  buffer = *input;
+  buffer.step = step;
+  update_projection (&priv->fine_projection,
+                     priv->camera_intrinsics,
+                     priv->buffer_width * input->step / step,
+                     priv->buffer_height * input->step / step,
+                     step);
+
+  for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+    {
+      SkeltrackJoint *reference = NULL;
+
+      if (joints[i] == NULL)
+        continue;
+
+      if (i == SKELTRACK_JOINT_ID_LEFT_HAND)
+        reference = joints[SKELTRACK_JOINT_ID_LEFT_ELBOW];
+      else if (i == SKELTRACK_JOINT_ID_RIGHT_HAND)
+        reference = joints[SKELTRACK_JOINT_ID_RIGHT_ELBOW];
+      else if (i == SKELTRACK_JOINT_ID_LEFT_FOOT)
+        reference = joints[SKELTRACK_JOINT_ID_LEFT_KNEE];
+      else if (i == SKELTRACK_JOINT_ID_RIGHT_FOOT)
+        reference = joints[SKELTRACK_JOINT_ID_RIGHT_KNEE];
+
+      refine_joint_in_level (priv,
+                             joints[i],
+                             reference,
+                             &buffer,
+                             &priv->fine_projection,
+                             input->step / step,
+                             &priv->buffer,
+                             input->step / step);
+    }
+}
+
+/* Tracks the joints in the buffer, after running the enabled stages
+   that prepare it and trying the smaller windows first */
+static SkeltrackJointList
+track_joints_in_buffer (SkeltrackSkeleton *self)
+{
+  Region region;
+  DepthBuffer input;
+  SkeltrackJointList joints = NULL;
+
+  /* The stages may replace the buffer with a reduced copy */
+  input = self->priv->buffer;
+  prepare_buffer (self, TRUE);
+
+  if (self->priv->enable_region_of_interest &&
+      get_region_of_interest (self, &region))
+    {
+      joints = track_joints_in_window (self, &region);
+    }
+
+  if (joints == NULL)
     {
-      set_average_extremas (priv, extremas);
+      region.x = 0;
+      region.y = 0;
+      region.width = self->priv->buffer_width;
+      region.height = self->priv->buffer_height;
+      joints = track_joints_in_region (self, &region);
     }
 
-  return extremas;
+  if (joints != NULL && self->priv->enable_pyramid)
+    refine_joints (self, joints, &input);
+
+  return joints;
 }
 
-static Node *
-get_shoulder_node (SkeltrackSkeletonPrivate *priv,
-                   gfloat alpha,
-                   gfloat step,
-                   gint x_node,
-                   gint y_node,
-                   gint z_centroid)
+/* The smoothed joints moved along their trend by the given number of
+   frames */
+static SkeltrackJointList
+get_extrapolated_joints (SmoothData *smooth_data, gint frames)
 {
-  guint radius, arc_start_point, arc_length, current_i, current_j;
-  gfloat start_angle, last_node_arc, current_arc, angle, current_x, current_y;
-  Node *current_node = NULL;
-  Node *last_node = NULL;
+  SkeltrackJointList smoothed = NULL;
 
-  radius = priv->shoulders_circumference_radius;
-  arc_start_point = priv->shoulders_arc_start_point;
-  arc_length = priv->shoulders_arc_length;
+  if (smooth_data->smoothed_joints != NULL)
+    {
+      guint i;
+      smoothed = skeltrack_joint_list_new ();
+      for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+        {
+          SkeltrackJoint *smoothed_joint, *smooth, *trend;
+          smoothed_joint = NULL;
+          smooth = smooth_data->smoothed_joints[i];
+          if (smooth != NULL)
+            {
+              if (smooth_data->trend_joints != NULL)
+                {
+                  trend = smooth_data->trend_joints[i];
+                  if (trend != NULL)
+                    {
+                      smoothed_joint = g_slice_new0 (SkeltrackJoint);
+                      smoothed_joint->x = smooth->x + frames * trend->x;
+                      smoothed_joint->y = smooth->y + frames * trend->y;
+                      smoothed_joint->z = smooth->z + frames * trend->z;
+                      smoothed_joint->screen_x = smooth->screen_x + frames * trend->screen_x;
+                      smoothed_joint->screen_y = smooth->screen_y + frames * trend->screen_y;
+                    }
+                  else
+                    smoothed_joint = skeltrack_joint_copy (smooth);
+                }
+              else
+                smoothed_joint = skeltrack_joint_copy (smooth);
+
+              /* A joint not found in this frame loses confidence
+                 while it persists */
+              smoothed_joint->confidence = smooth->confidence;
+              if (smooth_data->joints_persistency_counter[i] <
+                  smooth_data->joints_persistency)
+                {
+                  smoothed_joint->confidence *=
+                    smooth_data->joints_persistency_counter[i] /
+                    (gfloat) smooth_data->joints_persistency;
+                }
+            }
+          smoothed[i] = smoothed_joint;
+        }
+    }
 
-  start_angle = M_PI_2;
+  return smoothed;
+}
 
-  angle = start_angle + alpha;
-  current_x = x_node + radius * cos (angle);
-  current_y = y_node + radius * sin (angle);
-  current_arc = 0;
-  last_node_arc = 0;
-  current_node = NULL;
-  last_node = NULL;
+/* Smooths the joints found with the ones of the previous frames,
+   which are freed, and returns the smoothed ones */
+static SkeltrackJointList
+get_smoothed_joints (SmoothData *smooth_data, SkeltrackJointList joints)
+{
+  smooth_joints (smooth_data, joints);
+  skeltrack_joint_list_free (joints);
 
-  while (current_arc <= (arc_start_point + arc_length))
-    {
-      convert_mm_to_screen_coords (priv->buffer_width,
-                                   priv->buffer_height,
-                                   priv->dimension_reduction,
-                                   current_x,
-                                   current_y,
-                                   z_centroid,
-                                   &current_i,
-                                   &current_j);
+  return get_extrapolated_joints (smooth_data, 1);
+}
 
-      if (current_i >= priv->buffer_width || current_j >= priv->buffer_height)
-        break;
+/* Whether there are points around the joint, in the buffer, close to
+   its depth */
+static gboolean
+is_joint_in_buffer (SkeltrackSkeletonPrivate *priv, SkeltrackJoint *joint)
+{
+  gint i, j, x, y;
 
-      current_node = priv->node_matrix[current_j * priv->buffer_width +
-                                       current_i];
+  i = joint->screen_x / (gint) priv->dimension_reduction;
+  j = joint->screen_y / (gint) priv->dimension_reduction;
 
-      if (current_node != NULL)
+  for (y = j - PREDICTION_CHECK_RADIUS; y <= j + PREDICTION_CHECK_RADIUS; y++)
+    {
+      for (x = i - PREDICTION_CHECK_RADIUS;
+           x <= i + PREDICTION_CHECK_RADIUS;
+           x++)
         {
-          last_node = current_node;
-          last_node_arc = current_arc;
-        }
+          guint16 value;
 
-      angle += step;
-      current_x = x_node + radius * cos (angle);
-      current_y = y_node + radius * sin (angle);
-      current_arc = ABS (angle - start_angle) * radius;
-    }
+          if (x < 0 || y < 0 ||
+              x >= (gint) priv->buffer_width ||
+              y >= (gint) priv->buffer_height)
+            continue;
 
-  if (last_node_arc < arc_start_point)
-    return NULL;
+          value = get_depth_value (&priv->buffer, x, y);
+          if (value != 0 &&
+              ABS (value - joint->z) <= priv->prediction_tolerance)
+            return TRUE;
+        }
+    }
 
-  return last_node;
+  return FALSE;
 }
 
-static gboolean
-check_if_node_can_be_head (SkeltrackSkeleton *self,
-                           Node *node,
-                           Node *centroid,
-                           Node **left_shoulder,
-                           Node **right_shoulder)
+/* Predicts the joints of this frame from the trend of the smoothed
+   ones, or returns NULL if the joints have to be tracked because it
+   is time to, or because the prediction cannot be trusted */
+static SkeltrackJointList
+get_predicted_joints (SkeltrackSkeleton *self)
 {
-  gfloat alpha;
-  Node *found_right_shoulder = NULL, *found_left_shoulder = NULL;
-
   SkeltrackSkeletonPrivate *priv;
-
-  *left_shoulder = NULL;
-  *right_shoulder = NULL;
+  SkeltrackJointList joints;
+  guint i, nr_joints = 0;
 
   priv = self->priv;
 
-  if (node->j > centroid->j)
-    return FALSE;
-
-  if ((node->y - centroid->y) != 0)
-    alpha = atan( ABS (node->x - centroid->x) / ABS (node->y - centroid->y));
-  else
-    return FALSE;
+  if (! priv->enable_smoothing ||
+      priv->user->smooth_data.trend_joints == NULL ||
+      priv->frames_since_tracking + 1 >= priv->prediction_interval)
+    return NULL;
 
-  /* too much tilt, cannot be the head */
-  if (alpha >= M_PI_4)
-    return FALSE;
+  /* The last joints returned were already one frame ahead */
+  joints = get_extrapolated_joints (&priv->user->smooth_data, 2);
+  if (joints == NULL)
+    return NULL;
 
-  if (node->x < centroid->x)
-    alpha = -alpha;
+  for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+    {
+      if (joints[i] == NULL)
+        continue;
 
-  found_right_shoulder = get_shoulder_node (priv,
-                                            alpha,
-                                            priv->shoulders_search_step,
-                                            node->x,
-                                            node->y,
-                                            centroid->z);
-  if (found_right_shoulder == NULL)
-    return FALSE;
+      if (joints[i]->confidence < PREDICTION_MINIMUM_CONFIDENCE ||
+          (priv->prediction_tolerance > 0 &&
+           ! is_joint_in_buffer (priv, joints[i])))
+        {
+          skeltrack_joint_list_free (joints);
+          return NULL;
+        }
 
-  found_left_shoulder = get_shoulder_node (priv,
-                                           alpha,
-                                           -priv->shoulders_search_step,
-                                           node->x,
-                                           node->y,
-                                           centroid->z);
+      nr_joints++;
+    }
 
-  if (found_left_shoulder == NULL)
-    return FALSE;
+  if (nr_joints == 0)
+    {
+      skeltrack_joint_list_free (joints);
+      return NULL;
+    }
 
-  *right_shoulder = found_right_shoulder;
-  *left_shoulder = found_left_shoulder;
+  extrapolate_joints (&priv->user->smooth_data);
 
-  return TRUE;
+  return joints;
 }
 
-static gboolean
-get_head_and_shoulders (SkeltrackSkeleton *self,
-                        GList  *extremas,
-                        Node   *centroid,
-                        Node  **head,
-                        Node  **left_shoulder,
-                        Node  **right_shoulder)
+static void
+update_previous_joints (SkeltrackSkeleton *self, SkeltrackJointList joints)
 {
-  Node *node;
-  GList *current_extrema;
-
-  for (current_extrema = g_list_first (extremas);
-       current_extrema != NULL;
-       current_extrema = g_list_next (current_extrema))
+  if (joints)
     {
-      node = (Node *) current_extrema->data;
-
-      if (check_if_node_can_be_head (self,
-                                     node,
-                                     centroid,
-                                     left_shoulder,
-                                     right_shoulder))
+      SkeltrackJoint *joint = skeltrack_joint_list_get_joint (joints,
+                                                   SKELTRACK_JOINT_ID_HEAD);
+      if (joint != NULL)
         {
-          *head = node;
-          return TRUE;
+          skeltrack_joint_free (self->priv->user->previous_head);
+          self->priv->user->previous_head = skeltrack_joint_copy (joint);
         }
     }
-  return FALSE;
+
+  skeltrack_joint_list_free (self->priv->previous_joints);
+  self->priv->previous_joints = copy_joint_list (joints);
 }
 
+/* Applies the properties set while a buffer could be tracked in
+   another thread, which free what the tracking uses, before tracking
+   the next one */
 static void
-identify_arm_extrema (gint *distances,
-                      Node **previous_nodes,
-                      gint width,
-                      gint hand_distance,
-                      Node *extrema,
-                      Node **elbow_extrema,
-                      Node **hand_extrema)
+apply_property_changes (SkeltrackSkeletonPrivate *priv)
 {
-  gint total_dist;
+  g_mutex_lock (&priv->track_joints_mutex);
 
-  if (extrema == NULL)
-    return;
+  if (priv->camera_intrinsics_changed)
+    {
+      skeltrack_camera_intrinsics_free (priv->camera_intrinsics);
+      priv->camera_intrinsics = priv->new_camera_intrinsics;
+      priv->new_camera_intrinsics = NULL;
+      priv->camera_intrinsics_changed = FALSE;
+
+      /* The projection and the nodes kept in the grid depend on it */
+      clean_projection (&priv->projection);
+      clean_projection (&priv->fine_projection);
+      clean_node_grid (&priv->node_grid);
+    }
 
-  total_dist = distances[width * extrema->j + extrema->i];
-  if (total_dist < hand_distance)
+  if (priv->background_model_changed)
     {
-      *elbow_extrema = extrema;
-      *hand_extrema = NULL;
+      clean_background_model (&priv->background_model);
+      priv->background_model_changed = FALSE;
     }
-  else
+
+  g_mutex_unlock (&priv->track_joints_mutex);
+}
+
+static SkeltrackJointList
+track_joints (SkeltrackSkeleton *self)
+{
+  Region region;
+  SkeltrackJointList joints = NULL;
+
+  apply_property_changes (self->priv);
+
+  /* The frame signature is only taken from buffers */
+  if (self->priv->points == NULL &&
+      self->priv->enable_static_scene_detection)
     {
-      Node *previous;
-      gint elbow_dist;
+      if (is_static_scene (self))
+        {
+          self->priv->buffer.data = NULL;
+          self->priv->skipped_frames++;
+          return copy_joint_list (self->priv->previous_joints);
+        }
 
-      previous = previous_nodes[extrema->j * width + extrema->i];
-      elbow_dist = total_dist / 2;
-      while (previous &&
-             distances[previous->j * width + previous->i] > elbow_dist)
+      update_frame_signature (self);
+    }
+
+  /* Points are always tracked since there is no buffer to check the
+     prediction against */
+  if (self->priv->points == NULL && self->priv->enable_prediction)
+    {
+      joints = get_predicted_joints (self);
+      if (joints != NULL)
         {
-          previous = previous_nodes[previous->j * width + previous->i];
+          self->priv->buffer.data = NULL;
+          self->priv->frames_since_tracking++;
+          self->priv->predicted_frames++;
+          update_previous_joints (self, joints);
+          return joints;
         }
-      *elbow_extrema = previous;
-      *hand_extrema = extrema;
     }
+  self->priv->frames_since_tracking = 0;
+
+  update_projection (&self->priv->projection,
+                     self->priv->camera_intrinsics,
+                     self->priv->buffer_width,
+                     self->priv->buffer_height,
+                     self->priv->dimension_reduction);
+
+  if (self->priv->points != NULL)
+    {
+      region.x = 0;
+      region.y = 0;
+      region.width = self->priv->buffer_width;
+      region.height = self->priv->buffer_height;
+      joints = track_joints_in_region (self, &region);
+    }
+  else
+    {
+      joints = track_joints_in_buffer (self);
+    }
+
+  self->priv->buffer.data = NULL;
+  self->priv->points = NULL;
+
+  if (self->priv->enable_smoothing)
+    joints = get_smoothed_joints (&self->priv->user->smooth_data, joints);
+
+  update_previous_joints (self, joints);
+
+  return joints;
 }
 
 static void
-set_left_and_right_from_extremas (SkeltrackSkeleton *self,
-                                  GList *extremas,
-                                  Node *head,
-                                  Node *left_shoulder,
-                                  Node *right_shoulder,
-                                  SkeltrackJointList *joints)
+clean_tracked_user (TrackedUser *user)
 {
-  gint *dist_left_a = NULL;
-  gint *dist_left_b = NULL;
-  gint *dist_right_a = NULL;
-  gint *dist_right_b = NULL;
-  gint total_dist_left_a = -1;
-  gint total_dist_right_a = -1;
-  gint total_dist_left_b = -1;
-  gint total_dist_right_b = -1;
-  gint *distances_left[2] = {NULL, NULL};
-  gint *distances_right[2] = {NULL, NULL};
-  gint index_left = -1;
-  gint index_right = -1;
-  Node *elbow_extrema, *hand_extrema;
-  Node **previous_left_a = NULL;
-  Node **previous_left_b = NULL;
-  Node **previous_right_a = NULL;
-  Node **previous_right_b = NULL;
-  Node **previous_left[2] = {NULL, NULL};
-  Node **previous_right[2] = {NULL, NULL};
-  Node *ext_a = NULL;
-  Node *ext_b = NULL;
-  Node *left_extrema[2] = {NULL, NULL};
-  Node *right_extrema[2] = {NULL, NULL};
-  GList *current_extrema;
-  gint width, height, matrix_size;
+  skeltrack_joint_free (user->previous_head);
+  skeltrack_joint_list_free (user->smooth_data.smoothed_joints);
+  skeltrack_joint_list_free (user->smooth_data.trend_joints);
+  memset (user, 0, sizeof (TrackedUser));
+}
 
-  for (current_extrema = g_list_first (extremas);
-       current_extrema != NULL;
-       current_extrema = g_list_next (current_extrema))
-    {
-      Node *node;
-      node = (Node *) current_extrema->data;
-      if (node != head)
-        {
-          if (ext_a == NULL)
-            ext_a = node;
-          else
-            ext_b = node;
-        }
-    }
+static void
+clean_tracked_users (SkeltrackSkeleton *self)
+{
+  guint i;
 
-  if (head == NULL)
-    return;
+  for (i = 0; i < self->priv->nr_users; i++)
+    clean_tracked_user (&self->priv->users[i]);
 
-  width = self->priv->buffer_width;
-  height = self->priv->buffer_height;
-  matrix_size = width * height;
+  g_slice_free1 (self->priv->nr_users * sizeof (TrackedUser),
+                 self->priv->users);
+  self->priv->users = NULL;
+  self->priv->nr_users = 0;
+}
 
-  previous_left_a = g_slice_alloc0 (matrix_size * sizeof (Node *));
-  previous_left_b = g_slice_alloc0 (matrix_size * sizeof (Node *));
-  previous_right_a = g_slice_alloc0 (matrix_size * sizeof (Node *));
-  previous_right_b = g_slice_alloc0 (matrix_size * sizeof (Node *));
+/* Makes the graph of the whole buffer with up to max_users main
+   components, the closest ones to the focus node, which are given in
+   user_list. Every other component is joined to the one it has the
+   shortest bridge to, or removed. */
+static GList *
+make_users_graph (SkeltrackSkeleton *self,
+                  GList **label_list,
+                  GList **user_list)
+{
+  SkeltrackSkeletonPrivate *priv;
+  GList *nodes = NULL;
+  GList *labels = NULL;
+  GList *users, *unjoined_labels;
+  GList *current_user, *current_label;
+  Region region;
 
-  dist_left_a = create_new_dist_matrix(matrix_size);
-  dijkstra_to (self->priv->graph,
-               left_shoulder,
-               ext_a,
-               width,
-               height,
-               dist_left_a,
-               previous_left_a);
+  priv = self->priv;
 
-  dist_left_b = create_new_dist_matrix(matrix_size);
-  dijkstra_to (self->priv->graph,
-               left_shoulder,
-               ext_b,
-               width,
-               height,
-               dist_left_b,
-               previous_left_b);
+  /* The node grid is kept for the tracking of a single user */
+  priv->graph_is_persistent = FALSE;
 
-  dist_right_a = create_new_dist_matrix(matrix_size);
-  dijkstra_to (self->priv->graph,
-               right_shoulder,
-               ext_a,
-               width,
-               height,
-               dist_right_a, previous_right_a);
+  region.x = 0;
+  region.y = 0;
+  region.width = priv->buffer_width;
+  region.height = priv->buffer_height;
 
-  dist_right_b = create_new_dist_matrix(matrix_size);
-  dijkstra_to (self->priv->graph,
-               right_shoulder,
-               ext_b,
-               width,
-               height,
-               dist_right_b,
-               previous_right_b);
+  nodes = build_labelled_nodes (self, &region, &labels);
+  nodes = remove_small_labels (self, nodes, &labels);
 
-  total_dist_left_a = dist_left_a[ext_a->j * width + ext_a->i];
-  total_dist_right_a = dist_right_a[ext_a->j * width + ext_a->i];
-  total_dist_left_b = dist_left_b[ext_b->j * width + ext_b->i];
-  total_dist_right_b = dist_right_b[ext_b->j * width + ext_b->i];
+  users = get_main_components (nodes,
+                               priv->focus_node,
+                               priv->torso_minimum_number_nodes,
+                               priv->max_users);
 
-  if (total_dist_left_a < total_dist_right_a)
+  unjoined_labels = g_list_copy (labels);
+  for (current_user = g_list_first (users);
+       current_user != NULL;
+       current_user = g_list_next (current_user))
     {
-      index_left++;
-      left_extrema[index_left] = ext_a;
-      distances_left[index_left] = dist_left_a;
-      previous_left[index_left] = previous_left_a;
-    }
-  else
-    {
-      index_right++;
-      right_extrema[index_right] = ext_a;
-      distances_right[index_right] = dist_right_a;
-      previous_right[index_right] = previous_right_a;
+      unjoined_labels = g_list_remove (unjoined_labels, current_user->data);
     }
 
-  if (total_dist_left_b < total_dist_right_b)
-    {
-      index_left++;
-      left_extrema[index_left] = ext_b;
-      distances_left[index_left] = dist_left_b;
-      previous_left[index_left] = previous_left_b;
-    }
-  else
+  for (current_label = g_list_first (unjoined_labels);
+       current_label != NULL;
+       current_label = g_list_next (current_label))
     {
-      index_right++;
-      right_extrema[index_right] = ext_b;
-      distances_right[index_right] = dist_right_b;
-      previous_right[index_right] = previous_right_b;
-    }
+      Label *label;
+      GList *label_list;
+      Node *bridge_node = NULL, *to_node = NULL;
+      guint closest_distance = G_MAXUINT;
 
-  elbow_extrema = NULL;
-  hand_extrema = NULL;
-  identify_arm_extrema (distances_left[0],
-                        previous_left[0],
-                        width,
-                        self->priv->hands_minimum_distance,
-                        left_extrema[0],
-                        &elbow_extrema,
-                        &hand_extrema);
+      label = (Label *) current_label->data;
+      label_list = g_list_prepend (NULL, label);
 
-  /* Two left extremas */
-  if (index_left == 1)
-    {
-      if (hand_extrema == NULL)
+      /* The bridge to each user is looked for, and the shortest one
+         kept, the closest user to the focus node winning a tie */
+      for (current_user = g_list_first (users);
+           current_user != NULL;
+           current_user = g_list_next (current_user))
         {
-          hand_extrema = left_extrema[1];
-          elbow_extrema = left_extrema[0];
+          guint distance;
+
+          label->bridge_node = NULL;
+          join_components_to_main (label_list,
+                                   (Label *) current_user->data,
+                                   priv->distance_threshold,
+                                   priv->hands_minimum_distance,
+                                   priv->distance_threshold);
+          if (label->bridge_node == NULL)
+            continue;
+
+          distance = get_squared_distance (label->bridge_node,
+                                           label->to_node);
+          if (distance < closest_distance)
+            {
+              bridge_node = label->bridge_node;
+              to_node = label->to_node;
+              closest_distance = distance;
+            }
         }
-      else
+      g_list_free (label_list);
+
+      label->bridge_node = bridge_node;
+      label->to_node = to_node;
+
+      if (bridge_node != NULL)
         {
-          hand_extrema = left_extrema[0];
-          elbow_extrema = left_extrema[1];
+          add_label_bridge (label);
+          continue;
         }
+
+      nodes = remove_label_nodes (self, nodes, label);
+      labels = g_list_remove (labels, label);
+      free_label (label);
     }
+  g_list_free (unjoined_labels);
 
-  set_joint_from_node (joints,
-                       elbow_extrema,
-                       SKELTRACK_JOINT_ID_LEFT_ELBOW,
-                       self->priv->dimension_reduction);
-  set_joint_from_node (joints,
-                       hand_extrema,
-                       SKELTRACK_JOINT_ID_LEFT_HAND,
-                       self->priv->dimension_reduction);
+  *label_list = labels;
+  *user_list = users;
 
+  return nodes;
+}
 
-  elbow_extrema = NULL;
-  hand_extrema = NULL;
-  identify_arm_extrema (distances_right[0],
-                        previous_right[0],
-                        width,
-                        self->priv->hands_minimum_distance,
-                        right_extrema[0],
-                        &elbow_extrema,
-                        &hand_extrema);
+/* The nodes of a user's main component and of the components that
+   were joined to it, in the order of the graph */
+static GList *
+get_user_graph (GList *graph, Label *user)
+{
+  GList *current_node;
+  GList *nodes = NULL;
 
-  /* Two right extremas */
-  if (index_right == 1)
+  for (current_node = g_list_first (graph);
+       current_node != NULL;
+       current_node = g_list_next (current_node))
     {
-      if (hand_extrema == NULL)
-        {
-          hand_extrema = right_extrema[1];
-          elbow_extrema = right_extrema[0];
-        }
-      else
-        {
-          hand_extrema = right_extrema[0];
-          elbow_extrema = right_extrema[1];
-        }
+      Node *node = (Node *) current_node->data;
+
+      if (get_node_user_label (node) == user)
+        nodes = g_list_prepend (nodes, node);
     }
 
-  set_joint_from_node (joints,
-                       elbow_extrema,
-                       SKELTRACK_JOINT_ID_RIGHT_ELBOW,
-                       self->priv->dimension_reduction);
-  set_joint_from_node (joints,
-                       hand_extrema,
-                       SKELTRACK_JOINT_ID_RIGHT_HAND,
-                       self->priv->dimension_reduction);
+  return g_list_reverse (nodes);
+}
 
-  g_slice_free1 (matrix_size * sizeof (Node *), previous_left_a);
-  g_slice_free1 (matrix_size * sizeof (Node *), previous_left_b);
-  g_slice_free1 (matrix_size * sizeof (Node *), previous_right_a);
-  g_slice_free1 (matrix_size * sizeof (Node *), previous_right_b);
+/* The tracking of a user in its own copy of the private data, pointing
+   to the user's graph, so the users can be tracked in parallel */
+typedef struct {
+  SkeltrackSkeletonPrivate priv;
+  Label *label;
+  Node center;
+  gint id;
+  SkeltrackJointList joints;
+} UserTracking;
 
-  g_slice_free1 (matrix_size * sizeof (gint), dist_left_a);
-  g_slice_free1 (matrix_size * sizeof (gint), dist_left_b);
-  g_slice_free1 (matrix_size * sizeof (gint), dist_right_a);
-  g_slice_free1 (matrix_size * sizeof (gint), dist_right_b);
+static void
+track_user_joints (UserTracking *tracking)
+{
+  tracking->joints = track_joints_in_graph (&tracking->priv);
 }
 
-static Node *
-get_adjusted_shoulder (guint buffer_width,
-                       guint buffer_height,
-                       guint dimension_reduction,
-                       GList *graph,
-                       Node *centroid,
-                       Node *head,
-                       Node *shoulder)
+/* Runs in the threads of the users pool, and wakes up track_users()
+   when the last user pushed to the pool is tracked */
+static void
+track_user_joints_in_pool (gpointer data, gpointer user_data)
 {
-  Node *virtual_shoulder, *adjusted_shoulder = NULL;
-  virtual_shoulder = g_slice_new (Node);
-  virtual_shoulder->x = shoulder->x;
-  virtual_shoulder->y = shoulder->y;
-  virtual_shoulder->z = centroid->z;
+  SkeltrackSkeletonPrivate *priv = (SkeltrackSkeletonPrivate *) user_data;
 
-  convert_mm_to_screen_coords (buffer_width,
-                               buffer_height,
-                               dimension_reduction,
-                               virtual_shoulder->x,
-                               virtual_shoulder->y,
-                               virtual_shoulder->z,
-                               (guint *) &virtual_shoulder->i,
-                               (guint *) &virtual_shoulder->j);
+  track_user_joints ((UserTracking *) data);
 
-  adjusted_shoulder = get_closest_torso_node (graph,
-                                              virtual_shoulder,
-                                              head);
-  g_slice_free (Node, virtual_shoulder);
+  g_mutex_lock (&priv->users_mutex);
+  priv->nr_pending_users--;
+  if (priv->nr_pending_users == 0)
+    g_cond_signal (&priv->users_cond);
+  g_mutex_unlock (&priv->users_mutex);
+}
 
-  return adjusted_shoulder;
+/* The id of a user that is not tracked, or else of one that went
+   missing in this frame */
+static gint
+get_free_user_id (SkeltrackSkeletonPrivate *priv)
+{
+  guint i;
+
+  for (i = 0; i < priv->nr_users; i++)
+    {
+      if (! priv->users[i].active)
+        return i;
+    }
+
+  for (i = 0; i < priv->nr_users; i++)
+    {
+      if (! priv->users[i].found)
+        return i;
+    }
+
+  return -1;
 }
 
-static SkeltrackJoint **
-track_joints (SkeltrackSkeleton *self)
+/* Gives each user found the id of the closest user of the previous
+   frame, if its center did not move more than
+   USER_MAXIMUM_DISPLACEMENT, or otherwise a free one */
+static void
+assign_user_ids (SkeltrackSkeleton *self,
+                 UserTracking *trackings,
+                 guint nr_trackings)
 {
-  Node * centroid;
-  Node *head = NULL;
-  Node *right_shoulder = NULL;
-  Node *left_shoulder = NULL;
-  GList *extremas;
-  SkeltrackJointList joints = NULL;
-  SkeltrackJointList smoothed = NULL;
+  SkeltrackSkeletonPrivate *priv;
+  guint i, k;
 
-  self->priv->graph = make_graph (self, &self->priv->labels);
-  centroid = get_centroid (self);
-  extremas = get_extremas (self, centroid);
+  priv = self->priv;
 
-  if (g_list_length (extremas) > 2)
+  for (i = 0; i < priv->nr_users; i++)
+    priv->users[i].found = FALSE;
+
+  for (k = 0; k < nr_trackings; k++)
     {
-      if (self->priv->previous_head)
+      Node *center = &trackings[k].center;
+      guint closest_distance;
+
+      closest_distance = USER_MAXIMUM_DISPLACEMENT * USER_MAXIMUM_DISPLACEMENT;
+      trackings[k].id = -1;
+
+      for (i = 0; i < priv->nr_users; i++)
         {
-          gint distance;
-          gboolean can_be_head = FALSE;
-          head = get_closest_node_to_joint (extremas,
-                                            self->priv->previous_head,
-                                            &distance);
-          if (head != NULL &&
-              distance < GRAPH_DISTANCE_THRESHOLD)
+          TrackedUser *user = &priv->users[i];
+          gint dx, dy, dz;
+          guint distance;
+
+          if (! user->active || user->found)
+            continue;
+
+          dx = center->x - user->x;
+          dy = center->y - user->y;
+          dz = center->z - user->z;
+          distance = dx * dx + dy * dy + dz * dz;
+          if (distance < closest_distance)
             {
-              can_be_head = check_if_node_can_be_head (self,
-                                                       head,
-                                                       centroid,
-                                                       &left_shoulder,
-                                                       &right_shoulder);
+              closest_distance = distance;
+              trackings[k].id = i;
             }
-
-          if (!can_be_head)
-            head = NULL;
         }
 
-      if (head == NULL)
+      if (trackings[k].id != -1)
+        priv->users[trackings[k].id].found = TRUE;
+    }
+
+  for (k = 0; k < nr_trackings; k++)
+    {
+      TrackedUser *user;
+
+      if (trackings[k].id == -1)
         {
-          get_head_and_shoulders (self,
-                                  extremas,
-                                  centroid,
-                                  &head,
-                                  &left_shoulder,
-                                  &right_shoulder);
+          trackings[k].id = get_free_user_id (priv);
+
+          user = &priv->users[trackings[k].id];
+          clean_tracked_user (user);
+          user->active = TRUE;
+          user->found = TRUE;
+          user->smooth_data.joints_persistency =
+            priv->single_user.smooth_data.joints_persistency;
+          reset_joints_persistency_counter (&user->smooth_data);
         }
 
-      if (joints == NULL)
-        joints = skeltrack_joint_list_new ();
+      user = &priv->users[trackings[k].id];
+      user->missing_frames = 0;
+      user->x = trackings[k].center.x;
+      user->y = trackings[k].center.y;
+      user->z = trackings[k].center.z;
+    }
+}
 
-      set_joint_from_node (&joints,
-                           head,
-                           SKELTRACK_JOINT_ID_HEAD,
-                           self->priv->dimension_reduction);
+/* Tracks the joints of each user in the buffer, indexed by the user's
+   id, which runs the stages that prepare the buffer but not the ones
+   that look for a single user */
+static GPtrArray *
+track_users (SkeltrackSkeleton *self)
+{
+  SkeltrackSkeletonPrivate *priv;
+  GPtrArray *users;
+  GList *user_labels, *current_user;
+  UserTracking *trackings;
+  guint nr_trackings, i, k;
+  gsize matrix_size;
 
-      if (left_shoulder && head && head->z > left_shoulder->z)
-        {
-          Node *adjusted_shoulder;
-          adjusted_shoulder = get_adjusted_shoulder (self->priv->buffer_width,
-                                                self->priv->buffer_height,
-                                                self->priv->dimension_reduction,
-                                                self->priv->graph,
-                                                centroid,
-                                                head,
-                                                left_shoulder);
+  priv = self->priv;
 
-          if (adjusted_shoulder)
-            left_shoulder = adjusted_shoulder;
-        }
+  apply_property_changes (priv);
 
-      set_joint_from_node (&joints,
-                           left_shoulder,
-                           SKELTRACK_JOINT_ID_LEFT_SHOULDER,
-                           self->priv->dimension_reduction);
+  if (priv->nr_users != priv->max_users)
+    {
+      clean_tracked_users (self);
+      priv->users = g_slice_alloc0 (priv->max_users * sizeof (TrackedUser));
+      priv->nr_users = priv->max_users;
+    }
 
-      if (right_shoulder && head && head->z > right_shoulder->z)
-        {
-          Node *adjusted_shoulder;
-          adjusted_shoulder = get_adjusted_shoulder (self->priv->buffer_width,
-                                                self->priv->buffer_height,
-                                                self->priv->dimension_reduction,
-                                                self->priv->graph,
-                                                centroid,
-                                                head,
-                                                right_shoulder);
+  update_projection (&priv->projection,
+                     priv->camera_intrinsics,
+                     priv->buffer_width,
+                     priv->buffer_height,
+                     priv->dimension_reduction);
 
-          if (adjusted_shoulder)
-            right_shoulder = adjusted_shoulder;
-        }
-      set_joint_from_node (&joints,
-                           right_shoulder,
-                           SKELTRACK_JOINT_ID_RIGHT_SHOULDER,
-                           self->priv->dimension_reduction);
+  /* The depth gating would keep a single user */
+  prepare_buffer (self, FALSE);
+
+  priv->graph = make_users_graph (self, &priv->labels, &user_labels);
 
-      set_left_and_right_from_extremas (self,
-                                        extremas,
-                                        head,
-                                        left_shoulder,
-                                        right_shoulder,
-                                        &joints);
+  nr_trackings = g_list_length (user_labels);
+  trackings = g_slice_alloc0 (nr_trackings * sizeof (UserTracking));
+
+  for (current_user = g_list_first (user_labels), k = 0;
+       current_user != NULL;
+       current_user = g_list_next (current_user), k++)
+    {
+      trackings[k].label = (Label *) current_user->data;
+      get_nodes_center (trackings[k].label->nodes, &trackings[k].center);
     }
 
-  self->priv->buffer = NULL;
+  assign_user_ids (self, trackings, nr_trackings);
 
-  self->priv->main_component = NULL;
+  /* The copies share the arc, so it has to be computed before */
+  update_shoulders_arc (priv);
 
-  clean_nodes (self->priv->graph);
-  g_list_free (self->priv->graph);
-  self->priv->graph = NULL;
+  for (k = 0; k < nr_trackings; k++)
+    {
+      UserTracking *tracking = &trackings[k];
+
+      tracking->priv = *priv;
+      tracking->priv.graph = get_user_graph (priv->graph, tracking->label);
+      tracking->priv.labels = NULL;
+      tracking->priv.main_component = tracking->label->nodes;
+      tracking->priv.distances_matrix = NULL;
+      tracking->priv.user_label = tracking->label;
+      tracking->priv.user = &priv->users[tracking->id];
+    }
 
-  clean_labels (self->priv->labels);
-  g_list_free (self->priv->labels);
-  self->priv->labels = NULL;
+  /* The first user is tracked in this thread while the pool, which is
+     kept from frame to frame, tracks the others */
+  if (nr_trackings > 1 && priv->users_pool == NULL)
+    {
+      priv->users_pool = g_thread_pool_new (track_user_joints_in_pool,
+                                            priv,
+                                            -1,
+                                            FALSE,
+                                            NULL);
+    }
 
-  if (self->priv->enable_smoothing)
+  priv->nr_pending_users = nr_trackings > 1 ? nr_trackings - 1 : 0;
+  for (k = 1; k < nr_trackings; k++)
+    g_thread_pool_push (priv->users_pool, &trackings[k], NULL);
+
+  if (nr_trackings > 0)
+    track_user_joints (&trackings[0]);
+
+  g_mutex_lock (&priv->users_mutex);
+  while (priv->nr_pending_users > 0)
+    g_cond_wait (&priv->users_cond, &priv->users_mutex);
+  g_mutex_unlock (&priv->users_mutex);
+
+  users = g_ptr_array_new_with_free_func ((GDestroyNotify) skeltrack_joint_list_free);
+  g_ptr_array_set_size (users, priv->nr_users);
+
+  matrix_size = priv->buffer_width * priv->buffer_height;
+  for (k = 0; k < nr_trackings; k++)
+    {
+      UserTracking *tracking = &trackings[k];
+
+      g_list_free (tracking->priv.graph);
+      g_slice_free1 (matrix_size * sizeof (gint),
+                     tracking->priv.distances_matrix);
+
+      g_ptr_array_index (users, tracking->id) = tracking->joints;
+    }
+
+  g_slice_free1 (nr_trackings * sizeof (UserTracking), trackings);
+
+  clean_graph (self);
+  g_list_free (priv->graph);
+  priv->graph = NULL;
+
+  clean_labels (priv->labels);
+  g_list_free (priv->labels);
+  priv->labels = NULL;
+
+  g_list_free (user_labels);
+
+  priv->buffer.data = NULL;
+
+  for (i = 0; i < priv->nr_users; i++)
     {
-      smooth_joints (&self->priv->smooth_data, joints);
+      TrackedUser *user = &priv->users[i];
+      SkeltrackJointList joints;
+      SkeltrackJoint *head;
 
-      if (self->priv->smooth_data.smoothed_joints != NULL)
+      if (! user->active)
+        continue;
+
+      /* A missing user keeps its id while its joints persist */
+      if (! user->found)
         {
-          guint i;
-          smoothed = skeltrack_joint_list_new ();
-          for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+          user->missing_frames++;
+          if (user->missing_frames >
+              priv->single_user.smooth_data.joints_persistency)
             {
-              SkeltrackJoint *smoothed_joint, *smooth, *trend;
-              smoothed_joint = NULL;
-              smooth = self->priv->smooth_data.smoothed_joints[i];
-              if (smooth != NULL)
-                {
-                  if (self->priv->smooth_data.trend_joints != NULL)
-                    {
-                      trend = self->priv->smooth_data.trend_joints[i];
-                      if (trend != NULL)
-                        {
-                          smoothed_joint = g_slice_new0 (SkeltrackJoint);
-                          smoothed_joint->x = smooth->x + trend->x;
-                          smoothed_joint->y = smooth->y + trend->y;
-                          smoothed_joint->z = smooth->z + trend->z;
-                          smoothed_joint->screen_x = smooth->screen_x + trend->screen_x;
-                          smoothed_joint->screen_y = smooth->screen_y + trend->screen_y;
-                        }
-                      else
-                        smoothed_joint = skeltrack_joint_copy (smooth);
-                    }
-                  else
-                    smoothed_joint = skeltrack_joint_copy (smooth);
-                }
-              smoothed[i] = smoothed_joint;
+              clean_tracked_user (user);
+              continue;
             }
         }
-      skeltrack_joint_list_free (joints);
 
-      joints = smoothed;
+      joints = g_ptr_array_index (users, i);
+
+      if (priv->enable_smoothing)
+        {
+          user->smooth_data.smoothing_factor =
+            priv->single_user.smooth_data.smoothing_factor;
+          user->smooth_data.joints_persistency =
+            priv->single_user.smooth_data.joints_persistency;
+          joints = get_smoothed_joints (&user->smooth_data, joints);
+          g_ptr_array_index (users, i) = joints;
+        }
+
+      if (joints == NULL)
+        continue;
+
+      head = skeltrack_joint_list_get_joint (joints, SKELTRACK_JOINT_ID_HEAD);
+      if (head != NULL)
+        {
+          skeltrack_joint_free (user->previous_head);
+          user->previous_head = skeltrack_joint_copy (head);
+        }
+    }
+
+  return users;
+}
+
+/* Builds a graph of the full resolution points around the hand and
+   replaces the hand with the node farthest from the elbow, which is
+   where the arm ends */
+static void
+refine_hand (SkeltrackSkeleton *self,
+             SkeltrackJointList joints,
+             SkeltrackJointId hand_id,
+             SkeltrackJointId elbow_id,
+             guint16 *buffer,
+             guint width,
+             guint height,
+             const Projection *projection)
+{
+  SkeltrackJoint *hand, *elbow;
+  DepthBuffer depth_buffer;
+  Region window;
+  Node **node_matrix;
+  Node *source, *closest_to_hand, *farthest;
+  GList *nodes;
+  GList *current;
+  gint *distances;
+  gint radius, distance;
+
+  hand = joints[hand_id];
+  elbow = joints[elbow_id];
+  if (hand == NULL || elbow == NULL)
+    return;
+
+  radius = convert_mm_to_screen_length (projection,
+                                        self->priv->hand_refinement_radius,
+                                        hand->z);
+  window.x = MAX (hand->screen_x - radius, 0);
+  window.y = MAX (hand->screen_y - radius, 0);
+  window.width = MIN (hand->screen_x + radius + 1, (gint) width) - window.x;
+  window.height = MIN (hand->screen_y + radius + 1, (gint) height) -
+    window.y;
+  if (window.width <= 0 || window.height <= 0)
+    return;
+
+  init_depth_buffer (&depth_buffer, buffer, width);
+
+  /* Nodes are indexed inside the window */
+  node_matrix = g_slice_alloc0 (window.width * window.height *
+                                sizeof (Node *));
+  nodes = make_window_graph (self->priv,
+                             &depth_buffer,
+                             projection,
+                             &window,
+                             hand,
+                             self->priv->hand_refinement_radius,
+                             NULL,
+                             1,
+                             node_matrix);
+
+  source = get_closest_node_to_joint (nodes, elbow, &distance);
+  closest_to_hand = get_closest_node_to_joint (nodes, hand, &distance);
+  if (source == NULL || closest_to_hand == NULL)
+    {
+      g_slice_free1 (window.width * window.height * sizeof (Node *),
+                     node_matrix);
+      clean_nodes (nodes);
+      g_list_free (nodes);
+      return;
     }
 
-  if (joints)
+  distances = create_new_dist_matrix (window.width * window.height);
+  dijkstra_to (nodes,
+               source,
+               NULL,
+               window.width,
+               window.height,
+               distances,
+               NULL);
+
+  /* Only refine if the hand is connected to where the elbow is */
+  farthest = NULL;
+  if (distances[closest_to_hand->j * window.width + closest_to_hand->i] != -1)
     {
-      SkeltrackJoint *joint = skeltrack_joint_list_get_joint (joints,
-                                                   SKELTRACK_JOINT_ID_HEAD);
-      if (joint != NULL)
+      for (current = g_list_first (nodes);
+           current != NULL;
+           current = g_list_next (current))
         {
-          skeltrack_joint_free (self->priv->previous_head);
-          self->priv->previous_head = skeltrack_joint_copy (joint);
+          Node *node = (Node *) current->data;
+          gint node_distance = distances[node->j * window.width + node->i];
+
+          if (node_distance != -1 &&
+              (farthest == NULL ||
+               node_distance > distances[farthest->j * window.width +
+                                         farthest->i]))
+            {
+              farthest = node;
+            }
         }
     }
 
-  g_list_free (extremas);
+  if (farthest != NULL)
+    {
+      hand->x = farthest->x;
+      hand->y = farthest->y;
+      hand->z = farthest->z;
+      hand->screen_x = window.x + farthest->i;
+      hand->screen_y = window.y + farthest->j;
+    }
 
-  return joints;
+  g_slice_free1 (window.width * window.height * sizeof (gint), distances);
+  g_slice_free1 (window.width * window.height * sizeof (Node *),
+                 node_matrix);
+  clean_nodes (nodes);
+  g_list_free (nodes);
 }
 
 static void
@@ -1771,6 +5754,60 @@ clean_tracking_resources (SkeltrackSkeleton *self)
   self->priv->node_matrix = NULL;
 }
 
+static void
+set_buffer_size (SkeltrackSkeleton *self, guint width, guint height)
+{
+  if (self->priv->buffer_width != width ||
+      self->priv->buffer_height != height)
+    {
+      clean_tracking_resources (self);
+
+      self->priv->buffer_width = width;
+      self->priv->buffer_height = height;
+    }
+}
+
+/* Sets the buffer to track, which is reduced by reading only every
+   step points and rows */
+static void
+set_buffer (SkeltrackSkeleton    *self,
+            gconstpointer         buffer,
+            SkeltrackDepthFormat  format,
+            guint                 width,
+            guint                 height,
+            gsize                 rowstride,
+            guint                 step)
+{
+  self->priv->buffer.data = buffer;
+  self->priv->buffer.rowstride = rowstride;
+  self->priv->buffer.step = step;
+  self->priv->buffer.format = format;
+  self->priv->buffer.min_depth = 0;
+  self->priv->buffer.max_depth = G_MAXUINT16;
+  self->priv->points = NULL;
+
+  if (format == SKELTRACK_DEPTH_FORMAT_DISPARITY)
+    self->priv->buffer.disparity_table = get_disparity_table ();
+
+  set_buffer_size (self, width, height);
+}
+
+/* Sets the points to track instead of a buffer, the width and height
+   being the ones of the reduced buffer they fall on */
+static void
+set_points (SkeltrackSkeleton         *self,
+            const SkeltrackDepthPoint *points,
+            guint                      nr_points,
+            guint                      width,
+            guint                      height)
+{
+  self->priv->buffer.data = NULL;
+  self->priv->points = points;
+  self->priv->nr_points = nr_points;
+
+  set_buffer_size (self, width, height);
+}
+
 static void
 track_joints_in_thread (GSimpleAsyncResult *res,
                         GObject            *object,
@@ -1792,6 +5829,59 @@ track_joints_in_thread (GSimpleAsyncResult *res,
   g_object_unref (res);
 }
 
+/* Either a buffer or the points, if not NULL, are tracked */
+static void
+track_joints_async (SkeltrackSkeleton         *self,
+                    gconstpointer              buffer,
+                    SkeltrackDepthFormat       format,
+                    const SkeltrackDepthPoint *points,
+                    guint                      nr_points,
+                    guint                      width,
+                    guint                      height,
+                    gsize                      rowstride,
+                    guint                      step,
+                    GCancellable              *cancellable,
+                    GAsyncReadyCallback        callback,
+                    gpointer                   user_data,
+                    gpointer                   source_tag)
+{
+  GSimpleAsyncResult *result = NULL;
+
+  result = g_simple_async_result_new (G_OBJECT (self),
+                                      callback,
+                                      user_data,
+                                      source_tag);
+
+  if (self->priv->track_joints_result != NULL)
+    {
+      g_simple_async_result_set_error (result,
+                                       G_IO_ERROR,
+                                       G_IO_ERROR_PENDING,
+                                       "Currently tracking joints");
+      g_simple_async_result_complete_in_idle (result);
+      g_object_unref (result);
+      return;
+    }
+
+  g_mutex_lock (&self->priv->track_joints_mutex);
+
+  self->priv->track_joints_result = G_ASYNC_RESULT (result);
+
+  /* @TODO: Set the cancellable */
+
+  if (points != NULL)
+    set_points (self, points, nr_points, width, height);
+  else
+    set_buffer (self, buffer, format, width, height, rowstride, step);
+
+  g_simple_async_result_run_in_thread (result,
+                                       track_joints_in_thread,
+                                       G_PRIORITY_DEFAULT,
+                                       cancellable);
+
+  g_mutex_unlock (&self->priv->track_joints_mutex);
+}
+
 /* public methods */
 
 /**
@@ -1893,51 +5983,151 @@ skeltrack_skeleton_track_joints (SkeltrackSkeleton   *self,
                                  GAsyncReadyCallback  callback,
                                  gpointer             user_data)
 {
-  GSimpleAsyncResult *result = NULL;
-
   g_return_if_fail (SKELTRACK_IS_SKELETON (self) &&
                     callback != NULL &&
                     buffer != NULL);
 
-  result = g_simple_async_result_new (G_OBJECT (self),
-                                      callback,
-                                      user_data,
-                                      skeltrack_skeleton_track_joints);
-
-  if (self->priv->track_joints_result != NULL)
-    {
-      g_simple_async_result_set_error (result,
-                                       G_IO_ERROR,
-                                       G_IO_ERROR_PENDING,
-                                       "Currently tracking joints");
-      g_simple_async_result_complete_in_idle (result);
-      g_object_unref (result);
-      return;
-    }
-
-  g_mutex_lock (&self->priv->track_joints_mutex);
-
-  self->priv->track_joints_result = G_ASYNC_RESULT (result);
-
-  /* @TODO: Set the cancellable */
+  track_joints_async (self,
+                      buffer,
+                      SKELTRACK_DEPTH_FORMAT_MM,
+                      NULL,
+                      0,
+                      width,
+                      height,
+                      width * sizeof (guint16),
+                      1,
+                      cancellable,
+                      callback,
+                      user_data,
+                      skeltrack_skeleton_track_joints);
+}
 
-  self->priv->buffer = buffer;
+/**
+ * skeltrack_skeleton_track_joints_full:
+ * @self: The #SkeltrackSkeleton
+ * @buffer: The full resolution buffer containing the depth information,
+ * from which all the information will be retrieved.
+ * @format: The #SkeltrackDepthFormat of the @buffer
+ * @width: The width of the @buffer
+ * @height: The height of the @buffer
+ * @rowstride: The number of bytes between the start of two rows of
+ * the @buffer
+ * @cancellable: (allow-none): A cancellable object, or %NULL (currently
+ *  unused)
+ * @callback: (scope async): The #GAsyncReadyCallback that will be called
+ * when the operation finishes
+ * @user_data: (allow-none): User data to pass to the callback
+ *
+ * Does the same as skeltrack_skeleton_track_joints() but with the full
+ * resolution buffer, as given by the device, instead of one that was
+ * already reduced.
+ *
+ * The @buffer is reduced by #SkeltrackSkeleton:dimension-reduction and
+ * converted to mm while it is read, without being copied, so it must not
+ * be changed until the operation finishes. Use skeltrack_skeleton_track_joints_finish() to get
+ * the joints.
+ **/
+void
+skeltrack_skeleton_track_joints_full (SkeltrackSkeleton    *self,
+                                      gconstpointer         buffer,
+                                      SkeltrackDepthFormat  format,
+                                      guint                 width,
+                                      guint                 height,
+                                      guint                 rowstride,
+                                      GCancellable         *cancellable,
+                                      GAsyncReadyCallback   callback,
+                                      gpointer              user_data)
+{
+  guint step;
 
-  if (self->priv->buffer_width != width ||
-      self->priv->buffer_height != height)
-    {
-      clean_tracking_resources (self);
+  g_return_if_fail (SKELTRACK_IS_SKELETON (self) &&
+                    callback != NULL &&
+                    buffer != NULL);
 
-      self->priv->buffer_width = width;
-      self->priv->buffer_height = height;
-    }
+  step = self->priv->dimension_reduction;
+  track_joints_async (self,
+                      buffer,
+                      format,
+                      NULL,
+                      0,
+                      width / step,
+                      height / step,
+                      rowstride,
+                      step,
+                      cancellable,
+                      callback,
+                      user_data,
+                      skeltrack_skeleton_track_joints_full);
+}
 
-  g_simple_async_result_run_in_thread (result,
-                                       track_joints_in_thread,
-                                       G_PRIORITY_DEFAULT,
-                                       cancellable);
+/**
+ * skeltrack_skeleton_track_joints_points:
+ * @self: The #SkeltrackSkeleton
+ * @points: (array length=nr_points): The points of the user, from which
+ * all the information will be retrieved.
+ * @nr_points: The number of @points
+ * @width: The width of the full resolution frame of the @points
+ * @height: The height of the full resolution frame of the @points
+ * @cancellable: (allow-none): A cancellable object, or %NULL (currently
+ *  unused)
+ * @callback: (scope async): The #GAsyncReadyCallback that will be called
+ * when the operation finishes
+ * @user_data: (allow-none): User data to pass to the callback
+ *
+ * Does the same as skeltrack_skeleton_track_joints_full() but with a
+ * sparse list of points, like the ones of a user already segmented by
+ * another stage, instead of a buffer. The graph is built directly from
+ * the @points, so they do not have to be written into an empty buffer
+ * first and the work depends on their number rather than on the size of
+ * the frame.
+ *
+ * The @points are binned in the cells of
+ * #SkeltrackSkeleton:dimension-reduction columns and rows they fall in,
+ * whatever their coordinates, and the first point of each cell in the
+ * order of the rows is used. So when they include the ones a reduction
+ * would read, the joints are the same as the ones found in a buffer
+ * holding the @points. The @points can be in any order and those with a
+ * depth of 0 are ignored.
+ *
+ * The stages that work on the whole buffer, like the
+ * #SkeltrackSkeleton:enable-region-of-interest,
+ * #SkeltrackSkeleton:enable-pyramid or the filters of the buffer, are
+ * not used with points.
+ *
+ * The @points are not copied so they must not be changed until the
+ * operation finishes. Use skeltrack_skeleton_track_joints_finish() to
+ * get the joints.
+ **/
+void
+skeltrack_skeleton_track_joints_points (SkeltrackSkeleton         *self,
+                                        const SkeltrackDepthPoint *points,
+                                        guint                      nr_points,
+                                        guint                      width,
+                                        guint                      height,
+                                        GCancellable              *cancellable,
+                                        GAsyncReadyCallback        callback,
+                                        gpointer                   user_data)
+{
+  guint step;
 
-  g_mutex_unlock (&self->priv->track_joints_mutex);
+  g_return_if_fail (SKELTRACK_IS_SKELETON (self) &&
+                    callback != NULL &&
+                    points != NULL);
+
+  step = self->priv->dimension_reduction;
+  track_joints_async (self,
+                      NULL,
+                      SKELTRACK_DEPTH_FORMAT_MM,
+                      points,
+                      nr_points,
+                      width / step,
+                      height / step,
+                      0,
+                      step,
+                      cancellable,
+                      callback,
+                      user_data,
+                      skeltrack_skeleton_track_joints_points);
 }
 
 /**
@@ -2020,16 +6210,244 @@ skeltrack_skeleton_track_joints_sync (SkeltrackSkeleton   *self,
       return NULL;
     }
 
-  self->priv->buffer = buffer;
+  set_buffer (self,
+              buffer,
+              SKELTRACK_DEPTH_FORMAT_MM,
+              width,
+              height,
+              width * sizeof (guint16),
+              1);
 
-  if (self->priv->buffer_width != width ||
-      self->priv->buffer_height != height)
+  return track_joints (self);
+}
+
+/**
+ * skeltrack_skeleton_track_joints_full_sync:
+ * @self: The #SkeltrackSkeleton
+ * @buffer: The full resolution buffer containing the depth information,
+ * from which all the information will be retrieved.
+ * @format: The #SkeltrackDepthFormat of the @buffer
+ * @width: The width of the @buffer
+ * @height: The height of the @buffer
+ * @rowstride: The number of bytes between the start of two rows of
+ * the @buffer
+ * @cancellable: (allow-none): A cancellable object, or %NULL (currently
+ *  unused)
+ * @error: (allow-none): A pointer to a #GError, or %NULL
+ *
+ * Does the same as skeltrack_skeleton_track_joints_full() but
+ * synchronously and returns the list of joints found.
+ *
+ * The joints list should be freed using skeltrack_joint_list_free().
+ *
+ * Returns: (transfer full): The #SkeltrackJointList with the joints found.
+ **/
+SkeltrackJointList
+skeltrack_skeleton_track_joints_full_sync (SkeltrackSkeleton    *self,
+                                           gconstpointer         buffer,
+                                           SkeltrackDepthFormat  format,
+                                           guint                 width,
+                                           guint                 height,
+                                           guint                 rowstride,
+                                           GCancellable         *cancellable,
+                                           GError              **error)
+{
+  guint step;
+
+  g_return_val_if_fail (SKELTRACK_IS_SKELETON (self), NULL);
+
+  if (self->priv->track_joints_result != NULL && error != NULL)
     {
-      clean_tracking_resources (self);
+      *error = g_error_new (G_IO_ERROR,
+                            G_IO_ERROR_PENDING,
+                            "Currently tracking joints");
+      return NULL;
+    }
 
-      self->priv->buffer_width = width;
-      self->priv->buffer_height = height;
+  step = self->priv->dimension_reduction;
+  set_buffer (self,
+              buffer,
+              format,
+              width / step,
+              height / step,
+              rowstride,
+              step);
+
+  return track_joints (self);
+}
+
+/**
+ * skeltrack_skeleton_track_joints_points_sync:
+ * @self: The #SkeltrackSkeleton
+ * @points: (array length=nr_points): The points of the user, from which
+ * all the information will be retrieved.
+ * @nr_points: The number of @points
+ * @width: The width of the full resolution frame of the @points
+ * @height: The height of the full resolution frame of the @points
+ * @cancellable: (allow-none): A cancellable object, or %NULL (currently
+ *  unused)
+ * @error: (allow-none): A pointer to a #GError, or %NULL
+ *
+ * Does the same as skeltrack_skeleton_track_joints_points() but
+ * synchronously and returns the list of joints found.
+ *
+ * The joints list should be freed using skeltrack_joint_list_free().
+ *
+ * Returns: (transfer full): The #SkeltrackJointList with the joints found.
+ **/
+SkeltrackJointList
+skeltrack_skeleton_track_joints_points_sync (SkeltrackSkeleton         *self,
+                                             const SkeltrackDepthPoint *points,
+                                             guint                      nr_points,
+                                             guint                      width,
+                                             guint                      height,
+                                             GCancellable              *cancellable,
+                                             GError                   **error)
+{
+  guint step;
+
+  g_return_val_if_fail (SKELTRACK_IS_SKELETON (self), NULL);
+  g_return_val_if_fail (points != NULL, NULL);
+
+  if (self->priv->track_joints_result != NULL && error != NULL)
+    {
+      *error = g_error_new (G_IO_ERROR,
+                            G_IO_ERROR_PENDING,
+                            "Currently tracking joints");
+      return NULL;
     }
 
+  step = self->priv->dimension_reduction;
+  set_points (self, points, nr_points, width / step, height / step);
+
   return track_joints (self);
 }
+
+/**
+ * skeltrack_skeleton_track_users_sync:
+ * @self: The #SkeltrackSkeleton
+ * @buffer: The buffer containing the depth information, from which
+ * all the information will be retrieved.
+ * @width: The width of the @buffer
+ * @height: The height of the @buffer
+ * @cancellable: (allow-none): A cancellable object, or %NULL (currently
+ *  unused)
+ * @error: (allow-none): A pointer to a #GError, or %NULL
+ *
+ * Tracks the joints of up to #SkeltrackSkeleton:max-users users
+ * synchronously, the ones closest to the focus point.
+ *
+ * The graph of the @buffer is only built once: each of its components
+ * large enough to be a user is tracked as
+ * skeltrack_skeleton_track_joints_sync() tracks the single user, in
+ * parallel in a pool of threads kept by the skeleton, while the smaller
+ * components are joined to the user they are closest to.
+ *
+ * A user keeps its id, which is its index in the returned array, from
+ * one frame to the next while it does not move more than 500 mm; the
+ * entries of the users that are not tracked are %NULL. The stages that
+ * look for a single user, like the region of interest, the pyramid and
+ * the depth gating, are not used.
+ *
+ * If this method is called while a previous attempt of asynchronously
+ * tracking the joints is still running, a %G_IO_ERROR_PENDING error occurs.
+ *
+ * The array should be freed using g_ptr_array_unref(), which also frees
+ * the joints lists.
+ *
+ * Returns: (transfer full): A #GPtrArray with the #SkeltrackJointList
+ * of each user.
+ **/
+GPtrArray *
+skeltrack_skeleton_track_users_sync (SkeltrackSkeleton   *self,
+                                     guint16             *buffer,
+                                     guint                width,
+                                     guint                height,
+                                     GCancellable        *cancellable,
+                                     GError             **error)
+{
+  g_return_val_if_fail (SKELTRACK_IS_SKELETON (self), NULL);
+
+  if (self->priv->track_joints_result != NULL && error != NULL)
+    {
+      *error = g_error_new (G_IO_ERROR,
+                            G_IO_ERROR_PENDING,
+                            "Currently tracking joints");
+      return NULL;
+    }
+
+  set_buffer (self,
+              buffer,
+              SKELTRACK_DEPTH_FORMAT_MM,
+              width,
+              height,
+              width * sizeof (guint16),
+              1);
+
+  return track_users (self);
+}
+
+/**
+ * skeltrack_skeleton_refine_hands:
+ * @self: The #SkeltrackSkeleton
+ * @joints: The #SkeltrackJointList returned for the buffer obtained from
+ * @buffer
+ * @buffer: The full resolution buffer containing the depth information,
+ * before it was reduced by #SkeltrackSkeleton:dimension-reduction
+ * @width: The width of the @buffer
+ * @height: The height of the @buffer
+ *
+ * Refines the position of the hands in @joints, which is otherwise
+ * limited by #SkeltrackSkeleton:dimension-reduction.
+ *
+ * For each hand, the points of @buffer inside a window of
+ * #SkeltrackSkeleton:hand-refinement-radius around it are used to find
+ * the farthest point from the elbow, which replaces the hand. A hand is
+ * left as it is if its elbow was not found.
+ **/
+void
+skeltrack_skeleton_refine_hands (SkeltrackSkeleton   *self,
+                                 SkeltrackJointList   joints,
+                                 guint16             *buffer,
+                                 guint                width,
+                                 guint                height)
+{
+  SkeltrackCameraIntrinsics *intrinsics;
+  Projection projection;
+
+  g_return_if_fail (SKELTRACK_IS_SKELETON (self));
+  g_return_if_fail (buffer != NULL);
+
+  if (joints == NULL)
+    return;
+
+  /* A buffer may be being tracked, so the intrinsics are copied */
+  g_mutex_lock (&self->priv->track_joints_mutex);
+  intrinsics = get_camera_intrinsics (self->priv);
+  intrinsics = skeltrack_camera_intrinsics_copy (intrinsics);
+  g_mutex_unlock (&self->priv->track_joints_mutex);
+
+  /* The buffer is not reduced */
+  memset (&projection, 0, sizeof (Projection));
+  update_projection (&projection, intrinsics, width, height, 1);
+
+  refine_hand (self,
+               joints,
+               SKELTRACK_JOINT_ID_LEFT_HAND,
+               SKELTRACK_JOINT_ID_LEFT_ELBOW,
+               buffer,
+               width,
+               height,
+               &projection);
+  refine_hand (self,
+               joints,
+               SKELTRACK_JOINT_ID_RIGHT_HAND,
+               SKELTRACK_JOINT_ID_RIGHT_ELBOW,
+               buffer,
+               width,
+               height,
+               &projection);
+
+  clean_projection (&projection);
+  skeltrack_camera_intrinsics_free (intrinsics);
+}
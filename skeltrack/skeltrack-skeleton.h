@@ -24,6 +24,7 @@
 #define __SKELTRACK_SKELETON_H__
 
 #include <skeltrack-joint.h>
+#include <skeltrack-depth.h>
 #include <glib.h>
 #include <glib-object.h>
 #include <gio/gio.h>
@@ -57,38 +58,87 @@ struct _SkeltrackSkeletonClass
   GObjectClass parent_class;
 };
 
-GType                 skeltrack_skeleton_get_type               (void) G_GNUC_CONST;
-
-SkeltrackSkeleton *   skeltrack_skeleton_new                    (void);
-
-void                  skeltrack_skeleton_track_joints           (SkeltrackSkeleton   *self,
-                                                                 guint16             *buffer,
-                                                                 guint                width,
-                                                                 guint                height,
-                                                                 GCancellable        *cancellable,
-                                                                 GAsyncReadyCallback  callback,
-                                                                 gpointer             user_data);
-
-SkeltrackJointList    skeltrack_skeleton_track_joints_finish    (SkeltrackSkeleton *self,
-                                                                 GAsyncResult      *result,
-                                                                 GError           **error);
-
-SkeltrackJointList    skeltrack_skeleton_track_joints_sync      (SkeltrackSkeleton   *self,
-                                                                 guint16             *buffer,
-                                                                 guint                width,
-                                                                 guint                height,
-                                                                 GCancellable        *cancellable,
-                                                                 GError             **error);
-
-void                  skeltrack_skeleton_get_focus_point        (SkeltrackSkeleton   *self,
-                                                                 gint                *x,
-                                                                 gint                *y,
-                                                                 gint                *z);
-
-void                  skeltrack_skeleton_set_focus_point        (SkeltrackSkeleton   *self,
-                                                                 gint                 x,
-                                                                 gint                 y,
-                                                                 gint                 z);
+GType                 skeltrack_skeleton_get_type                 (void) G_GNUC_CONST;
+
+SkeltrackSkeleton *   skeltrack_skeleton_new                      (void);
+
+void                  skeltrack_skeleton_track_joints             (SkeltrackSkeleton   *self,
+                                                                   guint16             *buffer,
+                                                                   guint                width,
+                                                                   guint                height,
+                                                                   GCancellable        *cancellable,
+                                                                   GAsyncReadyCallback  callback,
+                                                                   gpointer             user_data);
+
+SkeltrackJointList    skeltrack_skeleton_track_joints_finish      (SkeltrackSkeleton *self,
+                                                                   GAsyncResult      *result,
+                                                                   GError           **error);
+
+SkeltrackJointList    skeltrack_skeleton_track_joints_sync        (SkeltrackSkeleton   *self,
+                                                                   guint16             *buffer,
+                                                                   guint                width,
+                                                                   guint                height,
+                                                                   GCancellable        *cancellable,
+                                                                   GError             **error);
+
+void                  skeltrack_skeleton_track_joints_full        (SkeltrackSkeleton    *self,
+                                                                   gconstpointer         buffer,
+                                                                   SkeltrackDepthFormat  format,
+                                                                   guint                 width,
+                                                                   guint                 height,
+                                                                   guint                 rowstride,
+                                                                   GCancellable         *cancellable,
+                                                                   GAsyncReadyCallback   callback,
+                                                                   gpointer              user_data);
+
+SkeltrackJointList    skeltrack_skeleton_track_joints_full_sync   (SkeltrackSkeleton    *self,
+                                                                   gconstpointer         buffer,
+                                                                   SkeltrackDepthFormat  format,
+                                                                   guint                 width,
+                                                                   guint                 height,
+                                                                   guint                 rowstride,
+                                                                   GCancellable         *cancellable,
+                                                                   GError              **error);
+
+void                  skeltrack_skeleton_track_joints_points      (SkeltrackSkeleton         *self,
+                                                                   const SkeltrackDepthPoint *points,
+                                                                   guint                      nr_points,
+                                                                   guint                      width,
+                                                                   guint                      height,
+                                                                   GCancellable              *cancellable,
+                                                                   GAsyncReadyCallback        callback,
+                                                                   gpointer                   user_data);
+
+SkeltrackJointList    skeltrack_skeleton_track_joints_points_sync (SkeltrackSkeleton         *self,
+                                                                   const SkeltrackDepthPoint *points,
+                                                                   guint                      nr_points,
+                                                                   guint                      width,
+                                                                   guint                      height,
+                                                                   GCancellable              *cancellable,
+                                                                   GError                   **error);
+
+GPtrArray *           skeltrack_skeleton_track_users_sync         (SkeltrackSkeleton   *self,
+                                                                   guint16             *buffer,
+                                                                   guint                width,
+                                                                   guint                height,
+                                                                   GCancellable        *cancellable,
+                                                                   GError             **error);
+
+void                  skeltrack_skeleton_get_focus_point          (SkeltrackSkeleton   *self,
+                                                                   gint                *x,
+                                                                   gint                *y,
+                                                                   gint                *z);
+
+void                  skeltrack_skeleton_set_focus_point          (SkeltrackSkeleton   *self,
+                                                                   gint                 x,
+                                                                   gint                 y,
+                                                                   gint                 z);
+
+void                  skeltrack_skeleton_refine_hands             (SkeltrackSkeleton   *self,
+                                                                   SkeltrackJointList   joints,
+                                                                   guint16             *buffer,
+                                                                   guint                width,
+                                                                   guint                height);
 
 G_END_DECLS
 
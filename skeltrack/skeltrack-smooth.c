@@ -200,6 +200,8 @@ smooth_joints (SmoothData *data,
           continue;
         }
 
+      smoothed_joint->confidence = joint->confidence;
+
       if (trend_joint == NULL)
         {
           /* First case (when there are only initial values) */
@@ -224,3 +226,30 @@ smooth_joints (SmoothData *data,
         }
     }
 }
+
+/* Moves the smoothed joints along their trend, as if they had been
+   found where it predicts them in a frame that was not tracked */
+void
+extrapolate_joints (SmoothData *data)
+{
+  guint i;
+
+  if (data->smoothed_joints == NULL || data->trend_joints == NULL)
+    return;
+
+  for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+    {
+      SkeltrackJoint *smoothed_joint, *trend_joint;
+
+      smoothed_joint = data->smoothed_joints[i];
+      trend_joint = data->trend_joints[i];
+      if (smoothed_joint == NULL || trend_joint == NULL)
+        continue;
+
+      smoothed_joint->x += trend_joint->x;
+      smoothed_joint->y += trend_joint->y;
+      smoothed_joint->z += trend_joint->z;
+      smoothed_joint->screen_x += trend_joint->screen_x;
+      smoothed_joint->screen_y += trend_joint->screen_y;
+    }
+}
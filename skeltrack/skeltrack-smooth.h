@@ -34,3 +34,5 @@ void    reset_joints_persistency_counter    (SmoothData *smooth_data);
 
 void    smooth_joints                       (SmoothData           *data,
                                              SkeltrackJointList    new_joints);
+
+void    extrapolate_joints                  (SmoothData           *data);
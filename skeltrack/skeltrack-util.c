@@ -25,10 +25,15 @@
 #include "skeltrack-util.h"
 #include "pqueue.h"
 
-/* @TODO: Expose these to the user */
+/* The Kinect's model, used when no camera intrinsics are set */
 static const gfloat SCALE_FACTOR = .0021;
 static const gint MIN_DISTANCE = -10.0;
 
+/* Kinect's raw disparity to depth calibration */
+static const gdouble DISPARITY_SLOPE = -0.0030711016;
+static const gdouble DISPARITY_OFFSET = 3.3309495161;
+static const guint16 DISPARITY_INVALID = 2047;
+
 static SkeltrackJoint *
 node_to_joint (Node *node, SkeltrackJointId id, gint dimension_reduction)
 {
@@ -44,18 +49,43 @@ node_to_joint (Node *node, SkeltrackJointId id, gint dimension_reduction)
   joint->z = node->z;
   joint->screen_x = node->i * dimension_reduction;
   joint->screen_y = node->j * dimension_reduction;
+  joint->confidence = 1;
 
   return joint;
 }
 
-static guint
+/* The square root rounded down, computed one bit at a time, which is
+   what truncating the floating point sqrt of a guint gives */
+guint
+get_integer_sqrt (guint value)
+{
+  guint root = 0;
+  guint bit = 1u << 30;
+
+  while (bit > value)
+    bit >>= 2;
+
+  while (bit != 0)
+    {
+      if (value >= root + bit)
+        {
+          value -= root + bit;
+          root = (root >> 1) + bit;
+        }
+      else
+        {
+          root >>= 1;
+        }
+      bit >>= 2;
+    }
+
+  return root;
+}
+
+guint
 get_distance_from_joint (Node *node, SkeltrackJoint *joint)
 {
-  guint dx, dy, dz;
-  dx = ABS (node->x - joint->x);
-  dy = ABS (node->y - joint->y);
-  dz = ABS (node->z - joint->z);
-  return sqrt (dx * dx + dy * dy + dz * dz);
+  return get_integer_sqrt (get_squared_distance_from_joint (node, joint));
 }
 
 static void
@@ -105,9 +135,8 @@ get_closest_node_with_distances (GList *node_list,
        current_node != NULL;
        current_node = g_list_next (current_node))
     {
-      guint dx, dy, dz;
+      guint dx, dy, dz, squared_distance;
       Node *node;
-      gint current_distance;
       node = (Node *) current_node->data;
 
       dx = ABS (from->x - node->x);
@@ -117,11 +146,14 @@ get_closest_node_with_distances (GList *node_list,
       if (dx > x_dist || dy > y_dist || dz > z_dist)
         continue;
 
-      current_distance = sqrt (dx * dx + dy * dy + dz * dz);
-      if (closest == NULL || distance > current_distance)
+      /* Only nodes closer than the truncated distance of the closest
+         one replace it, and only then is the root taken */
+      squared_distance = dx * dx + dy * dy + dz * dz;
+      if (closest == NULL ||
+          squared_distance < (guint) distance * (guint) distance)
         {
           closest = node;
-          distance = current_distance;
+          distance = get_integer_sqrt (squared_distance);
         }
     }
 
@@ -142,16 +174,16 @@ get_closest_node_to_joint (GList *extremas,
        current_node != NULL;
        current_node = g_list_next (current_node))
     {
-      guint current_dist;
+      guint squared_dist;
       Node *node = (Node *) current_node->data;
       if (node == NULL)
         continue;
 
-      current_dist = get_distance_from_joint (node, joint);
-      if (dist == -1 || current_dist < dist)
+      squared_dist = get_squared_distance_from_joint (node, joint);
+      if (dist == -1 || squared_dist < (guint) dist * (guint) dist)
         {
           closest_node = node;
-          dist = current_dist;
+          dist = get_integer_sqrt (squared_dist);
         }
     }
   *distance = dist;
@@ -161,11 +193,74 @@ get_closest_node_to_joint (GList *extremas,
 gint
 get_distance (Node *a, Node *b)
 {
-  guint dx, dy, dz;
-  dx = ABS (a->x - b->x);
-  dy = ABS (a->y - b->y);
-  dz = ABS (a->z - b->z);
-  return sqrt (dx * dx + dy * dy + dz * dz);
+  return get_integer_sqrt (get_squared_distance (a, b));
+}
+
+/* The slot in the edge weights of a for the edge to b, or -1 if b is
+   not in one of the 8 cells around a */
+static gint
+get_edge_weight_index (Node *a, Node *b)
+{
+  gint di, dj, index;
+
+  di = b->i - a->i;
+  dj = b->j - a->j;
+  if (di < -1 || di > 1 || dj < -1 || dj > 1 || (di == 0 && dj == 0))
+    return -1;
+
+  index = (dj + 1) * 3 + di + 1;
+  return index > 4 ? index - 1 : index;
+}
+
+/* Keeps the length of the edge between two nodes of neighbor cells in
+   both of them so the shortest path searches of the frame do not
+   compute it again */
+void
+set_edge_weight (Node *a, Node *b, guint distance)
+{
+  gint index_a, index_b;
+
+  index_a = get_edge_weight_index (a, b);
+  index_b = get_edge_weight_index (b, a);
+  if (index_a == -1 || index_b == -1)
+    return;
+
+  if (distance >= G_MAXUINT16)
+    {
+      clear_edge_weight (a, b);
+      return;
+    }
+
+  a->edge_weights[index_a] = distance + 1;
+  b->edge_weights[index_b] = distance + 1;
+}
+
+void
+clear_edge_weight (Node *a, Node *b)
+{
+  gint index_a, index_b;
+
+  index_a = get_edge_weight_index (a, b);
+  index_b = get_edge_weight_index (b, a);
+  if (index_a == -1 || index_b == -1)
+    return;
+
+  a->edge_weights[index_a] = 0;
+  b->edge_weights[index_b] = 0;
+}
+
+/* Edges added without a weight, like the bridges between components
+   or the ones of the merged nodes, are measured when followed */
+static gint
+get_edge_weight (Node *a, Node *b)
+{
+  gint index;
+
+  index = get_edge_weight_index (a, b);
+  if (index != -1 && a->edge_weights[index] != 0)
+    return a->edge_weights[index] - 1;
+
+  return get_distance (a, b);
 }
 
 Node *
@@ -183,16 +278,17 @@ get_closest_torso_node (GList *node_list, Node *from, Node *head)
        current_node = g_list_next (current_node))
     {
       Node *node;
-      gint current_distance;
+      guint squared_distance;
       node = (Node *) current_node->data;
       if (node->z >= head->z &&
           node->y >= from->y)
         {
-          current_distance = get_distance (node, from);
-          if (closest == NULL || current_distance < distance)
+          squared_distance = get_squared_distance (node, from);
+          if (closest == NULL ||
+              squared_distance < (guint) distance * (guint) distance)
             {
               closest = node;
-              distance = current_distance;
+              distance = get_integer_sqrt (squared_distance);
             }
         }
     }
@@ -214,7 +310,7 @@ get_closest_node (GList *node_list, Node *from)
        current_node = g_list_next (current_node))
     {
       Node *node;
-      gint current_distance;
+      guint squared_distance;
       node = (Node *) current_node->data;
       if (closest == NULL)
         {
@@ -222,11 +318,11 @@ get_closest_node (GList *node_list, Node *from)
           distance = get_distance (node, from);
           continue;
         }
-      current_distance = get_distance (node, from);
-      if (current_distance < distance)
+      squared_distance = get_squared_distance (node, from);
+      if (squared_distance < (guint) distance * (guint) distance)
         {
           closest = node;
-          distance = current_distance;
+          distance = get_integer_sqrt (squared_distance);
         }
     }
   return closest;
@@ -245,7 +341,7 @@ get_main_component (GList *node_list, Node *from, gdouble min_normalized_nr_node
   {
     Node *node;
     Label *label;
-    gint current_distance;
+    guint squared_distance;
     node = (Node *) current_node->data;
     label = node->label;
 
@@ -257,18 +353,65 @@ get_main_component (GList *node_list, Node *from, gdouble min_normalized_nr_node
         continue;
       }
 
-    current_distance = get_distance (node, from);
-    if (current_distance < distance &&
+    squared_distance = get_squared_distance (node, from);
+    if (main_component != NULL &&
+        squared_distance < (guint) distance * (guint) distance &&
         label->normalized_num_nodes > min_normalized_nr_nodes)
       {
         main_component = label;
-        distance = current_distance;
+        distance = get_integer_sqrt (squared_distance);
       }
   }
 
   return main_component;
 }
 
+/* Like get_main_component but returns up to max_components labels,
+   from the closest one to the farthest */
+GList *
+get_main_components (GList *node_list,
+                     Node *from,
+                     gdouble min_normalized_nr_nodes,
+                     guint max_components)
+{
+  GList *components = NULL;
+  guint i;
+
+  for (i = 0; i < max_components; i++)
+    {
+      Label *component = NULL;
+      guint distance = 0;
+      GList *current_node;
+
+      for (current_node = g_list_first (node_list);
+           current_node != NULL;
+           current_node = g_list_next (current_node))
+        {
+          Node *node;
+          guint squared_distance;
+          node = (Node *) current_node->data;
+
+          if (node->label->normalized_num_nodes <= min_normalized_nr_nodes ||
+              g_list_find (components, node->label) != NULL)
+            continue;
+
+          squared_distance = get_squared_distance (node, from);
+          if (component == NULL || squared_distance < distance)
+            {
+              component = node->label;
+              distance = squared_distance;
+            }
+        }
+
+      if (component == NULL)
+        break;
+
+      components = g_list_append (components, component);
+    }
+
+  return components;
+}
+
 Label *
 label_find (Label *label)
 {
@@ -350,6 +493,25 @@ clean_nodes (GList *nodes)
     }
 }
 
+/* Sets all the cells of node_matrix covered by the node to value */
+void
+set_node_cells (Node **node_matrix, gint width, Node *node, Node *value)
+{
+  gint i, j, start_i, start_j, size;
+
+  size = MAX (node->size, 1);
+  start_i = node->i - size / 2;
+  start_j = node->j - size / 2;
+
+  for (j = start_j; j < start_j + size; j++)
+    {
+      for (i = start_i; i < start_i + size; i++)
+        {
+          node_matrix[width * j + i] = value;
+        }
+    }
+}
+
 GList *
 remove_nodes_with_label (GList *nodes,
                          Node **node_matrix,
@@ -368,7 +530,7 @@ remove_nodes_with_label (GList *nodes,
           link_to_delete = current_node;
           current_node = g_list_next (current_node);
           nodes = g_list_delete_link (nodes, link_to_delete);
-          node_matrix[width * node->j + node->i] = NULL;
+          set_node_cells (node_matrix, width, node, NULL);
           free_node (node, TRUE);
           continue;
         }
@@ -377,6 +539,37 @@ remove_nodes_with_label (GList *nodes,
   return nodes;
 }
 
+/* Like remove_nodes_with_label but the nodes are not freed, they
+   are prepended to detached_nodes instead */
+GList *
+detach_nodes_with_label (GList *nodes,
+                         Node **node_matrix,
+                         gint width,
+                         Label *label,
+                         GList **detached_nodes)
+{
+  Node *node;
+  GList *link_to_delete, *current_node;
+
+  current_node = g_list_first (nodes);
+  while (current_node != NULL)
+    {
+      node = (Node *) current_node->data;
+      if (node->label == label)
+        {
+          link_to_delete = current_node;
+          current_node = g_list_next (current_node);
+          nodes = g_list_delete_link (nodes, link_to_delete);
+          set_node_cells (node_matrix, width, node, NULL);
+          unlink_node (node);
+          *detached_nodes = g_list_prepend (*detached_nodes, node);
+          continue;
+        }
+      current_node = g_list_next (current_node);
+    }
+  return nodes;
+}
+
 Label *
 get_lowest_index_label (Label **neighbor_labels)
 {
@@ -483,6 +676,24 @@ set_joint_from_node (SkeltrackJointList *joints,
   (*joints)[id] = node_to_joint (node, id, dimension_reduction);
 }
 
+SkeltrackJointList
+copy_joint_list (SkeltrackJointList joints)
+{
+  guint i;
+  SkeltrackJointList copy;
+
+  if (joints == NULL)
+    return NULL;
+
+  copy = skeltrack_joint_list_new ();
+  for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+    {
+      copy[i] = skeltrack_joint_copy (joints[i]);
+    }
+
+  return copy;
+}
+
 gint *
 create_new_dist_matrix (gint matrix_size)
 {
@@ -498,6 +709,41 @@ create_new_dist_matrix (gint matrix_size)
   return distances;
 }
 
+/* Returns the index of the largest value of a per cell field, like
+   the distances given by dijkstra_to, or -1 if all the cells are -1,
+   which marks the unset ones. Ties go to the rightmost and then
+   lowest cell, which is the order the graph's nodes are listed in.
+
+   The maximum is found first in a plain pass over the field, with
+   the unset cells needing no mask as any set value is larger, so it
+   can be vectorized by the compiler; only the cells holding it are
+   then compared by position. */
+gint
+get_field_maximum (const gint *field, gint width, gint height)
+{
+  gint k, size, maximum, index = -1;
+
+  size = width * height;
+  maximum = -1;
+  for (k = 0; k < size; k++)
+    maximum = MAX (maximum, field[k]);
+
+  if (maximum == -1)
+    return -1;
+
+  /* Going by rows, a later cell in the same column is lower */
+  for (k = 0; k < size; k++)
+    {
+      if (field[k] == maximum &&
+          (index == -1 || k % width >= index % width))
+        {
+          index = k;
+        }
+    }
+
+  return index;
+}
+
 gboolean
 dijkstra_to (GList *nodes, Node *source, Node *target,
              gint width, gint height,
@@ -556,7 +802,7 @@ dijkstra_to (GList *nodes, Node *source, Node *target,
 
           if (pqueue_has_element (queue, neighbor))
             {
-              dist = get_distance (node, neighbor) +
+              dist = get_edge_weight (node, neighbor) +
                 distances[node->j * width + node->i];
               pqueue_delete (queue, neighbor);
 
@@ -581,47 +827,156 @@ dijkstra_to (GList *nodes, Node *source, Node *target,
   return FALSE;
 }
 
+/* Sets the projection for a buffer of the given size, only computing
+   the factors of each column and row again if it changed. Without
+   intrinsics, the Kinect is assumed. */
 void
-convert_screen_coords_to_mm (guint width,
-                             guint height,
-                             guint dimension_reduction,
-                             guint i,
-                             guint j,
-                             gint  z,
-                             gint *x,
-                             gint *y)
-{
-  gfloat width_height_relation =
-    width > height ? (gfloat) width / height : (gfloat) height / width;
-  /* Formula from http://openkinect.org/wiki/Imaging_Information */
-  *x = round((i * dimension_reduction - width * dimension_reduction / 2.0) *
-             (z + MIN_DISTANCE) * SCALE_FACTOR * width_height_relation);
-  *y = round((j * dimension_reduction - height * dimension_reduction / 2.0) *
-             (z + MIN_DISTANCE) * SCALE_FACTOR);
+update_projection (Projection                      *projection,
+                   const SkeltrackCameraIntrinsics *intrinsics,
+                   guint                            width,
+                   guint                            height,
+                   guint                            dimension_reduction)
+{
+  guint i, j;
+
+  if (projection->column_factors != NULL &&
+      projection->width == width &&
+      projection->height == height &&
+      projection->dimension_reduction == dimension_reduction)
+    {
+      return;
+    }
+
+  clean_projection (projection);
+
+  projection->width = width;
+  projection->height = height;
+  projection->dimension_reduction = dimension_reduction;
+
+  if (intrinsics != NULL)
+    {
+      projection->horizontal_scale = 1.0 / intrinsics->focal_length_x;
+      projection->vertical_scale = 1.0 / intrinsics->focal_length_y;
+      projection->principal_point_x = intrinsics->principal_point_x;
+      projection->principal_point_y = intrinsics->principal_point_y;
+      projection->depth_offset = intrinsics->depth_offset;
+    }
+  else
+    {
+      gfloat width_height_relation =
+        width > height ? (gfloat) width / height : (gfloat) height / width;
+
+      /* Formula from http://openkinect.org/wiki/Imaging_Information */
+      projection->horizontal_scale = SCALE_FACTOR * width_height_relation;
+      projection->vertical_scale = SCALE_FACTOR;
+      projection->principal_point_x = width * dimension_reduction / 2.0;
+      projection->principal_point_y = height * dimension_reduction / 2.0;
+      projection->depth_offset = MIN_DISTANCE;
+    }
+
+  projection->column_factors = g_slice_alloc (width * sizeof (gdouble));
+  for (i = 0; i < width; i++)
+    {
+      projection->column_factors[i] =
+        (i * dimension_reduction - projection->principal_point_x) *
+        projection->horizontal_scale;
+    }
+
+  projection->row_factors = g_slice_alloc (height * sizeof (gdouble));
+  for (j = 0; j < height; j++)
+    {
+      projection->row_factors[j] =
+        (j * dimension_reduction - projection->principal_point_y) *
+        projection->vertical_scale;
+    }
+}
+
+void
+clean_projection (Projection *projection)
+{
+  if (projection->column_factors == NULL)
+    return;
+
+  g_slice_free1 (projection->width * sizeof (gdouble),
+                 projection->column_factors);
+  g_slice_free1 (projection->height * sizeof (gdouble),
+                 projection->row_factors);
+
+  projection->column_factors = NULL;
+  projection->row_factors = NULL;
 }
 
 void
-convert_mm_to_screen_coords (guint  width,
-                             guint  height,
-                             guint  dimension_reduction,
-                             gint   x,
-                             gint   y,
-                             gint   z,
-                             guint *i,
-                             guint *j)
+convert_mm_to_screen_coords (const Projection *projection,
+                             gint              x,
+                             gint              y,
+                             gint              z,
+                             guint            *i,
+                             guint            *j)
 {
-  gfloat width_height_relation =
-    width > height ? (gfloat) width / height : (gfloat) height / width;
+  gint depth = z + projection->depth_offset;
+  guint dimension_reduction = projection->dimension_reduction;
 
-  if (z + MIN_DISTANCE == 0)
+  if (depth == 0)
     {
       *i = 0;
       *j = 0;
       return;
     }
 
-  *i = round (width / 2.0 + x / ((gfloat) (z + MIN_DISTANCE) * SCALE_FACTOR *
-                                 dimension_reduction * width_height_relation));
-  *j = round (height / 2.0 + y / ((gfloat) (z + MIN_DISTANCE) * SCALE_FACTOR *
-                                  dimension_reduction));
+  *i = round ((projection->principal_point_x +
+               x / (depth * projection->horizontal_scale)) /
+              dimension_reduction);
+  *j = round ((projection->principal_point_y +
+               y / (depth * projection->vertical_scale)) /
+              dimension_reduction);
+}
+
+/* Table converting a raw disparity into depth in mm (or 0 if it is
+   invalid), computed only once */
+const guint16 *
+get_disparity_table (void)
+{
+  static guint16 *table = NULL;
+
+  if (g_once_init_enter (&table))
+    {
+      guint16 *new_table;
+      guint disparity;
+
+      new_table = g_new0 (guint16, DISPARITY_TABLE_SIZE);
+      for (disparity = 0; disparity < DISPARITY_INVALID; disparity++)
+        {
+          gdouble inverse_depth = disparity * DISPARITY_SLOPE +
+            DISPARITY_OFFSET;
+
+          if (inverse_depth <= 0 || 1000 / inverse_depth >= G_MAXUINT16)
+            continue;
+
+          new_table[disparity] = round (1000 / inverse_depth);
+        }
+
+      g_once_init_leave (&table, new_table);
+    }
+
+  return table;
+}
+
+/* Converts a length (in mm) at the given depth into a number of
+   cells of the (reduced) buffer. The smaller of the two scales is
+   used, giving the most cells, so the result never falls short. */
+guint
+convert_mm_to_screen_length (const Projection *projection,
+                             guint             length,
+                             gint              z)
+{
+  gint depth = z + projection->depth_offset;
+
+  if (depth <= 0)
+    return 0;
+
+  return ceil (length / (depth *
+                         MIN (projection->horizontal_scale,
+                              projection->vertical_scale) *
+                         projection->dimension_reduction));
 }
@@ -24,10 +24,19 @@
 #define __SKELTRACK_UTIL_H__
 
 #include <glib.h>
+#include <math.h>
 #include "skeltrack-joint.h"
+#include "skeltrack-depth.h"
+#include "skeltrack-camera.h"
+
+/* Raw disparity values have 11 bits */
+#define DISPARITY_TABLE_SIZE 2048
 
 typedef struct _Label Label;
 typedef struct _Node Node;
+typedef struct _Region Region;
+typedef struct _DepthBuffer DepthBuffer;
+typedef struct _Projection Projection;
 
 struct _Label {
   gint index;
@@ -50,8 +59,157 @@ struct _Node {
   GList *neighbors;
   GList *linked_nodes;
   Label *label;
+  /* Side, in cells, of the block of the buffer merged into the node,
+     which is then centered on it; 0 or 1 for a single cell */
+  gint size;
+  /* Lengths of the edges to the nodes of the 8 cells around this one,
+     stored plus one so a new node has none; see set_edge_weight() */
+  guint16 edge_weights[8];
+};
+
+struct _Region {
+  gint x;
+  gint y;
+  gint width;
+  gint height;
+};
+
+/* A buffer whose points are read every step points and rows, so the
+   reduction can be done while reading it. Points are converted to mm
+   from the buffer's format as they are read, and the ones out of the
+   range of depth are read as 0, so the buffer can be gated without
+   being copied. */
+struct _DepthBuffer {
+  const guint8 *data;
+  gsize rowstride;
+  guint step;
+  SkeltrackDepthFormat format;
+  const guint16 *disparity_table;
+  guint16 min_depth;
+  guint16 max_depth;
+};
+
+/* Converts between the cells of a (reduced) buffer and mm. What each
+   column and row contributes is computed once per resolution, leaving
+   a multiplication by the depth for each point. */
+struct _Projection {
+  guint width;
+  guint height;
+  guint dimension_reduction;
+  gdouble horizontal_scale;
+  gdouble vertical_scale;
+  gdouble principal_point_x;
+  gdouble principal_point_y;
+  gint depth_offset;
+  gdouble *column_factors;
+  gdouble *row_factors;
 };
 
+/* Sets the buffer to read a (reduced) buffer in mm */
+static inline void
+init_depth_buffer (DepthBuffer *buffer, const guint16 *data, guint width)
+{
+  buffer->data = (const guint8 *) data;
+  buffer->rowstride = width * sizeof (guint16);
+  buffer->step = 1;
+  buffer->format = SKELTRACK_DEPTH_FORMAT_MM;
+  buffer->min_depth = 0;
+  buffer->max_depth = G_MAXUINT16;
+}
+
+/* Values are packed most significant bit first, so a value never
+   spans more than two bytes for the supported sizes */
+static inline guint16
+get_packed_value (const guint8 *row, guint index, guint bits)
+{
+  gsize bit = (gsize) index * bits;
+  guint16 value;
+
+  value = (row[bit / 8] << 8) | row[bit / 8 + 1];
+  return (value >> (16 - bits - bit % 8)) & ((1 << bits) - 1);
+}
+
+static inline guint16
+read_depth_value (const DepthBuffer *buffer, guint i, guint j)
+{
+  const guint8 *row;
+  gfloat metres;
+
+  row = buffer->data + (gsize) j * buffer->step * buffer->rowstride;
+  i *= buffer->step;
+
+  switch (buffer->format)
+    {
+    case SKELTRACK_DEPTH_FORMAT_DISPARITY:
+      return buffer->disparity_table[((const guint16 *) row)[i] &
+                                     (DISPARITY_TABLE_SIZE - 1)];
+
+    case SKELTRACK_DEPTH_FORMAT_PACKED_10BIT:
+      return get_packed_value (row, i, 10);
+
+    case SKELTRACK_DEPTH_FORMAT_PACKED_12BIT:
+      return get_packed_value (row, i, 12);
+
+    case SKELTRACK_DEPTH_FORMAT_FLOAT_METRES:
+      metres = ((const gfloat *) row)[i];
+      if (! (metres > 0) || metres * 1000 >= G_MAXUINT16)
+        return 0;
+      return metres * 1000 + .5;
+
+    case SKELTRACK_DEPTH_FORMAT_MM:
+    default:
+      return ((const guint16 *) row)[i];
+    }
+}
+
+static inline guint16
+get_depth_value (const DepthBuffer *buffer, guint i, guint j)
+{
+  guint16 value = read_depth_value (buffer, i, j);
+
+  if (value < buffer->min_depth || value > buffer->max_depth)
+    return 0;
+
+  return value;
+}
+
+/* The number of cells of the buffer the node stands for */
+static inline gint
+get_node_area (const Node *node)
+{
+  return node->size > 1 ? node->size * node->size : 1;
+}
+
+/* Squared distances let callers compare against a threshold without
+   a square root: get_distance (a, b) < t is the same as
+   get_squared_distance (a, b) < t * t */
+static inline guint
+get_squared_distance (const Node *a, const Node *b)
+{
+  guint dx, dy, dz;
+  dx = ABS (a->x - b->x);
+  dy = ABS (a->y - b->y);
+  dz = ABS (a->z - b->z);
+  return dx * dx + dy * dy + dz * dz;
+}
+
+static inline guint
+get_squared_distance_from_joint (const Node *node, const SkeltrackJoint *joint)
+{
+  guint dx, dy, dz;
+  dx = ABS (node->x - joint->x);
+  dy = ABS (node->y - joint->y);
+  dz = ABS (node->z - joint->z);
+  return dx * dx + dy * dy + dz * dz;
+}
+
+const guint16 * get_disparity_table            (void);
+
+guint         get_integer_sqrt                 (guint value);
+
+guint         get_distance_from_joint          (Node           *node,
+                                                SkeltrackJoint *joint);
+
 Node *        get_closest_node_to_joint        (GList *extremas,
                                                 SkeltrackJoint *joint,
                                                 gint *distance);
@@ -66,12 +224,23 @@ Label *       get_main_component               (GList   *node_list,
                                                 Node    *from,
                                                 gdouble  min_normalized_nr_nodes);
 
+GList *       get_main_components              (GList   *node_list,
+                                                Node    *from,
+                                                gdouble  min_normalized_nr_nodes,
+                                                guint    max_components);
+
 Label *       label_find                       (Label *label);
 
 void          label_union                      (Label *a, Label *b);
 
 gint          get_distance                     (Node *a, Node *b);
 
+void          set_edge_weight                  (Node *a,
+                                                Node *b,
+                                                guint distance);
+
+void          clear_edge_weight                (Node *a, Node *b);
+
 void          free_label                       (Label *label);
 
 void          clean_labels                     (GList *labels);
@@ -81,11 +250,22 @@ void          free_node                        (Node *node,
 
 void          clean_nodes                      (GList *nodes);
 
+void          set_node_cells                   (Node **node_matrix,
+                                                gint width,
+                                                Node *node,
+                                                Node *value);
+
 GList *       remove_nodes_with_label          (GList *nodes,
                                                 Node **node_matrix,
                                                 gint width,
                                                 Label *label);
 
+GList *       detach_nodes_with_label          (GList *nodes,
+                                                Node **node_matrix,
+                                                gint width,
+                                                Label *label,
+                                                GList **detached_nodes);
+
 Label *       get_lowest_index_label           (Label **neighbor_labels);
 
 Label *       new_label                        (gint index);
@@ -101,6 +281,8 @@ void          set_joint_from_node              (SkeltrackJointList *joints,
                                                 SkeltrackJointId id,
                                                 gint dimension_reduction);
 
+SkeltrackJointList copy_joint_list              (SkeltrackJointList joints);
+
 gint *        create_new_dist_matrix           (gint matrix_size);
 
 gboolean      dijkstra_to                      (GList *nodes,
@@ -111,21 +293,40 @@ gboolean      dijkstra_to                      (GList *nodes,
                                                 gint *distances,
                                                 Node **previous);
 
-void          convert_screen_coords_to_mm      (guint width,
-                                                guint height,
-                                                guint dimension_reduction,
-                                                guint i,
-                                                guint j,
-                                                gint  z,
-                                                gint *x,
-                                                gint *y);
-
-void          convert_mm_to_screen_coords      (guint  width,
-                                                guint  height,
-                                                guint  dimension_reduction,
-                                                gint   x,
-                                                gint   y,
-                                                gint   z,
-                                                guint *i,
-                                                guint *j);
+gint          get_field_maximum                (const gint *field,
+                                                gint width,
+                                                gint height);
+
+void          update_projection                (Projection                      *projection,
+                                                const SkeltrackCameraIntrinsics *intrinsics,
+                                                guint                            width,
+                                                guint                            height,
+                                                guint                            dimension_reduction);
+
+void          clean_projection                 (Projection *projection);
+
+void          convert_mm_to_screen_coords      (const Projection *projection,
+                                                gint              x,
+                                                gint              y,
+                                                gint              z,
+                                                guint            *i,
+                                                guint            *j);
+
+guint         convert_mm_to_screen_length      (const Projection *projection,
+                                                guint             length,
+                                                gint              z);
+
+static inline void
+convert_screen_coords_to_mm (const Projection *projection,
+                             guint i,
+                             guint j,
+                             gint  z,
+                             gint *x,
+                             gint *y)
+{
+  gint depth = z + projection->depth_offset;
+
+  *x = lround (projection->column_factors[i] * depth);
+  *y = lround (projection->row_factors[j] * depth);
+}
 #endif /* __SKELTRACK_UTIL_H__ */
@@ -24,5 +24,7 @@
 #define __SKELTRACK_H__
 
 #include <skeltrack-skeleton.h>
+#include <skeltrack-depth.h>
+#include <skeltrack-camera.h>
 
 #endif /* __SKELTRACK_H__ */
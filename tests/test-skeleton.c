@@ -171,6 +171,27 @@ get_number_of_valid_joints (SkeltrackJointList list)
   return count;
 }
 
+static void
+assert_joint_lists_equal (SkeltrackJointList list, SkeltrackJointList other)
+{
+  gint i;
+
+  g_assert (list != NULL && other != NULL);
+
+  for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+    {
+      g_assert ((list[i] == NULL) == (other[i] == NULL));
+      if (list[i] == NULL)
+        continue;
+
+      g_assert_cmpint (list[i]->x, ==, other[i]->x);
+      g_assert_cmpint (list[i]->y, ==, other[i]->y);
+      g_assert_cmpint (list[i]->z, ==, other[i]->z);
+      g_assert_cmpint (list[i]->screen_x, ==, other[i]->screen_x);
+      g_assert_cmpint (list[i]->screen_y, ==, other[i]->screen_y);
+    }
+}
+
 static void
 test_init (Fixture      *f,
            gconstpointer test_data)
@@ -340,42 +361,2068 @@ test_pending_operation (Fixture *f,
   g_main_loop_run (f->main_loop);
 }
 
-gint
-main (gint argc, gchar **argv)
+static void
+test_incremental_graph (Fixture *f,
+                        gconstpointer test_data)
 {
-  guint i;
-  g_test_init (&argc, &argv, NULL);
+  SkeltrackSkeleton *incremental;
+  guint reduction, width, height, i, j;
 
-  g_test_add ("/skeltrack/skeleton/init",
-              Fixture,
-              NULL,
-              fixture_setup,
-              test_init,
-              fixture_teardown);
+  incremental = skeltrack_skeleton_new ();
+  g_object_set (incremental,
+                "enable-incremental-graph", TRUE,
+                "enable-smoothing", FALSE,
+                NULL);
+  g_object_set (f->skeleton, "enable-smoothing", FALSE, NULL);
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
 
-  for (i = 0; i < NUMBER_OF_FILES; i++)
+  /* Each file is tracked twice so both fully changed and
+     unchanged frames are compared */
+  for (i = 0; i < NUMBER_OF_FILES * 2; i++)
     {
-      g_test_add ("/skeltrack/skeleton/track_joints_number",
-                  Fixture,
-                  DEPTH_FILES[i],
-                  fixture_setup_main_loop,
-                  test_track_joints_number,
-                  fixture_teardown_main_loop);
+      SkeltrackJointList list, incremental_list;
+      guint16 *depth;
 
-      g_test_add ("/skeltrack/skeleton/track_joints_number_sync",
-                  Fixture,
-                  DEPTH_FILES[i],
-                  fixture_setup,
-                  test_track_joints_number_sync,
-                  fixture_teardown);
+      depth = reduce_depth_file (DEPTH_FILES[i / 2],
+                                 reduction,
+                                 &width,
+                                 &height);
+
+      list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                                   depth,
+                                                   width,
+                                                   height,
+                                                   NULL,
+                                                   NULL);
+      incremental_list = skeltrack_skeleton_track_joints_sync (incremental,
+                                                               depth,
+                                                               width,
+                                                               height,
+                                                               NULL,
+                                                               NULL);
+      g_assert (list != NULL);
+      g_assert (incremental_list != NULL);
+
+      for (j = 0; j < SKELTRACK_JOINT_MAX_JOINTS; j++)
+        {
+          g_assert ((list[j] == NULL) == (incremental_list[j] == NULL));
+          if (list[j] == NULL)
+            continue;
+
+          g_assert_cmpint (list[j]->x, ==, incremental_list[j]->x);
+          g_assert_cmpint (list[j]->y, ==, incremental_list[j]->y);
+          g_assert_cmpint (list[j]->z, ==, incremental_list[j]->z);
+        }
+
+      g_slice_free1 (width * height * sizeof (guint16), depth);
+      skeltrack_joint_list_free (list);
+      skeltrack_joint_list_free (incremental_list);
     }
 
-  g_test_add ("/skeltrack/skeleton/pending_operation",
-              Fixture,
-              NULL,
-              fixture_setup_main_loop,
-              test_pending_operation,
-              fixture_teardown_main_loop);
+  g_object_unref (incremental);
+}
+
+static void
+test_static_scene (Fixture *f,
+                   gconstpointer test_data)
+{
+  SkeltrackJointList list, cached_list;
+  guint reduction, width, height, skipped_frames, i;
+  guint16 *depth;
+
+  g_object_set (f->skeleton, "enable-static-scene-detection", TRUE, NULL);
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+
+  depth = reduce_depth_file (DEPTH_FILES[0],
+                             reduction,
+                             &width,
+                             &height);
+
+  list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                               depth,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+  cached_list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                                      depth,
+                                                      width,
+                                                      height,
+                                                      NULL,
+                                                      NULL);
+
+  g_object_get (f->skeleton, "skipped-frames", &skipped_frames, NULL);
+  g_assert_cmpuint (skipped_frames, ==, 1);
+
+  g_assert (list != NULL);
+  g_assert (cached_list != NULL);
+  for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+    {
+      g_assert ((list[i] == NULL) == (cached_list[i] == NULL));
+      if (list[i] != NULL)
+        {
+          g_assert_cmpint (list[i]->x, ==, cached_list[i]->x);
+          g_assert_cmpint (list[i]->y, ==, cached_list[i]->y);
+          g_assert_cmpint (list[i]->z, ==, cached_list[i]->z);
+        }
+    }
+
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+  skeltrack_joint_list_free (list);
+  skeltrack_joint_list_free (cached_list);
+}
+
+static void
+test_static_scene_small_change (Fixture *f,
+                                gconstpointer test_data)
+{
+  SkeltrackJointList list;
+  guint reduction, width, height, skipped_frames, i, j;
+  guint16 *depth;
+
+  g_object_set (f->skeleton, "enable-static-scene-detection", TRUE, NULL);
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+
+  depth = reduce_depth_file (DEPTH_FILES[0],
+                             reduction,
+                             &width,
+                             &height);
+
+  list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                               depth,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+  skeltrack_joint_list_free (list);
+
+  /* Only a couple of points move, such as a hand would, which is
+     a change even if the rest of the scene stays the same */
+  for (i = width / 2; i < width / 2 + 2; i++)
+    {
+      for (j = height / 2; j < height / 2 + 1; j++)
+        depth[j * width + i] += 100;
+    }
+
+  list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                               depth,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+  skeltrack_joint_list_free (list);
+
+  g_object_get (f->skeleton, "skipped-frames", &skipped_frames, NULL);
+  g_assert_cmpuint (skipped_frames, ==, 0);
+
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+}
+
+static void
+test_pyramid (Fixture *f,
+              gconstpointer test_data)
+{
+  SkeltrackSkeleton *skeleton;
+  SkeltrackJointList list, pyramid_list;
+  guint reduction, i, refined = 0;
+  guint16 *depth;
+  gsize count = WIDTH * HEIGHT * sizeof (guint16);
+
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+
+  depth = read_file_to_buffer ((gchar *) test_data, count, NULL);
+
+  list = skeltrack_skeleton_track_joints_full_sync (f->skeleton,
+                                                    depth,
+                                                    SKELTRACK_DEPTH_FORMAT_MM,
+                                                    WIDTH,
+                                                    HEIGHT,
+                                                    WIDTH * sizeof (guint16),
+                                                    NULL,
+                                                    NULL);
+
+  skeleton = skeltrack_skeleton_new ();
+  g_object_set (skeleton, "enable-pyramid", TRUE, NULL);
+  pyramid_list =
+    skeltrack_skeleton_track_joints_full_sync (skeleton,
+                                               depth,
+                                               SKELTRACK_DEPTH_FORMAT_MM,
+                                               WIDTH,
+                                               HEIGHT,
+                                               WIDTH * sizeof (guint16),
+                                               NULL,
+                                               NULL);
+
+  /* The refined joints stay within a cell of the buffer, and around
+     the same surface, of the ones tracked without the finer level */
+  g_assert (list != NULL && pyramid_list != NULL);
+  for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+    {
+      gint dx, dy, dz;
+
+      g_assert ((list[i] == NULL) == (pyramid_list[i] == NULL));
+      if (list[i] == NULL)
+        continue;
+
+      g_assert_cmpint (ABS (list[i]->screen_x - pyramid_list[i]->screen_x),
+                       <=,
+                       reduction);
+      g_assert_cmpint (ABS (list[i]->screen_y - pyramid_list[i]->screen_y),
+                       <=,
+                       reduction);
+
+      dx = list[i]->x - pyramid_list[i]->x;
+      dy = list[i]->y - pyramid_list[i]->y;
+      dz = list[i]->z - pyramid_list[i]->z;
+      /* The distance, rounded down, is inside the 50 mm sphere */
+      g_assert_cmpint (dx * dx + dy * dy + dz * dz, <=, 50 * 50 + 2 * 50);
+
+      if (pyramid_list[i]->screen_x % reduction != 0 ||
+          pyramid_list[i]->screen_y % reduction != 0)
+        {
+          refined++;
+        }
+    }
+
+  /* Some joints are found between the cells of the buffer */
+  g_assert_cmpuint (refined, >, 0);
+
+  g_slice_free1 (count, depth);
+  skeltrack_joint_list_free (list);
+  skeltrack_joint_list_free (pyramid_list);
+  g_object_unref (skeleton);
+}
+
+static void
+test_refine_hands (Fixture *f,
+                   gconstpointer test_data)
+{
+  SkeltrackJointList list;
+  SkeltrackJoint *hand;
+  guint reduction, width, height;
+  guint16 *depth, *full_depth;
+  gsize count = WIDTH * HEIGHT * sizeof (guint16);
+
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+
+  depth = reduce_depth_file (DEPTH_FILES[0],
+                             reduction,
+                             &width,
+                             &height);
+  full_depth = read_file_to_buffer (DEPTH_FILES[0], count, NULL);
+
+  list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                               depth,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+  g_assert (list != NULL);
+
+  skeltrack_skeleton_refine_hands (f->skeleton,
+                                   list,
+                                   full_depth,
+                                   WIDTH,
+                                   HEIGHT);
+
+  g_assert_cmpint (get_number_of_valid_joints (list),
+                   ==,
+                   7);
+
+  hand = skeltrack_joint_list_get_joint (list, SKELTRACK_JOINT_ID_LEFT_HAND);
+  g_assert_cmpint (hand->screen_x, <, WIDTH);
+  g_assert_cmpint (hand->screen_y, <, HEIGHT);
+  g_assert_cmpint (full_depth[hand->screen_y * WIDTH + hand->screen_x],
+                   ==,
+                   hand->z);
+
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+  g_slice_free1 (count, full_depth);
+  skeltrack_joint_list_free (list);
+}
+
+static void
+test_reduce_buffer (Fixture *f,
+                    gconstpointer test_data)
+{
+  guint16 buffer[16] = {   0, 1000,  600,  600,
+                        1200, 3000,  700,  900,
+                         800,    0,    0,    0,
+                           0,    0,    0,    0 };
+  guint16 reduced[4];
+  guint16 *depth, *full_depth, *reduced_depth;
+  guint reduction, width, height, i;
+  gsize count = WIDTH * HEIGHT * sizeof (guint16);
+
+  skeltrack_depth_reduce_buffer (buffer, 4, 4, 2, 500, 2000,
+                                 SKELTRACK_REDUCTION_MODE_POINT, reduced);
+  g_assert_cmpuint (reduced[0], ==, 0);
+  g_assert_cmpuint (reduced[1], ==, 600);
+  g_assert_cmpuint (reduced[2], ==, 800);
+  g_assert_cmpuint (reduced[3], ==, 0);
+
+  skeltrack_depth_reduce_buffer (buffer, 4, 4, 2, 500, 2000,
+                                 SKELTRACK_REDUCTION_MODE_MIN, reduced);
+  g_assert_cmpuint (reduced[0], ==, 1000);
+  g_assert_cmpuint (reduced[1], ==, 600);
+
+  skeltrack_depth_reduce_buffer (buffer, 4, 4, 2, 500, 2000,
+                                 SKELTRACK_REDUCTION_MODE_MEDIAN, reduced);
+  g_assert_cmpuint (reduced[0], ==, 1000);
+  g_assert_cmpuint (reduced[1], ==, 600);
+
+  skeltrack_depth_reduce_buffer (buffer, 4, 4, 2, 500, 2000,
+                                 SKELTRACK_REDUCTION_MODE_MEAN, reduced);
+  g_assert_cmpuint (reduced[0], ==, 1100);
+  g_assert_cmpuint (reduced[1], ==, 700);
+  g_assert_cmpuint (reduced[2], ==, 800);
+  g_assert_cmpuint (reduced[3], ==, 0);
+
+  /* Reducing by point with no thresholds is what reduce_depth_file does */
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+  depth = reduce_depth_file (DEPTH_FILES[0], reduction, &width, &height);
+  full_depth = read_file_to_buffer (DEPTH_FILES[0], count, NULL);
+  reduced_depth = g_slice_alloc (width * height * sizeof (guint16));
+
+  skeltrack_depth_reduce_buffer (full_depth, WIDTH, HEIGHT, reduction,
+                                 0, G_MAXUINT16,
+                                 SKELTRACK_REDUCTION_MODE_POINT,
+                                 reduced_depth);
+  for (i = 0; i < width * height; i++)
+    g_assert_cmpuint (reduced_depth[i], ==, depth[i]);
+
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+  g_slice_free1 (width * height * sizeof (guint16), reduced_depth);
+  g_slice_free1 (count, full_depth);
+}
+
+static void
+test_track_joints_full (Fixture *f,
+                        gconstpointer test_data)
+{
+  SkeltrackSkeleton *skeleton;
+  SkeltrackJointList list, full_list;
+  guint reduction, width, height;
+  guint16 *depth, *full_depth;
+  gsize count = WIDTH * HEIGHT * sizeof (guint16);
+
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+
+  depth = reduce_depth_file (DEPTH_FILES[0], reduction, &width, &height);
+  full_depth = read_file_to_buffer (DEPTH_FILES[0], count, NULL);
+
+  list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                               depth,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+
+  /* Reading the full buffer every dimension-reduction points
+     should be the same as tracking the reduced one */
+  skeleton = skeltrack_skeleton_new ();
+  full_list = skeltrack_skeleton_track_joints_full_sync (skeleton,
+                                                         full_depth,
+                                                         SKELTRACK_DEPTH_FORMAT_MM,
+                                                         WIDTH,
+                                                         HEIGHT,
+                                                         WIDTH * sizeof (guint16),
+                                                         NULL,
+                                                         NULL);
+  assert_joint_lists_equal (list, full_list);
+
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+  g_slice_free1 (count, full_depth);
+  skeltrack_joint_list_free (list);
+  skeltrack_joint_list_free (full_list);
+  g_object_unref (skeleton);
+}
+
+static SkeltrackJointList
+track_full_depth (gconstpointer buffer,
+                  SkeltrackDepthFormat format,
+                  guint rowstride)
+{
+  SkeltrackSkeleton *skeleton;
+  SkeltrackJointList list;
+
+  skeleton = skeltrack_skeleton_new ();
+  list = skeltrack_skeleton_track_joints_full_sync (skeleton,
+                                                    buffer,
+                                                    format,
+                                                    WIDTH,
+                                                    HEIGHT,
+                                                    rowstride,
+                                                    NULL,
+                                                    NULL);
+  g_object_unref (skeleton);
+
+  return list;
+}
+
+static void
+test_depth_formats (Fixture *f,
+                    gconstpointer test_data)
+{
+  SkeltrackJointList list, other_list;
+  guint16 *depth;
+  gfloat *metres;
+  guint8 *packed;
+  guint i, bit;
+  gsize count = WIDTH * HEIGHT * sizeof (guint16);
+  gsize packed_rowstride = WIDTH * 12 / 8;
+
+  depth = read_file_to_buffer (DEPTH_FILES[0], count, NULL);
+  metres = g_slice_alloc (WIDTH * HEIGHT * sizeof (gfloat));
+  packed = g_slice_alloc0 (packed_rowstride * HEIGHT);
+
+  for (i = 0; i < WIDTH * HEIGHT; i++)
+    {
+      /* Keep the depth representable in 12 bits */
+      if (depth[i] >= 1 << 12)
+        depth[i] = 0;
+
+      metres[i] = depth[i] / 1000.0;
+
+      for (bit = 0; bit < 12; bit++)
+        {
+          gsize packed_bit = (gsize) i * 12 + bit;
+
+          if (depth[i] & (1 << (11 - bit)))
+            packed[packed_bit / 8] |= 0x80 >> (packed_bit % 8);
+        }
+    }
+
+  list = track_full_depth (depth,
+                           SKELTRACK_DEPTH_FORMAT_MM,
+                           WIDTH * sizeof (guint16));
+
+  other_list = track_full_depth (metres,
+                                 SKELTRACK_DEPTH_FORMAT_FLOAT_METRES,
+                                 WIDTH * sizeof (gfloat));
+  assert_joint_lists_equal (list, other_list);
+  skeltrack_joint_list_free (other_list);
+
+  other_list = track_full_depth (packed,
+                                 SKELTRACK_DEPTH_FORMAT_PACKED_12BIT,
+                                 packed_rowstride);
+  assert_joint_lists_equal (list, other_list);
+  skeltrack_joint_list_free (other_list);
+
+  skeltrack_joint_list_free (list);
+  g_slice_free1 (count, depth);
+  g_slice_free1 (WIDTH * HEIGHT * sizeof (gfloat), metres);
+  g_slice_free1 (packed_rowstride * HEIGHT, packed);
+}
+
+static void
+test_camera_intrinsics (Fixture *f,
+                        gconstpointer test_data)
+{
+  SkeltrackSkeleton *skeleton;
+  SkeltrackCameraIntrinsics *intrinsics, *other_intrinsics;
+  SkeltrackJointList list, other_list;
+  guint reduction, width, height, i;
+  guint16 *depth;
+
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+  depth = reduce_depth_file (DEPTH_FILES[0], reduction, &width, &height);
+
+  list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                               depth,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+
+  /* The intrinsics equivalent to the default Kinect model */
+  intrinsics = skeltrack_camera_intrinsics_new (1 / (.0021 * 4 / 3),
+                                                1 / .0021,
+                                                WIDTH / 2,
+                                                HEIGHT / 2,
+                                                -10);
+  skeleton = skeltrack_skeleton_new ();
+  g_object_set (skeleton, "camera-intrinsics", intrinsics, NULL);
+  g_object_get (skeleton, "camera-intrinsics", &other_intrinsics, NULL);
+  g_assert (other_intrinsics != intrinsics);
+  g_assert_cmpfloat (other_intrinsics->focal_length_x,
+                     ==,
+                     intrinsics->focal_length_x);
+  skeltrack_camera_intrinsics_free (other_intrinsics);
+
+  other_list = skeltrack_skeleton_track_joints_sync (skeleton,
+                                                     depth,
+                                                     width,
+                                                     height,
+                                                     NULL,
+                                                     NULL);
+  g_assert (list != NULL && other_list != NULL);
+
+  for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+    {
+      g_assert ((list[i] == NULL) == (other_list[i] == NULL));
+      if (list[i] == NULL)
+        continue;
+
+      g_assert_cmpint (ABS (list[i]->x - other_list[i]->x), <=, 1);
+      g_assert_cmpint (ABS (list[i]->y - other_list[i]->y), <=, 1);
+    }
+
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+  skeltrack_camera_intrinsics_free (intrinsics);
+  skeltrack_joint_list_free (list);
+  skeltrack_joint_list_free (other_list);
+  g_object_unref (skeleton);
+}
+
+/* Makes single point holes inside the user, one every few points, and
+   adds a line of flying points, one point thick, going out of each
+   hand */
+static void
+add_depth_noise (guint16 *buffer,
+                 guint width,
+                 guint height,
+                 guint reduction,
+                 SkeltrackJointList joints)
+{
+  SkeltrackJointId hands[2] = {SKELTRACK_JOINT_ID_LEFT_HAND,
+                               SKELTRACK_JOINT_ID_RIGHT_HAND};
+  guint i, j, k;
+
+  for (j = 1; j < height - 1; j++)
+    {
+      for (i = 1; i < width - 1; i++)
+        {
+          if ((i + j * 3) % 7 != 0 ||
+              buffer[j * width + i - 1] == 0 ||
+              buffer[j * width + i + 1] == 0 ||
+              buffer[(j - 1) * width + i] == 0 ||
+              buffer[(j + 1) * width + i] == 0)
+            continue;
+
+          buffer[j * width + i] = 0;
+        }
+    }
+
+  for (k = 0; k < 2; k++)
+    {
+      SkeltrackJoint *hand = joints[hands[k]];
+      SkeltrackJoint *head = joints[SKELTRACK_JOINT_ID_HEAD];
+      gint side = hand->screen_x > head->screen_x ? 1 : -1;
+      gint length;
+
+      i = hand->screen_x / reduction;
+      j = hand->screen_y / reduction;
+      for (length = 1; length <= 6; length++)
+        {
+          gint point_i = i + side * length;
+
+          if (point_i < 0 || point_i >= (gint) width)
+            break;
+          buffer[j * width + point_i] = hand->z;
+        }
+    }
+}
+
+static SkeltrackJointList
+track_denoised_joints (guint16 *depth,
+                       guint width,
+                       guint height,
+                       gboolean denoise)
+{
+  SkeltrackSkeleton *skeleton;
+  SkeltrackJointList list;
+
+  skeleton = skeltrack_skeleton_new ();
+  g_object_set (skeleton,
+                "enable-median-filter", denoise,
+                "enable-hole-filling", denoise,
+                NULL);
+  list = skeltrack_skeleton_track_joints_sync (skeleton,
+                                               depth,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+  g_object_unref (skeleton);
+
+  return list;
+}
+
+static void
+test_denoise (Fixture *f,
+              gconstpointer test_data)
+{
+  SkeltrackJointList clean_list, noisy_list;
+  guint reduction, width, height, i;
+  guint16 *depth, *noisy_depth;
+
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+
+  depth = reduce_depth_file (DEPTH_FILES[0], reduction, &width, &height);
+  clean_list = track_denoised_joints (depth, width, height, FALSE);
+  g_assert (clean_list != NULL);
+
+  noisy_depth = g_slice_copy (width * height * sizeof (guint16), depth);
+  add_depth_noise (noisy_depth, width, height, reduction, clean_list);
+
+  /* Without the filters, the hands follow the flying points */
+  noisy_list = track_denoised_joints (noisy_depth, width, height, FALSE);
+  g_assert (noisy_list != NULL);
+  for (i = SKELTRACK_JOINT_ID_LEFT_HAND;
+       i <= SKELTRACK_JOINT_ID_RIGHT_HAND;
+       i++)
+    {
+      g_assert (noisy_list[i] != NULL);
+      g_assert_cmpint (ABS (clean_list[i]->screen_x -
+                            noisy_list[i]->screen_x), >, reduction);
+    }
+  skeltrack_joint_list_free (clean_list);
+  skeltrack_joint_list_free (noisy_list);
+
+  /* With them, the joints stay within a cell of the ones of the clean
+     buffer */
+  clean_list = track_denoised_joints (depth, width, height, TRUE);
+  noisy_list = track_denoised_joints (noisy_depth, width, height, TRUE);
+  g_assert (clean_list != NULL && noisy_list != NULL);
+  g_assert_cmpint (get_number_of_valid_joints (clean_list), ==, 7);
+  for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+    {
+      g_assert ((clean_list[i] == NULL) == (noisy_list[i] == NULL));
+      if (clean_list[i] == NULL)
+        continue;
+
+      g_assert_cmpint (ABS (clean_list[i]->screen_x -
+                            noisy_list[i]->screen_x), <=, reduction);
+      g_assert_cmpint (ABS (clean_list[i]->screen_y -
+                            noisy_list[i]->screen_y), <=, reduction);
+    }
+
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+  g_slice_free1 (width * height * sizeof (guint16), noisy_depth);
+  skeltrack_joint_list_free (clean_list);
+  skeltrack_joint_list_free (noisy_list);
+}
+
+static void
+test_background_subtraction (Fixture *f,
+                             gconstpointer test_data)
+{
+  SkeltrackJointList list;
+  guint reduction, width, height;
+  guint16 *depth;
+
+  g_object_set (f->skeleton,
+                "enable-background-subtraction", TRUE,
+                "background-learning-frames", 1,
+                "enable-smoothing", FALSE,
+                NULL);
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+
+  depth = reduce_depth_file (DEPTH_FILES[0], reduction, &width, &height);
+
+  /* Points are kept while the background is learned */
+  list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                               depth,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+  g_assert (list != NULL);
+  g_assert_cmpint (get_number_of_valid_joints (list), ==, 7);
+  skeltrack_joint_list_free (list);
+
+  /* The same frame is then all background */
+  list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                               depth,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+  g_assert (list == NULL);
+
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+}
+
+/* Draws a limb as the points closer than radius to a segment */
+static void
+draw_limb (guint16 *buffer,
+           gint x0,
+           gint y0,
+           gint x1,
+           gint y1,
+           gint radius,
+           guint16 depth)
+{
+  gint x, y;
+
+  for (y = 0; y < HEIGHT; y++)
+    {
+      for (x = 0; x < WIDTH; x++)
+        {
+          gdouble t, dx, dy;
+
+          t = ((x - x0) * (x1 - x0) + (y - y0) * (y1 - y0)) /
+            (gdouble) ((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0));
+          t = CLAMP (t, 0, 1);
+          dx = x - (x0 + t * (x1 - x0));
+          dy = y - (y0 + t * (y1 - y0));
+          if (dx * dx + dy * dy <= radius * radius)
+            buffer[y * WIDTH + x] = depth;
+        }
+    }
+}
+
+/* Draws a user with the legs apart, centered on the column x */
+static void
+draw_user (guint16 *buffer, gint x, guint16 depth)
+{
+  draw_limb (buffer, x, 50, x, 60, 28, depth);
+  draw_limb (buffer, x, 110, x, 240, 45, depth);
+  draw_limb (buffer, x - 40, 100, x - 120, 200, 12, depth);
+  draw_limb (buffer, x + 40, 100, x + 120, 200, 12, depth);
+  draw_limb (buffer, x - 25, 250, x - 50, 450, 16, depth);
+  draw_limb (buffer, x + 25, 250, x + 50, 450, 16, depth);
+}
+
+/* Draws the floor the feet of a user at the given depth stand on, at
+   the row y, as seen by a camera looking parallel to it */
+static void
+draw_floor (guint16 *buffer, gint y, guint16 depth)
+{
+  gint i, j;
+
+  for (j = HEIGHT / 2 + 1; j < HEIGHT; j++)
+    {
+      guint floor_depth = depth * (y - HEIGHT / 2) / (j - HEIGHT / 2);
+
+      if (floor_depth > 6000)
+        continue;
+
+      for (i = 0; i < WIDTH; i++)
+        {
+          if (buffer[j * WIDTH + i] == 0)
+            buffer[j * WIDTH + i] = floor_depth;
+        }
+    }
+}
+
+/* Tracks the user drawn by draw_user() at 2500 mm, standing on a floor
+   if requested. The user is flat, so only the dominant plane is
+   removed. */
+static SkeltrackJointList
+track_user_on_floor (gboolean floor, gboolean remove_planes)
+{
+  SkeltrackSkeleton *skeleton;
+  SkeltrackJointList list;
+  guint16 *depth, *reduced;
+  guint reduction = 8;
+  guint width, height;
+
+  depth = g_slice_alloc0 (WIDTH * HEIGHT * sizeof (guint16));
+  draw_user (depth, 320, 2500);
+  if (floor)
+    draw_floor (depth, 450 + 16, 2500);
+
+  width = WIDTH / reduction;
+  height = HEIGHT / reduction;
+  reduced = g_slice_alloc (width * height * sizeof (guint16));
+  skeltrack_depth_reduce_buffer (depth,
+                                 WIDTH,
+                                 HEIGHT,
+                                 reduction,
+                                 0,
+                                 G_MAXUINT16,
+                                 SKELTRACK_REDUCTION_MODE_POINT,
+                                 reduced);
+
+  skeleton = skeltrack_skeleton_new ();
+  g_object_set (skeleton,
+                "dimension-reduction", reduction,
+                "joint-mask", SKELTRACK_JOINT_MASK_ALL,
+                "enable-plane-removal", remove_planes,
+                "plane-removal-max-planes", 1,
+                NULL);
+  list = skeltrack_skeleton_track_joints_sync (skeleton,
+                                               reduced,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+
+  g_slice_free1 (WIDTH * HEIGHT * sizeof (guint16), depth);
+  g_slice_free1 (width * height * sizeof (guint16), reduced);
+  g_object_unref (skeleton);
+
+  return list;
+}
+
+static void
+test_plane_removal (Fixture *f,
+                    gconstpointer test_data)
+{
+  SkeltrackSkeleton *skeleton;
+  SkeltrackJointList list, wall_list, floor_list;
+  guint reduction, width, height, i;
+  guint16 *depth, *wall_depth;
+
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+
+  depth = reduce_depth_file (DEPTH_FILES[0], reduction, &width, &height);
+  list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                               depth,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+
+  /* Put a wall behind the user */
+  wall_depth = reduce_depth_file (DEPTH_FILES[0], reduction, &width, &height);
+  for (i = 0; i < width * height; i++)
+    {
+      if (wall_depth[i] == 0)
+        wall_depth[i] = 3000;
+    }
+
+  skeleton = skeltrack_skeleton_new ();
+  g_object_set (skeleton, "enable-plane-removal", TRUE, NULL);
+  wall_list = skeltrack_skeleton_track_joints_sync (skeleton,
+                                                    wall_depth,
+                                                    width,
+                                                    height,
+                                                    NULL,
+                                                    NULL);
+
+  assert_joint_lists_equal (list, wall_list);
+
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+  g_slice_free1 (width * height * sizeof (guint16), wall_depth);
+  skeltrack_joint_list_free (list);
+  skeltrack_joint_list_free (wall_list);
+  g_object_unref (skeleton);
+
+  /* The feet of a user standing on the floor are joined to it, so the
+     joints are only found, within a cell of 8 points of the ones
+     without the floor, once it is removed */
+  list = track_user_on_floor (FALSE, FALSE);
+  floor_list = track_user_on_floor (TRUE, TRUE);
+  g_assert (list != NULL && floor_list != NULL);
+  for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+    {
+      g_assert (list[i] != NULL && floor_list[i] != NULL);
+      g_assert_cmpint (ABS (list[i]->screen_x - floor_list[i]->screen_x),
+                       <=,
+                       8);
+      g_assert_cmpint (ABS (list[i]->screen_y - floor_list[i]->screen_y),
+                       <=,
+                       8);
+    }
+
+  skeltrack_joint_list_free (list);
+  skeltrack_joint_list_free (floor_list);
+}
+
+/* Tracks the user drawn by draw_user() at 2000 mm in front of a wall
+   at the given depth, or 0 for no wall */
+static SkeltrackJointList
+track_user_before_wall (SkeltrackSkeleton *skeleton, guint16 wall_depth)
+{
+  SkeltrackJointList list;
+  guint16 *depth, *reduced;
+  guint reduction, width, height, i;
+
+  g_object_get (skeleton, "dimension-reduction", &reduction, NULL);
+
+  depth = g_slice_alloc0 (WIDTH * HEIGHT * sizeof (guint16));
+  draw_user (depth, 320, 2000);
+  for (i = 0; i < WIDTH * HEIGHT; i++)
+    {
+      if (depth[i] == 0)
+        depth[i] = wall_depth;
+    }
+
+  width = WIDTH / reduction;
+  height = HEIGHT / reduction;
+  reduced = g_slice_alloc (width * height * sizeof (guint16));
+  skeltrack_depth_reduce_buffer (depth,
+                                 WIDTH,
+                                 HEIGHT,
+                                 reduction,
+                                 0,
+                                 G_MAXUINT16,
+                                 SKELTRACK_REDUCTION_MODE_POINT,
+                                 reduced);
+
+  list = skeltrack_skeleton_track_joints_sync (skeleton,
+                                               reduced,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+
+  g_slice_free1 (WIDTH * HEIGHT * sizeof (guint16), depth);
+  g_slice_free1 (width * height * sizeof (guint16), reduced);
+
+  return list;
+}
+
+static void
+test_depth_gating (Fixture *f,
+                   gconstpointer test_data)
+{
+  SkeltrackSkeleton *skeleton;
+  SkeltrackJointList list, gated_list;
+
+  skeleton = skeltrack_skeleton_new ();
+  g_object_set (skeleton, "dimension-reduction", 8, NULL);
+  list = track_user_before_wall (skeleton, 0);
+  g_object_unref (skeleton);
+
+  /* The wall is close enough to the user to be joined to it in the
+     graph, so the joints are only the same once it is gated */
+  skeleton = skeltrack_skeleton_new ();
+  g_object_set (skeleton,
+                "dimension-reduction", 8,
+                "graph-distance-threshold", 400,
+                "enable-depth-gating", TRUE,
+                NULL);
+  gated_list = track_user_before_wall (skeleton, 2300);
+  assert_joint_lists_equal (list, gated_list);
+
+  /* The user is still found once the band follows the previous head */
+  skeltrack_joint_list_free (gated_list);
+  gated_list = track_user_before_wall (skeleton, 2300);
+  assert_joint_lists_equal (list, gated_list);
+
+  skeltrack_joint_list_free (list);
+  skeltrack_joint_list_free (gated_list);
+  g_object_unref (skeleton);
+}
+
+static void
+test_track_joints_points (Fixture *f,
+                          gconstpointer test_data)
+{
+  SkeltrackSkeleton *skeleton;
+  SkeltrackJointList list, points_list;
+  SkeltrackDepthPoint *points;
+  guint reduction, width, height, i, j, phase, nr_points;
+  guint16 *depth, *full_depth;
+  gsize count = WIDTH * HEIGHT * sizeof (guint16);
+
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+
+  depth = reduce_depth_file (DEPTH_FILES[0], reduction, &width, &height);
+  full_depth = read_file_to_buffer (DEPTH_FILES[0], count, NULL);
+
+  list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                               depth,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+
+  /* Only the valid points a reduction reads, in reverse order so they
+     need sorting, and then the same points moved inside their cells
+     as if the detector giving them sampled another grid */
+  points = g_slice_alloc (WIDTH * HEIGHT * sizeof (SkeltrackDepthPoint));
+  for (phase = 0; phase < reduction; phase += reduction / 2)
+    {
+      nr_points = 0;
+      for (j = HEIGHT; j > 0; j -= reduction)
+        {
+          for (i = WIDTH; i > 0; i -= reduction)
+            {
+              guint16 value;
+
+              value = full_depth[(j - reduction) * WIDTH + i - reduction];
+              if (value == 0)
+                continue;
+
+              points[nr_points].i = i - reduction + phase;
+              points[nr_points].j = j - reduction + phase;
+              points[nr_points].z = value;
+              nr_points++;
+            }
+        }
+
+      skeleton = skeltrack_skeleton_new ();
+      points_list =
+        skeltrack_skeleton_track_joints_points_sync (skeleton,
+                                                     points,
+                                                     nr_points,
+                                                     WIDTH,
+                                                     HEIGHT,
+                                                     NULL,
+                                                     NULL);
+      assert_joint_lists_equal (list, points_list);
+      skeltrack_joint_list_free (points_list);
+      g_object_unref (skeleton);
+    }
+
+  g_slice_free1 (WIDTH * HEIGHT * sizeof (SkeltrackDepthPoint), points);
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+  g_slice_free1 (count, full_depth);
+  skeltrack_joint_list_free (list);
+}
+
+static void
+test_adaptive_graph (Fixture *f,
+                     gconstpointer test_data)
+{
+  SkeltrackSkeleton *skeleton;
+  SkeltrackJointList list, adaptive_list;
+  guint reduction, width, height, i, nodes, adaptive_nodes;
+  guint16 *depth;
+
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+
+  depth = reduce_depth_file (DEPTH_FILES[0], reduction, &width, &height);
+  list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                               depth,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+  g_object_get (f->skeleton, "graph-nodes", &nodes, NULL);
+
+  skeleton = skeltrack_skeleton_new ();
+  g_object_set (skeleton, "enable-adaptive-graph", TRUE, NULL);
+  adaptive_list = skeltrack_skeleton_track_joints_sync (skeleton,
+                                                        depth,
+                                                        width,
+                                                        height,
+                                                        NULL,
+                                                        NULL);
+  g_object_get (skeleton, "graph-nodes", &adaptive_nodes, NULL);
+
+  /* Merging the torso should leave at most half of the nodes */
+  g_assert_cmpuint (adaptive_nodes, >, 0);
+  g_assert_cmpuint (2 * adaptive_nodes, <=, nodes);
+
+  /* and barely move the joints */
+  g_assert (adaptive_list != NULL);
+  g_assert_cmpint (get_number_of_valid_joints (adaptive_list), ==,
+                   get_number_of_valid_joints (list));
+  for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+    {
+      if (list[i] == NULL || adaptive_list[i] == NULL)
+        continue;
+
+      g_assert_cmpint (ABS (list[i]->screen_x - adaptive_list[i]->screen_x),
+                       <=, 2 * reduction);
+      g_assert_cmpint (ABS (list[i]->screen_y - adaptive_list[i]->screen_y),
+                       <=, 2 * reduction);
+    }
+
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+  skeltrack_joint_list_free (list);
+  skeltrack_joint_list_free (adaptive_list);
+  g_object_unref (skeleton);
+}
+
+static void
+test_joint_mask (Fixture *f,
+                 gconstpointer test_data)
+{
+  SkeltrackSkeleton *skeleton;
+  SkeltrackJointList list, masked_list;
+  guint reduction, width, height, i;
+  guint16 *depth;
+
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+
+  depth = reduce_depth_file (DEPTH_FILES[0], reduction, &width, &height);
+  list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                               depth,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+  g_assert (list != NULL);
+
+  skeleton = skeltrack_skeleton_new ();
+  g_object_set (skeleton,
+                "joint-mask", SKELTRACK_JOINT_MASK_HEAD_AND_HANDS,
+                NULL);
+  masked_list = skeltrack_skeleton_track_joints_sync (skeleton,
+                                                      depth,
+                                                      width,
+                                                      height,
+                                                      NULL,
+                                                      NULL);
+
+  /* The requested joints are the same as when tracking all of them */
+  g_assert (masked_list != NULL);
+  for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+    {
+      if ((SKELTRACK_JOINT_MASK_HEAD_AND_HANDS & (1 << i)) == 0)
+        {
+          g_assert (masked_list[i] == NULL);
+          continue;
+        }
+
+      g_assert ((list[i] == NULL) == (masked_list[i] == NULL));
+      if (list[i] == NULL)
+        continue;
+
+      g_assert_cmpint (list[i]->screen_x, ==, masked_list[i]->screen_x);
+      g_assert_cmpint (list[i]->screen_y, ==, masked_list[i]->screen_y);
+      g_assert_cmpint (list[i]->z, ==, masked_list[i]->z);
+    }
+
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+  skeltrack_joint_list_free (list);
+  skeltrack_joint_list_free (masked_list);
+  g_object_unref (skeleton);
+}
+
+static void
+test_lower_body (Fixture *f,
+                 gconstpointer test_data)
+{
+  SkeltrackSkeleton *skeleton;
+  SkeltrackJointList list;
+  SkeltrackJoint *hip, *knee, *foot;
+  guint16 *depth, *reduced;
+  guint reduction = 8;
+  guint width, height;
+  /* The bottom of the torso, where the legs split */
+  gint crotch_y = 240 + 45;
+
+  /* A whole user standing with the legs apart */
+  depth = g_slice_alloc0 (WIDTH * HEIGHT * sizeof (guint16));
+  draw_limb (depth, 320, 50, 320, 60, 28, 2500);
+  draw_limb (depth, 320, 110, 320, 240, 45, 2500);
+  draw_limb (depth, 280, 100, 190, 210, 12, 2500);
+  draw_limb (depth, 360, 100, 450, 210, 12, 2500);
+  draw_limb (depth, 295, 250, 255, 450, 16, 2500);
+  draw_limb (depth, 345, 250, 385, 450, 16, 2500);
+
+  width = WIDTH / reduction;
+  height = HEIGHT / reduction;
+  reduced = g_slice_alloc (width * height * sizeof (guint16));
+  skeltrack_depth_reduce_buffer (depth,
+                                 WIDTH,
+                                 HEIGHT,
+                                 reduction,
+                                 0,
+                                 G_MAXUINT16,
+                                 SKELTRACK_REDUCTION_MODE_POINT,
+                                 reduced);
+
+  /* The lower body is not tracked by default */
+  g_object_set (f->skeleton, "dimension-reduction", reduction, NULL);
+  list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                               reduced,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+  g_assert (list != NULL);
+  g_assert (list[SKELTRACK_JOINT_ID_LEFT_FOOT] == NULL);
+  g_assert (list[SKELTRACK_JOINT_ID_RIGHT_FOOT] == NULL);
+  skeltrack_joint_list_free (list);
+
+  skeleton = skeltrack_skeleton_new ();
+  g_object_set (skeleton,
+                "dimension-reduction", reduction,
+                "joint-mask", SKELTRACK_JOINT_MASK_ALL,
+                NULL);
+  list = skeltrack_skeleton_track_joints_sync (skeleton,
+                                               reduced,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+  g_assert (list != NULL);
+  g_assert (list[SKELTRACK_JOINT_ID_TORSO] != NULL);
+
+  /* The feet are at the ends of the legs, and each leg goes down
+     from the hip, which is above the crotch, to the foot */
+  hip = list[SKELTRACK_JOINT_ID_LEFT_HIP];
+  knee = list[SKELTRACK_JOINT_ID_LEFT_KNEE];
+  foot = list[SKELTRACK_JOINT_ID_LEFT_FOOT];
+  g_assert (hip != NULL && knee != NULL && foot != NULL);
+  g_assert_cmpint (ABS (foot->screen_x - 385), <=, 2 * reduction);
+  g_assert_cmpint (ABS (foot->screen_y - 466), <=, 2 * reduction);
+  g_assert_cmpint (hip->screen_y, <, knee->screen_y);
+  g_assert_cmpint (knee->screen_y, <, foot->screen_y);
+  g_assert_cmpint (hip->screen_x, >, 320);
+  g_assert_cmpint (hip->screen_y, <, crotch_y);
+  g_assert_cmpint (hip->screen_y, >, list[SKELTRACK_JOINT_ID_TORSO]->screen_y);
+
+  hip = list[SKELTRACK_JOINT_ID_RIGHT_HIP];
+  knee = list[SKELTRACK_JOINT_ID_RIGHT_KNEE];
+  foot = list[SKELTRACK_JOINT_ID_RIGHT_FOOT];
+  g_assert (hip != NULL && knee != NULL && foot != NULL);
+  g_assert_cmpint (ABS (foot->screen_x - 255), <=, 2 * reduction);
+  g_assert_cmpint (ABS (foot->screen_y - 466), <=, 2 * reduction);
+  g_assert_cmpint (hip->screen_y, <, knee->screen_y);
+  g_assert_cmpint (knee->screen_y, <, foot->screen_y);
+  g_assert_cmpint (hip->screen_x, <, 320);
+  g_assert_cmpint (hip->screen_y, <, crotch_y);
+  g_assert_cmpint (hip->screen_y, >, list[SKELTRACK_JOINT_ID_TORSO]->screen_y);
+
+  g_slice_free1 (WIDTH * HEIGHT * sizeof (guint16), depth);
+  g_slice_free1 (width * height * sizeof (guint16), reduced);
+  skeltrack_joint_list_free (list);
+  g_object_unref (skeleton);
+}
+
+/* Tracks the users in the full resolution buffer, which is freed */
+static GPtrArray *
+track_users_in_depth (SkeltrackSkeleton *skeleton, guint16 *depth)
+{
+  GPtrArray *users;
+  guint16 *reduced;
+  guint reduction, width, height;
+
+  g_object_get (skeleton, "dimension-reduction", &reduction, NULL);
+
+  width = WIDTH / reduction;
+  height = HEIGHT / reduction;
+  reduced = g_slice_alloc (width * height * sizeof (guint16));
+  skeltrack_depth_reduce_buffer (depth,
+                                 WIDTH,
+                                 HEIGHT,
+                                 reduction,
+                                 0,
+                                 G_MAXUINT16,
+                                 SKELTRACK_REDUCTION_MODE_POINT,
+                                 reduced);
+
+  users = skeltrack_skeleton_track_users_sync (skeleton,
+                                               reduced,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+
+  g_slice_free1 (WIDTH * HEIGHT * sizeof (guint16), depth);
+  g_slice_free1 (width * height * sizeof (guint16), reduced);
+
+  return users;
+}
+
+static GPtrArray *
+track_users (SkeltrackSkeleton *skeleton,
+             gint first_x,
+             guint16 first_depth,
+             gint second_x,
+             guint16 second_depth)
+{
+  guint16 *depth;
+
+  depth = g_slice_alloc0 (WIDTH * HEIGHT * sizeof (guint16));
+  if (first_x >= 0)
+    draw_user (depth, first_x, first_depth);
+  if (second_x >= 0)
+    draw_user (depth, second_x, second_depth);
+
+  return track_users_in_depth (skeleton, depth);
+}
+
+static void
+test_track_users (Fixture *f,
+                  gconstpointer test_data)
+{
+  GPtrArray *users;
+  SkeltrackJointList first, second;
+  guint reduction = 8;
+  gint frame;
+
+  g_object_set (f->skeleton,
+                "dimension-reduction", reduction,
+                "enable-smoothing", FALSE,
+                NULL);
+
+  /* The users keep their ids while they move, even when the second
+     one gets closer than the first one */
+  for (frame = 0; frame < 3; frame++)
+    {
+      gint first_x = 160 + frame * reduction;
+      gint second_x = 480 - frame * reduction;
+
+      users = track_users (f->skeleton,
+                           first_x,
+                           2000 + frame * 150,
+                           second_x,
+                           2600 - frame * 300);
+      g_assert (users != NULL);
+      g_assert_cmpuint (users->len, ==, 2);
+
+      first = g_ptr_array_index (users, 0);
+      second = g_ptr_array_index (users, 1);
+      g_assert (first != NULL && first[SKELTRACK_JOINT_ID_HEAD] != NULL);
+      g_assert (second != NULL && second[SKELTRACK_JOINT_ID_HEAD] != NULL);
+      g_assert_cmpint (ABS (first[SKELTRACK_JOINT_ID_HEAD]->screen_x -
+                            first_x), <=, 2 * reduction);
+      g_assert_cmpint (ABS (second[SKELTRACK_JOINT_ID_HEAD]->screen_x -
+                            second_x), <=, 2 * reduction);
+
+      g_ptr_array_unref (users);
+    }
+
+  /* Without smoothing, a user is not given once it is missing */
+  users = track_users (f->skeleton, -1, 0, 480 - frame * reduction, 1700);
+  g_assert (g_ptr_array_index (users, 0) == NULL);
+  g_assert (g_ptr_array_index (users, 1) != NULL);
+  g_ptr_array_unref (users);
+}
+
+/* The shoulders of a user are looked for in the user's own nodes,
+   so they are not found on another user standing next to them */
+static void
+test_track_close_users (Fixture *f,
+                        gconstpointer test_data)
+{
+  guint reduction = 8;
+  gint far_x;
+
+  g_object_set (f->skeleton,
+                "dimension-reduction", reduction,
+                "enable-smoothing", FALSE,
+                NULL);
+
+  for (far_x = 120; far_x <= 260; far_x += 20)
+    {
+      GPtrArray *users;
+      gboolean found_near = FALSE;
+      guint k;
+
+      users = track_users (f->skeleton, far_x, 2600, 320, 2000);
+      g_assert (users != NULL);
+
+      for (k = 0; k < users->len; k++)
+        {
+          SkeltrackJointList joints = g_ptr_array_index (users, k);
+          SkeltrackJoint *head, *shoulder;
+
+          if (joints == NULL || joints[SKELTRACK_JOINT_ID_HEAD] == NULL)
+            continue;
+
+          head = joints[SKELTRACK_JOINT_ID_HEAD];
+          g_assert_cmpint (head->screen_y, <=, 60 + 2 * reduction);
+          if (head->z < 2300)
+            {
+              g_assert_cmpint (ABS (head->screen_x - 320), <=, 2 * reduction);
+              found_near = TRUE;
+            }
+
+          shoulder = joints[SKELTRACK_JOINT_ID_LEFT_SHOULDER];
+          if (shoulder != NULL)
+            {
+              g_assert_cmpint (shoulder->screen_x, >, head->screen_x);
+              g_assert_cmpint (ABS (shoulder->z - head->z), <, 300);
+            }
+
+          shoulder = joints[SKELTRACK_JOINT_ID_RIGHT_SHOULDER];
+          if (shoulder != NULL)
+            {
+              g_assert_cmpint (shoulder->screen_x, <, head->screen_x);
+              g_assert_cmpint (ABS (shoulder->z - head->z), <, 300);
+            }
+        }
+
+      g_assert (found_near);
+      g_ptr_array_unref (users);
+    }
+}
+
+/* A component of neither user is joined to the one it is closest to,
+   not to the first one, closest to the focus node, that reaches it */
+static void
+test_track_users_stray_component (Fixture *f,
+                                  gconstpointer test_data)
+{
+  GPtrArray *users;
+  guint16 *depth;
+  guint reduction = 8;
+  guint k;
+
+  g_object_set (f->skeleton,
+                "dimension-reduction", reduction,
+                "graph-distance-threshold", 300,
+                "enable-smoothing", FALSE,
+                NULL);
+
+  /* The stray component is past the hand of the farther user */
+  depth = g_slice_alloc0 (WIDTH * HEIGHT * sizeof (guint16));
+  draw_user (depth, 140, 1900);
+  draw_user (depth, 480, 2000);
+  draw_limb (depth, 314, 200, 326, 200, 10, 1950);
+
+  users = track_users_in_depth (f->skeleton, depth);
+  g_assert (users != NULL);
+
+  for (k = 0; k < users->len; k++)
+    {
+      SkeltrackJointList joints = g_ptr_array_index (users, k);
+      guint i;
+
+      g_assert (joints != NULL && joints[SKELTRACK_JOINT_ID_HEAD] != NULL);
+      if (joints[SKELTRACK_JOINT_ID_HEAD]->screen_x > 320)
+        continue;
+
+      /* The user closer to the focus node does not take it */
+      for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+        {
+          if (joints[i] != NULL)
+            g_assert_cmpint (joints[i]->screen_x, <, 320 - 2 * reduction);
+        }
+    }
+
+  g_ptr_array_unref (users);
+}
+
+static void
+test_joint_confidence (Fixture *f,
+                       gconstpointer test_data)
+{
+  SkeltrackJointList first, second;
+  guint reduction, width, height, i;
+  guint16 *depth;
+
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+
+  depth = reduce_depth_file (DEPTH_FILES[0], reduction, &width, &height);
+  first = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                                depth,
+                                                width,
+                                                height,
+                                                NULL,
+                                                NULL);
+  g_assert (first != NULL);
+
+  for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+    {
+      if (first[i] == NULL)
+        continue;
+
+      g_assert_cmpfloat (first[i]->confidence, >=, 0);
+      g_assert_cmpfloat (first[i]->confidence, <=, 1);
+    }
+
+  /* The head found again next to the previous one is at least as
+     reliable as the one found from the shoulders */
+  second = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                                 depth,
+                                                 width,
+                                                 height,
+                                                 NULL,
+                                                 NULL);
+  g_assert (second != NULL);
+  g_assert (first[SKELTRACK_JOINT_ID_HEAD] != NULL);
+  g_assert (second[SKELTRACK_JOINT_ID_HEAD] != NULL);
+  g_assert_cmpfloat (second[SKELTRACK_JOINT_ID_HEAD]->confidence, >=,
+                     first[SKELTRACK_JOINT_ID_HEAD]->confidence);
+
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+  skeltrack_joint_list_free (first);
+  skeltrack_joint_list_free (second);
+}
+
+static void
+test_temporal_arm_assignment (Fixture *f,
+                              gconstpointer test_data)
+{
+  SkeltrackSkeleton *skeleton;
+  SkeltrackJointList list, temporal_list;
+  guint reduction, width, height, i;
+  guint16 *depth;
+  gint frame;
+
+  skeleton = skeltrack_skeleton_new ();
+  g_object_set (skeleton,
+                "enable-temporal-arm-assignment", TRUE,
+                NULL);
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+
+  depth = reduce_depth_file (DEPTH_FILES[0], reduction, &width, &height);
+
+  /* The arms found from the previous assignment are the same as the
+     ones found comparing the paths from both shoulders */
+  for (frame = 0; frame < 3; frame++)
+    {
+      list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                                   depth,
+                                                   width,
+                                                   height,
+                                                   NULL,
+                                                   NULL);
+      temporal_list = skeltrack_skeleton_track_joints_sync (skeleton,
+                                                            depth,
+                                                            width,
+                                                            height,
+                                                            NULL,
+                                                            NULL);
+      g_assert (list != NULL);
+      g_assert (temporal_list != NULL);
+
+      for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+        {
+          g_assert ((list[i] == NULL) == (temporal_list[i] == NULL));
+          if (list[i] == NULL)
+            continue;
+
+          g_assert_cmpint (list[i]->screen_x, ==, temporal_list[i]->screen_x);
+          g_assert_cmpint (list[i]->screen_y, ==, temporal_list[i]->screen_y);
+          g_assert_cmpint (list[i]->z, ==, temporal_list[i]->z);
+        }
+
+      skeltrack_joint_list_free (list);
+      skeltrack_joint_list_free (temporal_list);
+    }
+
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+  g_object_unref (skeleton);
+}
+
+static void
+test_prediction (Fixture *f,
+                 gconstpointer test_data)
+{
+  SkeltrackJointList list, previous_list = NULL;
+  guint reduction, width, height, predicted_frames, i;
+  guint16 *depth;
+  gint frame;
+
+  g_object_set (f->skeleton,
+                "enable-prediction", TRUE,
+                "prediction-interval", 2,
+                NULL);
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+
+  depth = reduce_depth_file (DEPTH_FILES[0], reduction, &width, &height);
+
+  /* The trend is only known after the second buffer, then every other
+     buffer is predicted and, as the user does not move, its joints are
+     the ones of the buffer before */
+  for (frame = 0; frame < 6; frame++)
+    {
+      list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                                   depth,
+                                                   width,
+                                                   height,
+                                                   NULL,
+                                                   NULL);
+      g_assert (list != NULL);
+      g_object_get (f->skeleton, "predicted-frames", &predicted_frames, NULL);
+      g_assert_cmpuint (predicted_frames, ==, frame / 2);
+
+      if (frame == 2 || frame == 4)
+        {
+          for (i = 0; i < SKELTRACK_JOINT_MAX_JOINTS; i++)
+            {
+              g_assert ((list[i] == NULL) == (previous_list[i] == NULL));
+              if (list[i] == NULL)
+                continue;
+
+              g_assert_cmpint (list[i]->screen_x, ==,
+                               previous_list[i]->screen_x);
+              g_assert_cmpint (list[i]->screen_y, ==,
+                               previous_list[i]->screen_y);
+              g_assert_cmpint (list[i]->z, ==, previous_list[i]->z);
+            }
+        }
+
+      skeltrack_joint_list_free (previous_list);
+      previous_list = list;
+    }
+
+  skeltrack_joint_list_free (previous_list);
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+}
+
+static guint16 *
+reduce_user_buffer (gint x, guint reduction, guint *width, guint *height)
+{
+  guint16 *depth, *reduced;
+
+  depth = g_slice_alloc0 (WIDTH * HEIGHT * sizeof (guint16));
+  if (x >= 0)
+    draw_user (depth, x, 2000);
+
+  *width = WIDTH / reduction;
+  *height = HEIGHT / reduction;
+  reduced = g_slice_alloc (*width * *height * sizeof (guint16));
+  skeltrack_depth_reduce_buffer (depth,
+                                 WIDTH,
+                                 HEIGHT,
+                                 reduction,
+                                 0,
+                                 G_MAXUINT16,
+                                 SKELTRACK_REDUCTION_MODE_POINT,
+                                 reduced);
+
+  g_slice_free1 (WIDTH * HEIGHT * sizeof (guint16), depth);
+  return reduced;
+}
+
+static void
+assert_region_of_interest_tracking (SkeltrackSkeleton *full,
+                                    SkeltrackSkeleton *windowed,
+                                    guint16 *depth,
+                                    guint width,
+                                    guint height)
+{
+  SkeltrackJointList list, windowed_list;
+
+  list = skeltrack_skeleton_track_joints_sync (full,
+                                               depth,
+                                               width,
+                                               height,
+                                               NULL,
+                                               NULL);
+  windowed_list = skeltrack_skeleton_track_joints_sync (windowed,
+                                                        depth,
+                                                        width,
+                                                        height,
+                                                        NULL,
+                                                        NULL);
+  if (list == NULL)
+    g_assert (windowed_list == NULL);
+  else
+    assert_joint_lists_equal (list, windowed_list);
+
+  skeltrack_joint_list_free (list);
+  skeltrack_joint_list_free (windowed_list);
+}
+
+static void
+test_region_of_interest (Fixture *f,
+                         gconstpointer test_data)
+{
+  SkeltrackSkeleton *windowed;
+  guint reduction, width, height, i;
+  guint16 *depth;
+  gint x;
+
+  windowed = skeltrack_skeleton_new ();
+  g_object_set (windowed,
+                "enable-region-of-interest", TRUE,
+                "enable-smoothing", FALSE,
+                NULL);
+  g_object_set (f->skeleton, "enable-smoothing", FALSE, NULL);
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+
+  /* Each file is tracked twice so the window is used both when the
+     user stays inside it and when the next file moves them away */
+  for (i = 0; i < NUMBER_OF_FILES * 2; i++)
+    {
+      depth = reduce_depth_file (DEPTH_FILES[i / 2],
+                                 reduction,
+                                 &width,
+                                 &height);
+      assert_region_of_interest_tracking (f->skeleton,
+                                          windowed,
+                                          depth,
+                                          width,
+                                          height);
+      g_slice_free1 (width * height * sizeof (guint16), depth);
+    }
+
+  /* The user walks across the scene, so the joints found in the
+     window end up touching its border or outside of it, and the
+     whole buffer has to be tracked instead */
+  for (x = 160; x <= 480; x += 40)
+    {
+      depth = reduce_user_buffer (x, reduction, &width, &height);
+      assert_region_of_interest_tracking (f->skeleton,
+                                          windowed,
+                                          depth,
+                                          width,
+                                          height);
+      g_slice_free1 (width * height * sizeof (guint16), depth);
+    }
+
+  /* The user is lost and then found away from the last window */
+  depth = reduce_user_buffer (-1, reduction, &width, &height);
+  assert_region_of_interest_tracking (f->skeleton,
+                                      windowed,
+                                      depth,
+                                      width,
+                                      height);
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+
+  depth = reduce_user_buffer (160, reduction, &width, &height);
+  assert_region_of_interest_tracking (f->skeleton,
+                                      windowed,
+                                      depth,
+                                      width,
+                                      height);
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+
+  g_object_unref (windowed);
+}
+
+static void
+test_incremental_graph_tiles (Fixture *f,
+                              gconstpointer test_data)
+{
+  SkeltrackSkeleton *incremental;
+  guint reduction, width, height;
+  gint x;
+
+  incremental = skeltrack_skeleton_new ();
+  g_object_set (incremental,
+                "enable-incremental-graph", TRUE,
+                "enable-smoothing", FALSE,
+                NULL);
+  g_object_set (f->skeleton, "enable-smoothing", FALSE, NULL);
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+
+  /* The user moves a little on every frame so only the tiles around
+     them change */
+  for (x = 200; x <= 360; x += 16)
+    {
+      SkeltrackJointList list, incremental_list;
+      guint16 *depth;
+
+      depth = reduce_user_buffer (x, reduction, &width, &height);
+
+      list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                                   depth,
+                                                   width,
+                                                   height,
+                                                   NULL,
+                                                   NULL);
+      incremental_list = skeltrack_skeleton_track_joints_sync (incremental,
+                                                               depth,
+                                                               width,
+                                                               height,
+                                                               NULL,
+                                                               NULL);
+      assert_joint_lists_equal (list, incremental_list);
+
+      g_slice_free1 (width * height * sizeof (guint16), depth);
+      skeltrack_joint_list_free (list);
+      skeltrack_joint_list_free (incremental_list);
+    }
+
+  g_object_unref (incremental);
+}
+
+/* A wall behind the user, with a hole where the sensor gets no depth,
+   and the user standing in front of it if x is not negative */
+static guint16 *
+reduce_wall_buffer (gint x, guint reduction, guint *width, guint *height)
+{
+  guint16 *depth, *reduced;
+  gint i, j;
+
+  depth = g_slice_alloc (WIDTH * HEIGHT * sizeof (guint16));
+  for (j = 0; j < HEIGHT; j++)
+    {
+      for (i = 0; i < WIDTH; i++)
+        depth[j * WIDTH + i] = (i >= 160 && i < 480) ? 0 : 3000;
+    }
+
+  if (x >= 0)
+    draw_user (depth, x, 2000);
+
+  *width = WIDTH / reduction;
+  *height = HEIGHT / reduction;
+  reduced = g_slice_alloc (*width * *height * sizeof (guint16));
+  skeltrack_depth_reduce_buffer (depth,
+                                 WIDTH,
+                                 HEIGHT,
+                                 reduction,
+                                 0,
+                                 G_MAXUINT16,
+                                 SKELTRACK_REDUCTION_MODE_POINT,
+                                 reduced);
+
+  g_slice_free1 (WIDTH * HEIGHT * sizeof (guint16), depth);
+  return reduced;
+}
+
+static void
+test_background_learning (Fixture *f,
+                          gconstpointer test_data)
+{
+  SkeltrackSkeleton *skeleton;
+  SkeltrackJointList list, user_list;
+  guint reduction, width, height, frame;
+  guint16 *depth, *user_depth;
+
+  g_object_set (f->skeleton,
+                "enable-background-subtraction", TRUE,
+                "background-learning-frames", 3,
+                "background-absorption-frames", 6,
+                "enable-smoothing", FALSE,
+                NULL);
+  g_object_get (f->skeleton, "dimension-reduction", &reduction, NULL);
+
+  skeleton = skeltrack_skeleton_new ();
+  g_object_set (skeleton, "enable-smoothing", FALSE, NULL);
+  user_depth = reduce_user_buffer (320, reduction, &width, &height);
+  user_list = skeltrack_skeleton_track_joints_sync (skeleton,
+                                                    user_depth,
+                                                    width,
+                                                    height,
+                                                    NULL,
+                                                    NULL);
+  g_assert (user_list != NULL);
+
+  /* The background is learned while the hole has no depth */
+  depth = reduce_wall_buffer (-1, reduction, &width, &height);
+  for (frame = 0; frame < 3; frame++)
+    {
+      list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                                   depth,
+                                                   width,
+                                                   height,
+                                                   NULL,
+                                                   NULL);
+      skeltrack_joint_list_free (list);
+    }
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+
+  /* The user then stands in front of the hole, which has no background
+     to be compared with, for longer than it took to learn it, and is
+     only taken into the background after standing still long enough */
+  depth = reduce_wall_buffer (320, reduction, &width, &height);
+  for (frame = 1; frame <= 6; frame++)
+    {
+      list = skeltrack_skeleton_track_joints_sync (f->skeleton,
+                                                   depth,
+                                                   width,
+                                                   height,
+                                                   NULL,
+                                                   NULL);
+      if (frame < 6)
+        assert_joint_lists_equal (list, user_list);
+      else
+        g_assert (list == NULL);
+
+      skeltrack_joint_list_free (list);
+    }
+
+  g_slice_free1 (width * height * sizeof (guint16), depth);
+  g_slice_free1 (width * height * sizeof (guint16), user_depth);
+  skeltrack_joint_list_free (user_list);
+  g_object_unref (skeleton);
+}
+
+gint
+main (gint argc, gchar **argv)
+{
+  guint i;
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add ("/skeltrack/skeleton/init",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_init,
+              fixture_teardown);
+
+  for (i = 0; i < NUMBER_OF_FILES; i++)
+    {
+      g_test_add ("/skeltrack/skeleton/track_joints_number",
+                  Fixture,
+                  DEPTH_FILES[i],
+                  fixture_setup_main_loop,
+                  test_track_joints_number,
+                  fixture_teardown_main_loop);
+
+      g_test_add ("/skeltrack/skeleton/track_joints_number_sync",
+                  Fixture,
+                  DEPTH_FILES[i],
+                  fixture_setup,
+                  test_track_joints_number_sync,
+                  fixture_teardown);
+
+      g_test_add ("/skeltrack/skeleton/pyramid",
+                  Fixture,
+                  DEPTH_FILES[i],
+                  fixture_setup,
+                  test_pyramid,
+                  fixture_teardown);
+    }
+
+  g_test_add ("/skeltrack/skeleton/pending_operation",
+              Fixture,
+              NULL,
+              fixture_setup_main_loop,
+              test_pending_operation,
+              fixture_teardown_main_loop);
+
+  g_test_add ("/skeltrack/skeleton/incremental_graph",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_incremental_graph,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/static_scene",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_static_scene,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/static_scene_small_change",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_static_scene_small_change,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/refine_hands",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_refine_hands,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/reduce_buffer",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_reduce_buffer,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/track_joints_full",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_track_joints_full,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/depth_formats",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_depth_formats,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/camera_intrinsics",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_camera_intrinsics,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/denoise",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_denoise,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/background_subtraction",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_background_subtraction,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/plane_removal",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_plane_removal,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/depth_gating",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_depth_gating,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/track_joints_points",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_track_joints_points,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/adaptive_graph",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_adaptive_graph,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/joint_mask",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_joint_mask,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/lower_body",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_lower_body,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/track_close_users",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_track_close_users,
+              fixture_teardown);
+  g_test_add ("/skeltrack/skeleton/track_users",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_track_users,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/track_users_stray_component",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_track_users_stray_component,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/joint_confidence",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_joint_confidence,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/temporal_arm_assignment",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_temporal_arm_assignment,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/prediction",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_prediction,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/region_of_interest",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_region_of_interest,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/incremental_graph_tiles",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_incremental_graph_tiles,
+              fixture_teardown);
+
+  g_test_add ("/skeltrack/skeleton/background_learning",
+              Fixture,
+              NULL,
+              fixture_setup,
+              test_background_learning,
+              fixture_teardown);
 
   g_test_run ();
 